@@ -0,0 +1,140 @@
+#include "Graphics/util/BoxCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace gbe;
+using namespace gbe::gfx;
+
+namespace {
+	//Plain glm loop over boxes kept as structs, what the SoA kernel replaces
+	size_t CullReference(const Frustum& frustum, const std::vector<AABB>& boxes, uint32_t* out) {
+		size_t written = 0;
+
+		for (size_t i = 0; i < boxes.size(); i++)
+		{
+			const auto& box = boxes[i];
+			bool visible = true;
+
+			for (const auto& plane : frustum.planes)
+			{
+				glm::vec3 normal(plane.x, plane.y, plane.z);
+				glm::vec3 farthest = glm::mix((glm::vec3)box.min, (glm::vec3)box.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+				if (glm::dot(normal, farthest) + plane.w < 0) {
+					visible = false;
+					break;
+				}
+			}
+
+			if (visible)
+				out[written++] = (uint32_t)i;
+		}
+
+		return written;
+	}
+
+	//Average time of one call over every frustum, in milliseconds
+	template<typename TCull>
+	double TimePass(int repeats, const std::vector<Frustum>& frusta, TCull&& cull) {
+		size_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (int r = 0; r < repeats; r++)
+		{
+			for (const auto& frustum : frusta)
+				sink += cull(frustum);
+		}
+
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		//Keeps the calls from being optimized out
+		if (sink == SIZE_MAX)
+			std::printf("%zu\n", sink);
+
+		return elapsed / (repeats * frusta.size());
+	}
+}
+
+int main(int argc, char** argv) {
+	const size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	const int repeats = (argc > 2) ? std::atoi(argv[2]) : 20;
+	const int frustum_count = 16;
+
+	//A flat town: boxes spread wide on xz and low on y, like AnitoBuilder blocks
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> spread(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 10.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+	std::vector<AABB> boxes;
+	AABBArray soa;
+	boxes.reserve(count);
+	soa.Reserve(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		Vector3 center(spread(generator), spread(generator) * 0.05f, spread(generator));
+		Vector3 half(extent(generator), extent(generator), extent(generator));
+		AABB box(center - half, center + half);
+
+		boxes.push_back(box);
+		soa.Push(box);
+	}
+
+	std::vector<Frustum> frusta;
+	for (int f = 0; f < frustum_count; f++)
+	{
+		glm::vec3 eye(spread(generator), 20.0f, spread(generator));
+		float yaw = angle(generator);
+		glm::vec3 target = eye + glm::vec3(std::cos(yaw), -0.2f, std::sin(yaw));
+
+		glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+		glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+		frusta.push_back(Frustum::FromMatrix(Matrix4(proj * view)));
+	}
+
+	//CORRECTNESS
+	std::vector<uint32_t> simd_out(count);
+	std::vector<uint32_t> scalar_out(count);
+	std::vector<uint32_t> reference_out(count);
+	size_t visible_total = 0;
+
+	for (const auto& frustum : frusta)
+	{
+		size_t simd_count = BoxCuller::Cull(frustum, soa, simd_out.data());
+		size_t scalar_count = BoxCuller::CullScalar(frustum, soa, scalar_out.data());
+		size_t reference_count = CullReference(frustum, boxes, reference_out.data());
+
+		if (simd_count != reference_count || scalar_count != reference_count
+			|| std::memcmp(simd_out.data(), reference_out.data(), reference_count * sizeof(uint32_t)) != 0
+			|| std::memcmp(scalar_out.data(), reference_out.data(), reference_count * sizeof(uint32_t)) != 0) {
+			std::fprintf(stderr, "Mismatch: %s kept %zu, scalar kept %zu, reference kept %zu\n", BoxCuller::GetPathName(), simd_count, scalar_count, reference_count);
+			return 1;
+		}
+
+		visible_total += reference_count;
+	}
+
+	//TIMING
+	double simd_ms = TimePass(repeats, frusta, [&](const Frustum& frustum) { return BoxCuller::Cull(frustum, soa, simd_out.data()); });
+	double scalar_ms = TimePass(repeats, frusta, [&](const Frustum& frustum) { return BoxCuller::CullScalar(frustum, soa, scalar_out.data()); });
+	double reference_ms = TimePass(repeats, frusta, [&](const Frustum& frustum) { return CullReference(frustum, boxes, reference_out.data()); });
+
+	std::printf("%zu boxes, %d frusta, %.1f%% visible on average, %d repeats\n", count, frustum_count, 100.0 * visible_total / ((double)count * frustum_count), repeats);
+	const auto report = [&](const char* name, double ms) {
+		std::printf("  %-12s %9.3f ms/pass %7.2f ns/box %6.2fx\n", name, ms, ms * 1e6 / count, reference_ms / ms);
+		};
+	report("glm", reference_ms);
+	report("scalar SoA", scalar_ms);
+	report(BoxCuller::GetPathName(), simd_ms);
+
+	return 0;
+}
\ No newline at end of file
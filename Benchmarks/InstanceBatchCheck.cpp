@@ -0,0 +1,100 @@
+#include "Graphics/Renderer.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace gbe;
+using InstanceBatch = gbe::gfx::GraphicsRenderInfo::InstanceBatch;
+
+namespace {
+	//Stands in for the persistent GPU buffer, only what TakeDirtyRanges hands out reaches it
+	struct Mirror {
+		std::vector<Matrix4> buffer;
+		size_t uploaded = 0;
+
+		//Same steps as ForwardRenderer::UploadInstanceBatches
+		void Upload(InstanceBatch& batch) {
+			uint32_t count = (uint32_t)batch.matrices.size();
+
+			if (count == 0) {
+				batch.ClearDirty();
+				return;
+			}
+
+			if (buffer.size() < count) {
+				buffer.resize(count);
+				batch.all_dirty = true;
+			}
+
+			batch.TakeDirtyRanges(count, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++)
+					buffer[i] = batch.matrices[i];
+				uploaded += end - begin;
+				});
+		}
+	};
+
+	//The registration steps RenderPipeline takes on a batch, without the BVH and instance map
+	void Add(InstanceBatch& batch, float value) {
+		uint32_t index = (uint32_t)batch.matrices.size();
+		batch.instances.push_back(index);
+		batch.matrices.push_back(Matrix4(glm::mat4(value)));
+		batch.MarkDirty(index);
+	}
+	void RemoveLast(InstanceBatch& batch) {
+		batch.instances.pop_back();
+		batch.matrices.pop_back();
+	}
+	void Move(InstanceBatch& batch, uint32_t index, float value) {
+		batch.matrices[index] = Matrix4(glm::mat4(value));
+		batch.MarkDirty(index);
+	}
+
+	bool Check(InstanceBatch& batch, Mirror& mirror, const char* stage) {
+		mirror.Upload(batch);
+
+		for (size_t i = 0; i < batch.matrices.size(); i++)
+		{
+			if (mirror.buffer[i] != batch.matrices[i]) {
+				std::fprintf(stderr, "Mismatch after %s: instance %zu was not uploaded\n", stage, i);
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main() {
+	InstanceBatch batch;
+	Mirror mirror;
+
+	for (int i = 0; i < 8; i++)
+		Add(batch, 1.0f + i);
+	if (!Check(batch, mirror, "registering"))
+		return 1;
+
+	Move(batch, 5, 20.0f);
+	if (!Check(batch, mirror, "moving one"))
+		return 1;
+
+	//Emptied with entries still dirty, then filled again into those same slots without growing the buffer
+	for (uint32_t i = 0; i < 3; i++)
+		Move(batch, i, 30.0f + i);
+	while (!batch.matrices.empty())
+		RemoveLast(batch);
+	if (!Check(batch, mirror, "emptying"))
+		return 1;
+
+	for (int i = 0; i < 3; i++)
+		Add(batch, 40.0f + i);
+	if (!Check(batch, mirror, "registering again"))
+		return 1;
+
+	Move(batch, 2, 50.0f);
+	if (!Check(batch, mirror, "moving after refilling"))
+		return 1;
+
+	std::printf("Instance batch uploads match, %zu matrices sent\n", mirror.uploaded);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "Engine/ObjectHandlers/ObjectHandler.h"
+#include "Engine/Objects/Object.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+using namespace gbe;
+
+namespace {
+	class Probe : public Object {
+	public:
+		uint32_t visits = 0;
+	};
+
+	//The handler as it was before dense storage, members in a map and enabled read off each object
+	template<class TValue>
+	class MapHandler {
+	public:
+		std::unordered_map<Object*, TValue*> object_list;
+
+		bool TryAdd(Object* object) {
+			TValue* typed_object = dynamic_cast<TValue*>(object);
+
+			if (typed_object == nullptr || object_list.find(object) != object_list.end())
+				return false;
+
+			object_list.insert_or_assign(object, typed_object);
+			return true;
+		}
+		void Remove(Object* object) {
+			object_list.erase(object);
+		}
+		void DoOnEnabled(std::function<void(TValue*)> action) {
+			for (auto& existing : this->object_list)
+			{
+				if (!existing.first->Get_enabled())
+					continue;
+
+				action(existing.second);
+			}
+		}
+	};
+
+	double Milliseconds(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//Every member the handler dispatches to is visited exactly once and only when it should be
+	bool CheckVisits(ObjectHandler<Probe>& handler, const std::vector<Probe*>& probes, const std::vector<bool>& expected, const char* stage) {
+		for (auto probe : probes)
+			probe->visits = 0;
+
+		handler.ForEachEnabled([](Probe* probe) { probe->visits++; });
+
+		for (size_t i = 0; i < probes.size(); i++)
+		{
+			if (probes[i]->visits != (expected[i] ? 1u : 0u)) {
+				std::fprintf(stderr, "Mismatch after %s: object %zu visited %u times\n", stage, i, probes[i]->visits);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool Run(size_t count, int repeats) {
+		std::vector<Probe*> probes;
+		std::vector<Object*> keys;
+		std::vector<bool> expected(count);
+		probes.reserve(count);
+		keys.reserve(count);
+
+		//Every fourth object disabled, as scenes keep some of theirs switched off
+		for (size_t i = 0; i < count; i++)
+		{
+			auto probe = new Probe();
+			expected[i] = (i % 4) != 0;
+			probe->Set_enabled(expected[i]);
+
+			probes.push_back(probe);
+			keys.push_back(probe);
+		}
+
+		ObjectHandler<Probe> dense;
+		MapHandler<Probe> map;
+
+		//Both add one object per call, so the timings only differ by storage
+		auto start = std::chrono::steady_clock::now();
+		for (auto key : keys)
+			dense.TryAdd(key);
+		double dense_add_ms = Milliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		for (auto key : keys)
+			map.TryAdd(key);
+		double map_add_ms = Milliseconds(start);
+
+		if (dense.Count() != count || !CheckVisits(dense, probes, expected, "adding"))
+			return false;
+
+		//Toggling goes through the handler, which is what Root does on an enabled change
+		for (size_t i = 0; i < count; i += 7)
+		{
+			expected[i] = !expected[i];
+			probes[i]->Set_enabled(expected[i]);
+			dense.SetEnabled(probes[i], expected[i]);
+		}
+
+		if (!CheckVisits(dense, probes, expected, "toggling"))
+			return false;
+
+		//DISPATCH
+		uint64_t dense_sum = 0;
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+			dense.ForEachEnabled([&](Probe* probe) { dense_sum += probe->visits; });
+		double dense_iterate_ms = Milliseconds(start) / repeats;
+
+		uint64_t map_sum = 0;
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+			map.DoOnEnabled([&](Probe* probe) { map_sum += probe->visits; });
+		double map_iterate_ms = Milliseconds(start) / repeats;
+
+		if (dense_sum != map_sum) {
+			std::fprintf(stderr, "Mismatch: dense handler visited %llu, map handler %llu\n", (unsigned long long)dense_sum, (unsigned long long)map_sum);
+			return false;
+		}
+
+		const size_t enabled = (size_t)std::count(expected.begin(), expected.end(), true);
+
+		//REMOVAL, half of the members one by one
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; i += 2)
+			dense.Remove(keys[i]);
+		double dense_remove_ms = Milliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; i += 2)
+			map.Remove(keys[i]);
+		double map_remove_ms = Milliseconds(start);
+
+		for (size_t i = 0; i < count; i += 2)
+			expected[i] = false;
+
+		//Then a quarter more, which swaps members that were moved by the first pass
+		size_t removed = (count + 1) / 2;
+		for (size_t i = 1; i < count; i += 4)
+		{
+			dense.Remove(keys[i]);
+			expected[i] = false;
+			removed++;
+		}
+
+		const size_t remaining = count - removed;
+		if (dense.Count() != remaining || !CheckVisits(dense, probes, expected, "removing"))
+			return false;
+
+		std::printf("%zu objects, %zu enabled\n", count, enabled);
+		const auto report = [&](const char* name, double add_ms, double remove_ms, double iterate_ms) {
+			std::printf("  %-6s %9.3f ms add %9.3f ms remove half %9.4f ms dispatch %6.2fx\n", name, add_ms, remove_ms, iterate_ms, map_iterate_ms / iterate_ms);
+			};
+		report("map", map_add_ms, map_remove_ms, map_iterate_ms);
+		report("dense", dense_add_ms, dense_remove_ms, dense_iterate_ms);
+
+		for (auto probe : probes)
+			delete probe;
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	const int repeats = (argc > 1) ? std::atoi(argv[1]) : 100;
+
+	for (size_t count : { 1000, 10000, 100000 })
+	{
+		if (!Run(count, repeats))
+			return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "Engine/Objects/Object.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace gbe;
+
+namespace {
+	bool Expect(Object* object, Vector3 expected, const char* stage) {
+		Vector3 actual = object->World().position.Get();
+
+		if (std::abs(actual.x - expected.x) > 1e-4f || std::abs(actual.y - expected.y) > 1e-4f || std::abs(actual.z - expected.z) > 1e-4f) {
+			std::fprintf(stderr, "Mismatch %s: world position (%g, %g, %g), expected (%g, %g, %g)\n", stage, actual.x, actual.y, actual.z, expected.x, expected.y, expected.z);
+			return false;
+		}
+
+		return true;
+	}
+
+	//Read once before the flush, through the unflushed writes, and once after it
+	bool ExpectAcrossFlush(Object* object, Vector3 expected, const char* stage) {
+		if (!Expect(object, expected, stage))
+			return false;
+
+		TransformHierarchy::Flush();
+		return Expect(object, expected, stage);
+	}
+}
+
+int main() {
+	TransformHierarchy::SetDeferred(true);
+
+	auto parent = new Object();
+	auto child = new Object();
+	child->SetParent(parent);
+	parent->Local().position.Set(Vector3(10, 0, 0));
+	TransformHierarchy::Flush();
+
+	//The last write wins whichever space it was made in
+	child->Local().position.Set(Vector3(1, 0, 0));
+	child->World().position.Set(Vector3(5, 5, 5));
+	child->Local().position.Set(Vector3(2, 0, 0));
+	if (!ExpectAcrossFlush(child, Vector3(12, 0, 0), "after local, world, local"))
+		return 1;
+
+	child->Local().position.Set(Vector3(1, 0, 0));
+	child->World().position.Set(Vector3(5, 5, 5));
+	if (!ExpectAcrossFlush(child, Vector3(5, 5, 5), "after local, world"))
+		return 1;
+
+	//A world write is made against the parent as it is then, a later parent move carries the child along
+	child->World().position.Set(Vector3(0, 1, 0));
+	parent->Local().position.Set(Vector3(20, 0, 0));
+	if (!ExpectAcrossFlush(child, Vector3(10, 1, 0), "after world, parent move"))
+		return 1;
+
+	std::printf("Mixed local and world transform writes match\n");
+	return 0;
+}
\ No newline at end of file
@@ -7,7 +7,12 @@ $input v_pos, v_view, v_normal, v_color0, v_texcoord0, v_tangent, v_bitangent
 #include <bgfx_shader.sh>
 #include "../shaderlib.sh"
 
-#define MAX_LIGHTS 10
+#define MAX_SHADOW_LAYERS 32
+
+// Must match LightClusters
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
 
 //Material stuff
 
@@ -31,20 +36,49 @@ uniform vec4 tiling;
 SAMPLER2D(tex_ao, 4);
 
 
+// Per-frame block, sent once per view. Must match ForwardRenderer's frame_block
+// 0: light grid, x: directional light count, yz: scale and bias from log(view depth) to cluster slice, w: light_indices width
+// then where each shadow layer's tile sits in the atlas, offset in xy and scale in zw
+// then each shadow layer's light projection times view, as 4 columns
+#define FRAME_SHADOW_TILE 1
+#define FRAME_SHADOW_MTX (FRAME_SHADOW_TILE + MAX_SHADOW_LAYERS)
+#define FRAME_BLOCK_SIZE (FRAME_SHADOW_MTX + MAX_SHADOW_LAYERS * 4)
+uniform vec4 u_frame[FRAME_BLOCK_SIZE];
+#define light_grid u_frame[0]
+
+mat4 shadowMtx(int _layer)
+{
+    int base = FRAME_SHADOW_MTX + _layer * 4;
+    return mtxFromCols(u_frame[base], u_frame[base + 1], u_frame[base + 2], u_frame[base + 3]);
+}
+
 //Lights
-SAMPLER2DARRAY(light_map, 0);
-uniform mat4 light_view[MAX_LIGHTS];
-uniform mat4 light_proj[MAX_LIGHTS];
-uniform vec4 light_pos[MAX_LIGHTS];
-uniform vec4 light_color[MAX_LIGHTS];
-uniform vec4 light_type[MAX_LIGHTS];
-uniform vec4 light_is_square[MAX_LIGHTS];
-uniform vec4 light_nearclip[MAX_LIGHTS];
-uniform vec4 light_range[MAX_LIGHTS];
-uniform vec4 light_bias_min[MAX_LIGHTS];
-uniform vec4 light_bias_mult[MAX_LIGHTS];
-uniform vec4 light_cone_inner[MAX_LIGHTS];
-uniform vec4 light_cone_outer[MAX_LIGHTS];
+SAMPLER2D(light_map, 0);
+
+// One row per light:
+// 0: position, range
+// 1: color, type
+// 2: direction towards the light, cos of half the inner cone
+// 3: cos of half the outer cone, bias min, bias mult
+// 4: first shadow layer (-1 for none), shadow layer count
+// 5: view depth where each cascade ends
+SAMPLER2D(light_data, 5);
+// Offset into light_indices and light count of each cluster
+SAMPLER2D(light_clusters, 6);
+// Directional lights first, then every cluster's lights
+SAMPLER2D(light_indices, 7);
+
+vec4 lightTexel(int _light, int _texel)
+{
+    return texelFetch(light_data, ivec2(_texel, _light), 0);
+}
+
+int lightIndex(int _i)
+{
+    int width = int(light_grid.w);
+    int row = _i / width;
+    return int(texelFetch(light_indices, ivec2(_i - row * width, row), 0).x);
+}
 
 const vec2 s_poissonDisk[16] = 
 {
@@ -65,10 +99,32 @@ float random(vec3 seed, float i) {
     return fract(sin(dot_product) * 43758.5453);
 }
 
+// Shadow layer of the light covering this fragment, -1 if none
+// Directional lights pick the first cascade that ends past the fragment's view depth, other lights have a single layer
+int getShadowLayer(int _light, float _depth)
+{
+    vec4 lightShadow = lightTexel(_light, 4);
+
+    if (lightShadow.x < 0.0) {
+        return -1;
+    }
+
+    float cascade = dot(step(lightTexel(_light, 5), vec4_splat(_depth)), vec4_splat(1.0));
+
+    if (cascade >= lightShadow.y) {
+        return -1;
+    }
+
+    return int(lightShadow.x + cascade);
+}
+
 float getShadow(int _layer, vec3 _wpos, vec3 _normal, vec3 _lightDir, float _minBias, float _multBias)
 {
-    mat4 shadowMtx = mul(light_proj[_layer], light_view[_layer]);
-    vec4 shadowProj = mul(shadowMtx, vec4(_wpos, 1.0));
+    if (_layer < 0) {
+        return 1.0;
+    }
+
+    vec4 shadowProj = mul(shadowMtx(_layer), vec4(_wpos, 1.0));
     vec3 shadowCoord = shadowProj.xyz / shadowProj.w;
     
     vec2 uv = shadowCoord.xy * 0.5 + 0.5;
@@ -83,6 +139,11 @@ float getShadow(int _layer, vec3 _wpos, vec3 _normal, vec3 _lightDir, float _min
         uv.y = 1.0 - uv.y;
     #endif
 
+    // Taps stay half a texel of the smallest tile inside this layer's tile, so they never read a neighbour
+    vec4 tile = u_frame[FRAME_SHADOW_TILE + _layer];
+    vec2 tileMin = vec2_splat(0.004);
+    vec2 tileMax = vec2_splat(0.996);
+
     float currentDepth = shadowCoord.z;
     float bias = max(_multBias * (1.0 - dot(_normal, _lightDir)), _minBias);
 
@@ -101,7 +162,8 @@ float getShadow(int _layer, vec3 _wpos, vec3 _normal, vec3 _lightDir, float _min
         // Rotate the Poisson sample and scale by our filter radius
         vec2 offset = mul(rotation, s_poissonDisk[i]) * filterRadius;
         
-        float pcfDepth = texture2DArray(light_map, vec3(uv + offset, float(_layer))).r;
+        vec2 tap = clamp(uv + offset, tileMin, tileMax);
+        float pcfDepth = texture2D(light_map, tile.xy + tap * tile.zw).r;
         shadow += (currentDepth - bias) > pcfDepth ? 0.0 : 1.0;
     }
 
@@ -138,6 +200,46 @@ vec4 powRgba(vec4 _rgba, float _pow)
 	return result;
 }
 
+vec3 shadeLight(int _light, vec3 _wpos, float _depth, vec3 _normal, vec3 _view)
+{
+    vec4 posRange = lightTexel(_light, 0);
+    vec4 colorType = lightTexel(_light, 1);
+    vec4 dirInner = lightTexel(_light, 2);
+    vec4 outerBias = lightTexel(_light, 3);
+
+    vec3 lightDir;
+    float attenuation = 1.0;
+    float shadow = 1.0;
+
+    // Calculate direction and attenuation based on light type
+    if (abs(colorType.w) < 0.5) { // Directional
+        lightDir = dirInner.xyz;
+        shadow = getShadow(getShadowLayer(_light, _depth), _wpos, _normal, lightDir, outerBias.y, outerBias.z);
+    }
+    else { // Point or Spot
+        vec3 disp = posRange.xyz - _wpos;
+        float dist = length(disp);
+        lightDir = normalize(disp);
+
+        // Basic inverse-square falloff with range clamp
+        attenuation = saturate(1.0 - (dist / posRange.w));
+        attenuation *= attenuation;
+
+        if (abs(colorType.w - 1.0) < 0.5) { // Spot Light
+            float cosAngle = dot(lightDir, dirInner.xyz);
+            attenuation *= saturate((cosAngle - outerBias.x) / (dirInner.w - outerBias.x));
+
+            shadow = getShadow(getShadowLayer(_light, _depth), _wpos, _normal, lightDir, outerBias.y, outerBias.z);
+        }
+    }
+
+    vec2 bln = blinn(lightDir, _normal, _view);
+    vec4 lc = lit(bln.x, bln.y, 1.0);
+    vec3 rgb = saturate(lc.y) * attenuation;
+
+    return colorType.xyz * rgb * shadow;
+}
+
 vec3 perturbNormal(vec3 _wpos, vec3 _normal, vec2 _uv, sampler2D _normalTex) {
     // 1. Get Normal Map components (X and Y only)
     vec3 normalSample = texture2D(_normalTex, _uv).xyz * 2.0 - 1.0;
@@ -200,44 +302,23 @@ void main() {
     
     vec3 lightColor = vec3(0 ,0 ,0);
 
-    for (int i = 0; i < MAX_LIGHTS; ++i) {
-        vec3 lightDir;
-        float attenuation = 1.0;
-        float shadow = 1.0;
-
-        // Calculate direction and attenuation based on light type
-        if (abs(light_type[i].x) < 0.5) { // Directional
-            // Assuming view matrix forward vector is the direction
-            lightDir = normalize(light_view[i][2].xyz); 
-            shadow = getShadow(i, v_pos, normal, lightDir, light_bias_min[i].x, light_bias_mult[i].x);
-        } 
-        else { // Point or Spot
-            vec3 lightPos = light_pos[i].xyz; // Extract position from view matrix
-            vec3 disp = lightPos - v_pos;
-            float dist = length(disp);
-            lightDir = normalize(disp);
-            
-            // Basic inverse-square falloff with range clamp
-            attenuation = saturate(1.0 - (dist / light_range[i].x));
-            attenuation *= attenuation;
-
-            if (abs(light_type[i].x - 1) < 0.5) { // Spot Light
-                vec3 spotDir = normalize(light_view[i][2].xyz);
-                float cosAngle = dot(lightDir, spotDir);
-                float inner = cos(light_cone_inner[i].x / 2);
-                float outer = cos(light_cone_outer[i].x / 2);
-                attenuation *= saturate((cosAngle - outer) / (inner - outer));
-
-                shadow = getShadow(i, v_pos, normal, lightDir, light_bias_min[i].x, light_bias_mult[i].x);
-            }
-        }
-
-	    lightDir = lightDir;
-	    vec2 bln = blinn(lightDir, normal, view);
-	    vec4 lc = lit(bln.x, bln.y, 1.0);
-	    vec3 rgb = saturate(lc.y) * attenuation;
-
-        lightColor += light_color[i].xyz * rgb * shadow;
+    // Find the fragment's cluster
+    vec3 viewPos = mul(u_view, vec4(v_pos, 1.0)).xyz;
+    float depth = -viewPos.z;
+    vec4 clipPos = mul(u_proj, vec4(viewPos, 1.0));
+    vec2 tile = floor((clipPos.xy / clipPos.w * 0.5 + 0.5) * vec2(CLUSTER_X, CLUSTER_Y));
+    tile = clamp(tile, vec2_splat(0.0), vec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    float slice = clamp(floor(log(max(depth, 0.0001)) * light_grid.y + light_grid.z), 0.0, float(CLUSTER_Z - 1));
+    vec2 cluster = texelFetch(light_clusters, ivec2(int(tile.x) + int(tile.y) * CLUSTER_X, int(slice)), 0).xy;
+
+    // Directional lights touch every cluster, local lights only the clusters they reach
+    int directionalCount = int(light_grid.x);
+    int lightCount = directionalCount + int(cluster.y);
+    int clusterStart = int(cluster.x) - directionalCount;
+
+    for (int i = 0; i < lightCount; ++i) {
+        int index = lightIndex(i < directionalCount ? i : clusterStart + i);
+        lightColor += shadeLight(index, v_pos, depth, normal, view);
     }
 
     // Sample SSAO using screen coordinates
@@ -1,4 +1,4 @@
-$input v_pos, v_view, v_normal, v_color0, v_texcoord0, v_tangent, v_bitangent
+$input v_texcoord0, v_pickid
 /*
  * Copyright 2011-2025 Branimir Karadzic. All rights reserved.
  * License: https://github.com/bkaradzic/bgfx/blob/master/LICENSE
@@ -6,8 +6,8 @@ $input v_pos, v_view, v_normal, v_color0, v_texcoord0, v_tangent, v_bitangent
 
 #include <bgfx_shader.sh>
 
-uniform vec4 id;
-
+// Target 0 gets the object id, target 1 the uv under the pixel
 void main() {
-    gl_FragColor = vec4(vec3(id), 1);
+    gl_FragData[0] = v_pickid;
+    gl_FragData[1] = vec4(v_texcoord0, 0.0, 1.0);
 }
\ No newline at end of file
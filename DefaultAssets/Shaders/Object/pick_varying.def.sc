@@ -0,0 +1,11 @@
+vec2 v_texcoord0 : TEXCOORD0 = vec2(0.0, 0.0);
+flat vec4 v_pickid : TEXCOORD1 = vec4(0.0, 0.0, 0.0, 0.0);
+
+vec4 i_data0     : TEXCOORD5;
+vec4 i_data1     : TEXCOORD6;
+vec4 i_data2     : TEXCOORD7;
+vec4 i_data3     : TEXCOORD8;
+vec4 i_data4     : TEXCOORD9;
+
+vec3 a_position  : POSITION;
+vec2 a_texcoord0 : TEXCOORD0;
\ No newline at end of file
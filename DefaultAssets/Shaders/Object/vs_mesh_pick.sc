@@ -0,0 +1,21 @@
+$input a_position, a_texcoord0, i_data0, i_data1, i_data2, i_data3, i_data4
+$output v_texcoord0, v_pickid
+
+/*
+ * Copyright 2011-2025 Branimir Karadzic. All rights reserved.
+ * License: https://github.com/bkaradzic/bgfx/blob/master/LICENSE
+ */
+
+#include <bgfx_shader.sh>
+
+// Instanced picking, the model matrix comes in i_data0-3 and the packed object id in i_data4
+void main()
+{
+    mat4 model = mtxFromCols(i_data0, i_data1, i_data2, i_data3);
+
+    vec3 wpos = mul(model, vec4(a_position, 1.0) ).xyz;
+    gl_Position = mul(u_viewProj, vec4(wpos, 1.0) );
+
+    v_texcoord0 = a_texcoord0;
+    v_pickid = i_data4;
+}
\ No newline at end of file
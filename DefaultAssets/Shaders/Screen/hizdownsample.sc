@@ -0,0 +1,21 @@
+$input v_texcoord0
+
+#include "common.sh"
+
+SAMPLER2D(tex_depth, 0);
+
+// xy: size of the source level in texels
+uniform vec4 u_hiz_params;
+
+void main() {
+    // Each texel keeps the farthest of the 2x2 source texels under it, odd edges repeat their last texel
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 last = ivec2(u_hiz_params.xy) - ivec2(1, 1);
+
+    float d0 = texelFetch(tex_depth, min(base, last), 0).r;
+    float d1 = texelFetch(tex_depth, min(base + ivec2(1, 0), last), 0).r;
+    float d2 = texelFetch(tex_depth, min(base + ivec2(0, 1), last), 0).r;
+    float d3 = texelFetch(tex_depth, min(base + ivec2(1, 1), last), 0).r;
+
+    gl_FragColor = vec4(max(max(d0, d1), max(d2, d3)), 0.0, 0.0, 1.0);
+}
\ No newline at end of file
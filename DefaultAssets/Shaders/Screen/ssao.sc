@@ -2,79 +2,82 @@ $input v_texcoord0
 
 #include "common.sh"
 
-SAMPLER2D(tex_normal, 0); 
+SAMPLER2D(tex_normal, 0);
 SAMPLER2D(tex_depth,  1);
+SAMPLER2D(tex_noise,  2);
 
-// x: thickness, y: sensitivity threshold, z: screenWidth, w: screenHeight
-uniform vec4 u_ssao_params;  
-// x: near plane, y: far plane
-uniform vec4 u_camera_params; 
+#define SSAO_MAX_SAMPLES 32
 
-float getLinearDepth(float _rawDepth)
+// Hemisphere around +z, samples grow from the center out so any prefix spans the whole radius
+uniform vec4 u_kernel[SSAO_MAX_SAMPLES];
+// x: radius in view units, y: depth bias, z: sample count, w: strength
+uniform vec4 u_ssao_params;
+// x: projection [0][0], y: projection [1][1], z: 1 when texel rows run from the top, w: 1 for perspective
+uniform vec4 u_ssao_proj;
+// xy: size of this target in texels
+uniform vec4 u_ssao_target;
+
+vec3 toView(vec2 _texel, float _depth)
+{
+    vec2 ndc = _texel / u_ssao_target.xy * 2.0 - 1.0;
+    ndc.y = mix(ndc.y, -ndc.y, u_ssao_proj.z);
+
+    float w = mix(1.0, _depth, u_ssao_proj.w);
+    return vec3(ndc * w / u_ssao_proj.xy, -_depth);
+}
+
+vec2 toTexel(vec3 _view)
 {
-    float n = u_camera_params.x;
-    float f = u_camera_params.y;
-    return (2.0 * n * f) / max(0.00001, (f + n - _rawDepth * (f - n)));
+    float w = mix(1.0, -_view.z, u_ssao_proj.w);
+    vec2 ndc = _view.xy * u_ssao_proj.xy / w;
+    ndc.y = mix(ndc.y, -ndc.y, u_ssao_proj.z);
+
+    return (ndc * 0.5 + 0.5) * u_ssao_target.xy;
 }
 
 void main() {
-    float rawDepth = texture2D(tex_depth, v_texcoord0).r;
-    
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(tex_depth, texel, 0).r;
+
     // Ignore sky
-    if (rawDepth >= 1.0) {
+    if (depth <= 0.0) {
         gl_FragColor = vec4(1.0, 1.0, 1.0, 1.0);
         return;
     }
 
-    vec2 invScreen = 1.0 / max(u_camera_params.zw, vec2(1.0, 1.0));
-    vec2 offset = u_ssao_params.xx * invScreen;
-
-    // Center data
-    float depthC = getLinearDepth(rawDepth);
-    vec3 normalC = normalize(texture2D(tex_normal, v_texcoord0).xyz);
-
-    // Neighbors (Left, Right, Top, Bottom)
-    vec3 nL = normalize(texture2D(tex_normal, v_texcoord0 + vec2(-offset.x, 0.0)).xyz);
-    vec3 nR = normalize(texture2D(tex_normal, v_texcoord0 + vec2( offset.x, 0.0)).xyz);
-    vec3 nT = normalize(texture2D(tex_normal, v_texcoord0 + vec2(0.0,  offset.y)).xyz);
-    vec3 nB = normalize(texture2D(tex_normal, v_texcoord0 + vec2(0.0, -offset.y)).xyz);
-
-    float dL = getLinearDepth(texture2D(tex_depth, v_texcoord0 + vec2(-offset.x, 0.0)).r);
-    float dR = getLinearDepth(texture2D(tex_depth, v_texcoord0 + vec2( offset.x, 0.0)).r);
-    float dT = getLinearDepth(texture2D(tex_depth, v_texcoord0 + vec2(0.0,  offset.y)).r);
-    float dB = getLinearDepth(texture2D(tex_depth, v_texcoord0 + vec2(0.0, -offset.y)).r);
-
-    // 1. Grazing Angle Protection
-    float NdotV = clamp(normalC.z, 0.0, 1.0);
-    float threshold = u_ssao_params.y * (1.0 / max(NdotV, 0.1));
-
-    // 2. Convex (Outer) Normal Logic
-    // For an outer edge, the Left normal points Left (-X) and Right normal points Right (+X)
-    // So (Right.x - Left.x) will be a positive value.
-    float horizontalDelta = nR.x - nL.x;
-    float verticalDelta   = nT.y - nB.y;
-    
-    float outerNormalEdge = max(0.0, horizontalDelta) + max(0.0, verticalDelta);
-    outerNormalEdge = smoothstep(u_ssao_params.y, u_ssao_params.y * 2.0, outerNormalEdge);
-
-    // 3. Depth "Ridge" Check
-    // For an outer edge, the center pixel is CLOSER (smaller value) than the neighbors.
-    // Neighbors - Center = Positive Value
-    float depthRidge = ((dL + dR + dT + dB) * 0.25) - depthC;
-    
-    // Scale by depthC to keep sensitivity consistent with distance
-    float outerDepthEdge = smoothstep(threshold, threshold * 2.0, max(0.0, depthRidge) / depthC);
-
-    // 4. Combine and Filter
-    // We want to avoid silhouettes (where the background is very far away)
-    // If any neighbor is significantly further than the center, it's a silhouette/outer edge.
-    // If you ONLY want convex corners on a single object, we add a cap:
-    if (dL > depthC * 1.1 || dR > depthC * 1.1) {
-        // This suppresses edges against the far background
-        // outerDepthEdge *= 0.5; 
+    vec3 origin = toView(gl_FragCoord.xy, depth);
+    vec3 normal = normalize(texelFetch(tex_normal, texel, 0).xyz);
+
+    // Each texel of a 4x4 tile turns the kernel by another angle around the normal, the upsample averages the tile back out
+    vec3 random = vec3(texelFetch(tex_noise, ivec2(mod(gl_FragCoord.xy, 4.0)), 0).xy, 0.0);
+    vec3 tangent = normalize(random - normal * dot(random, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 tbn = mtxFromCols(tangent, bitangent, normal);
+
+    float radius = u_ssao_params.x;
+    float occlusion = 0.0;
+
+    for (int i = 0; i < SSAO_MAX_SAMPLES; i++) {
+        if (float(i) >= u_ssao_params.z)
+            break;
+
+        vec3 samplePos = origin + mul(tbn, u_kernel[i].xyz) * radius;
+        vec2 sampleTexel = toTexel(samplePos);
+
+        // Off screen counts as open
+        if (any(lessThan(sampleTexel, vec2(0.0, 0.0))) || any(greaterThanEqual(sampleTexel, u_ssao_target.xy)))
+            continue;
+
+        float sceneDepth = texelFetch(tex_depth, ivec2(sampleTexel), 0).r;
+        if (sceneDepth <= 0.0)
+            continue;
+
+        // Surfaces far in front of the sample are a different object, not a crease
+        float range = smoothstep(0.0, 1.0, radius / max(abs(depth - sceneDepth), 0.0001));
+        occlusion += step(sceneDepth, -samplePos.z - u_ssao_params.y) * range;
     }
 
-    float edge = max(outerNormalEdge, outerDepthEdge);
-    
-    gl_FragColor = vec4(vec3_splat(1.0 - clamp(edge, 0.0, 1.0)), 1.0);
+    float ao = 1.0 - occlusion / max(u_ssao_params.z, 1.0) * u_ssao_params.w;
+
+    gl_FragColor = vec4(vec3_splat(clamp(ao, 0.0, 1.0)), 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+$input v_texcoord0
+
+#include "common.sh"
+
+SAMPLER2D(tex_normal, 0);
+SAMPLER2D(tex_depth,  1);
+
+// World to view transform, normals leave this pass in view space
+uniform mat4 u_ssao_view;
+// x: projection [2][2], y: projection [3][2], z: 1 when depth maps from -1 to 1, w: 1 for perspective
+uniform vec4 u_ssao_depth;
+// xy: gbuffer size in texels, z: gbuffer texels per reduced texel
+uniform vec4 u_ssao_source;
+
+float getLinearDepth(float _rawDepth)
+{
+    float ndc = mix(_rawDepth, _rawDepth * 2.0 - 1.0, u_ssao_depth.z);
+
+    if (u_ssao_depth.w > 0.5)
+        return u_ssao_depth.y / (ndc + u_ssao_depth.x);
+
+    return (u_ssao_depth.y - ndc) / u_ssao_depth.x;
+}
+
+void main() {
+    // Keeps the nearest corner of the gbuffer texels under this one, so thin foreground survives the reduction
+    int span = int(u_ssao_source.z) - 1;
+    ivec2 base = ivec2(gl_FragCoord.xy) * int(u_ssao_source.z);
+    ivec2 last = ivec2(u_ssao_source.xy) - ivec2(1, 1);
+
+    ivec2 t0 = min(base, last);
+    ivec2 t1 = min(base + ivec2(span, 0), last);
+    ivec2 t2 = min(base + ivec2(0, span), last);
+    ivec2 t3 = min(base + ivec2(span, span), last);
+
+    ivec2 best = t0;
+    float rawDepth = texelFetch(tex_depth, t0, 0).r;
+    float d1 = texelFetch(tex_depth, t1, 0).r;
+    float d2 = texelFetch(tex_depth, t2, 0).r;
+    float d3 = texelFetch(tex_depth, t3, 0).r;
+
+    if (d1 < rawDepth) { rawDepth = d1; best = t1; }
+    if (d2 < rawDepth) { rawDepth = d2; best = t2; }
+    if (d3 < rawDepth) { rawDepth = d3; best = t3; }
+
+    // Sky is stored at depth 0, the passes after this leave it unoccluded
+    if (rawDepth >= 1.0) {
+        gl_FragData[0] = vec4(0.0, 0.0, 1.0, 0.0);
+        gl_FragData[1] = vec4(0.0, 0.0, 0.0, 0.0);
+        return;
+    }
+
+    vec3 normal = normalize(mul(u_ssao_view, vec4(texelFetch(tex_normal, best, 0).xyz, 0.0)).xyz);
+
+    gl_FragData[0] = vec4(normal, 1.0);
+    gl_FragData[1] = vec4(getLinearDepth(rawDepth), 0.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+$input v_texcoord0
+
+#include "common.sh"
+
+SAMPLER2D(tex_ao,         0);
+SAMPLER2D(tex_low_depth,  1);
+SAMPLER2D(tex_low_normal, 2);
+SAMPLER2D(tex_depth,      3);
+SAMPLER2D(tex_normal,     4);
+
+// World to view transform, to compare gbuffer normals with the reduced ones
+uniform mat4 u_ssao_view;
+// x: projection [2][2], y: projection [3][2], z: 1 when depth maps from -1 to 1, w: 1 for perspective
+uniform vec4 u_ssao_depth;
+// xy: reduced size in texels, z: gbuffer texels per reduced texel, w: depth sharpness
+uniform vec4 u_ssao_upsample;
+
+float getLinearDepth(float _rawDepth)
+{
+    float ndc = mix(_rawDepth, _rawDepth * 2.0 - 1.0, u_ssao_depth.z);
+
+    if (u_ssao_depth.w > 0.5)
+        return u_ssao_depth.y / (ndc + u_ssao_depth.x);
+
+    return (u_ssao_depth.y - ndc) / u_ssao_depth.x;
+}
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float rawDepth = texelFetch(tex_depth, texel, 0).r;
+
+    // Ignore sky
+    if (rawDepth >= 1.0) {
+        gl_FragColor = vec4(1.0, 1.0, 1.0, 1.0);
+        return;
+    }
+
+    float depth = getLinearDepth(rawDepth);
+    vec3 normal = normalize(mul(u_ssao_view, vec4(texelFetch(tex_normal, texel, 0).xyz, 0.0)).xyz);
+
+    // The 4x4 reduced texels around this one, which also covers one whole noise tile
+    vec2 center = gl_FragCoord.xy / u_ssao_upsample.z;
+    ivec2 first = ivec2(floor(center - 0.5)) - ivec2(1, 1);
+    ivec2 last = ivec2(u_ssao_upsample.xy) - ivec2(1, 1);
+
+    float total = 0.0;
+    float totalWeight = 0.0;
+
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            ivec2 tap = clamp(first + ivec2(x, y), ivec2(0, 0), last);
+            float tapDepth = texelFetch(tex_low_depth, tap, 0).r;
+
+            if (tapDepth <= 0.0)
+                continue;
+
+            vec2 distance = abs(vec2(tap) + 0.5 - center);
+            float spatial = max(0.0, 2.0 - distance.x) * max(0.0, 2.0 - distance.y);
+
+            // Taps across a depth or normal edge barely count, a small floor keeps a fully cut off texel blurred instead of black
+            float depthWeight = exp(-abs(tapDepth - depth) / depth * u_ssao_upsample.w);
+            float normalWeight = pow(max(dot(texelFetch(tex_low_normal, tap, 0).xyz, normal), 0.0), 8.0);
+            float weight = spatial * (depthWeight * normalWeight + 0.001);
+
+            total += texelFetch(tex_ao, tap, 0).r * weight;
+            totalWeight += weight;
+        }
+    }
+
+    float ao = (totalWeight > 0.0) ? total / totalWeight : 1.0;
+
+    gl_FragColor = vec4(vec3_splat(ao), 1.0);
+}
\ No newline at end of file
@@ -24,6 +24,7 @@ namespace gbe::ext::AnitoBuilder {
 		ceiling_parent->PushEditorFlag(Object::EditorFlags::STATIC_SCALE);
 		ceiling_parent->SetParent(this);
 		ceiling_parent->Local().position.Set(Vector3(0, this->height, 0));
+		ceiling_moved_seen = ceiling_parent->GetStateVersion(Object::ObjectStateName::TRANSFORMED_USER);
 
 		//MATERIAL SETUP
 		def_material = asset::Material::GetAssetById("plaster");
@@ -682,7 +683,7 @@ namespace gbe::ext::AnitoBuilder {
 	void BuilderBlock::InvokeUpdate(float deltatime) {
 
 		//ROOF MOVING
-		bool roof_moved = this->ceiling_parent->CheckState(Object::ObjectStateName::TRANSFORMED_USER, this);
+		bool roof_moved = this->ceiling_parent->CheckState(Object::ObjectStateName::TRANSFORMED_USER, this->ceiling_moved_seen);
 		if (roof_moved) {
 			this->height = this->ceiling_parent->Local().position.Get().y;
 			SetModelShown(false);
@@ -702,7 +703,7 @@ namespace gbe::ext::AnitoBuilder {
 			{
 				auto& l = GetHandle(s, i);
 
-				bool moved = this->handle_pool[l.handleindex]->CheckState(Object::ObjectStateName::TRANSFORMED_USER, this);
+				bool moved = this->handle_pool[l.handleindex]->CheckState(Object::ObjectStateName::TRANSFORMED_USER, this->handle_moved_seen[l.handleindex]);
 
 				if (!moved)
 					continue;
@@ -923,6 +924,7 @@ namespace gbe::ext::AnitoBuilder {
 			auto handle = new BuilderBlockFace(this, handle_pool.size());
 
 			handle_pool.push_back(handle);
+			handle_moved_seen.push_back(handle->GetStateVersion(Object::ObjectStateName::TRANSFORMED_USER));
 			handle->SetParent(this);
 
 			handle->PushEditorFlag(Object::EditorFlags::STATIC_POS_Y);
@@ -1014,6 +1016,7 @@ namespace gbe::ext::AnitoBuilder {
 					handle_pool[idx]->Destroy();
 				}
 				handle_pool.erase(handle_pool.begin() + idx);
+				handle_moved_seen.erase(handle_moved_seen.begin() + idx);
 
 				// Re-index all face references across all sets
 				for (auto& s : data.sets) {
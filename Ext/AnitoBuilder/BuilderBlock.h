@@ -107,6 +107,9 @@ namespace gbe::ext::AnitoBuilder {
 		BuilderBlockData data;
 
 		std::vector<BuilderBlockFace*> handle_pool;
+		//Last TRANSFORMED_USER version seen of the ceiling and of each pooled handle, by pool index
+		uint32_t ceiling_moved_seen = 0;
+		std::vector<uint32_t> handle_moved_seen;
 		std::vector<SetRoof> roof_pool;
 
 		void UpdateModelShown();
@@ -3,6 +3,10 @@
 #include "Graphics/gbe_graphics.h"
 
 #include <random> // Added for SSAO kernel generation
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
 #include "Math/gbe_math.h"
 
 const auto DestroyTextureData = [](gbe::gfx::TextureData& _data) {
@@ -12,81 +16,197 @@ const auto DestroyTextureData = [](gbe::gfx::TextureData& _data) {
 	}
 	};
 
+//Order independent digest of the casters a shadow view would draw.
+//Changes when a caster moves, appears or leaves the view, since every move gives the instance a new stamp
+const auto ShadowCasterSignature = [](const gbe::gfx::GraphicsRenderInfo& passinfo, const gbe::gfx::GraphicsRenderInfo::VisibleSet* casters) {
+	const auto mix = [](uint64_t x) {
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+		};
+	const uint64_t group_bit = gbe::gfx::GraphicsRenderInfo::GroupBit(0);
+
+	uint64_t sum = 0;
+	uint64_t count = 0;
+	for (size_t s = 0; s < passinfo.prepared_slices.size(); s++)
+	{
+		const auto& slice = passinfo.prepared_slices[s];
+
+		if (!slice.drawcall->get_materialdata()->getShadowcaster())
+			continue;
+
+		uint32_t begin = (casters != nullptr) ? casters->slice_offsets[s] : slice.begin;
+		uint32_t end = (casters != nullptr) ? casters->slice_offsets[s + 1] : slice.end;
+
+		for (uint32_t k = begin; k < end; k++)
+		{
+			const auto& prepared = passinfo.prepared[(casters != nullptr) ? casters->indices[k] : k];
+
+			if ((prepared.group_mask & group_bit) == 0)
+				continue;
+
+			sum += mix(((uint64_t)prepared.instance_id << 32) ^ prepared.change_stamp);
+			count++;
+		}
+	}
+
+	return mix(sum ^ mix(count));
+	};
+
+//Digest of every light attribute a pass reads, changes when a light is edited, moved, added or removed
+const auto LightSignature = [](const std::vector<gbe::gfx::Light*>& lights) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const auto mix = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		};
+
+	for (const auto light : lights)
+	{
+		mix(&light, sizeof(light));
+		mix(&light->position, sizeof(light->position));
+		mix(&light->direction, sizeof(light->direction));
+		mix(&light->color, sizeof(light->color));
+		mix(&light->type, sizeof(light->type));
+		mix(&light->override_dist, sizeof(light->override_dist));
+		mix(&light->dir_backtrack_dist, sizeof(light->dir_backtrack_dist));
+		mix(&light->cascade_count, sizeof(light->cascade_count));
+		mix(&light->cascade_lambda, sizeof(light->cascade_lambda));
+		mix(&light->shadow_distance, sizeof(light->shadow_distance));
+		mix(&light->angle_inner_deg, sizeof(light->angle_inner_deg));
+		mix(&light->angle_outer_deg, sizeof(light->angle_outer_deg));
+		//Directional lights derive near_clip from their cascades every frame, it is not an input for them
+		if (light->type != gbe::gfx::Light::DIRECTIONAL)
+			mix(&light->near_clip, sizeof(light->near_clip));
+		mix(&light->range, sizeof(light->range));
+		mix(&light->square_project, sizeof(light->square_project));
+		mix(&light->bias_min, sizeof(light->bias_min));
+		mix(&light->bias_mult, sizeof(light->bias_mult));
+	}
+
+	return hash;
+	};
+
 gbe::gfx::bgfx_gab::ForwardRenderer::ForwardRenderer(const GraphicsRenderInfo& passinfo) {
 	m_line_vbh = bgfx::createDynamicVertexBuffer(passinfo.max_lines, s_VERTEXLAYOUT, BGFX_BUFFER_NONE);
 
-	// 1. Create a single Texture Array (10 layers)
-	// The 'max_lights' parameter here defines the number of layers
-	m_shadowArrayTexture = bgfx::createTexture2D(
-		shadow_map_resolution,
-		shadow_map_resolution,
+	m_instance_layout
+		.begin()
+		.add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+		.add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
+		.add(bgfx::Attrib::TexCoord5, 4, bgfx::AttribType::Float)
+		.add(bgfx::Attrib::TexCoord4, 4, bgfx::AttribType::Float)
+		.end();
+
+	// 1. One depth atlas shared by every shadow view, each view draws into its own tile
+	m_shadowAtlasTexture = bgfx::createTexture2D(
+		(uint16_t)m_shadow_atlas.GetAtlasSize(),
+		(uint16_t)m_shadow_atlas.GetAtlasSize(),
 		false,
-		max_lights,
+		1,
 		bgfx::TextureFormat::D16,
 		BGFX_TEXTURE_RT | BGFX_SAMPLER_U_CLAMP | BGFX_SAMPLER_V_CLAMP
 	);
+	m_shadowAtlasFB = bgfx::createFrameBuffer(1, &m_shadowAtlasTexture, false);
 
-	// 2. Create one single sampler uniform for the array
-	m_shadowArraySampler = bgfx::createUniform("light_map", bgfx::UniformType::Sampler);
+	// 2. Create one single sampler uniform for the atlas
+	m_shadowAtlasSampler = bgfx::createUniform("light_map", bgfx::UniformType::Sampler);
 
-	// 3. Create a FrameBuffer for EACH layer
-	m_shadowbuffers.resize(max_lights);
-	for (int i = 0; i < max_lights; ++i) {
-		bgfx::Attachment at;
-		// init(handle, access, layer, mip, resolve)
-		at.init(m_shadowArrayTexture, bgfx::Access::Write, (uint16_t)i);
-
-		// Use the Attachment overload of createFrameBuffer
-		m_shadowbuffers[i] = bgfx::createFrameBuffer(1, &at, false);
-	}
+	m_shadow_cache.resize(max_shadow_layers);
 
-	for (size_t i = VIEW_SHADOW_PASS; i < 20; i++)
+	for (size_t i = VIEW_SHADOW_PASS; i < VIEW_SHADOW_PASS_END; i++)
 	{
 		available_views.push_back(i);
 	}
 
-	m_debugShadowTextures.resize(max_lights);
-	for (int i = 0; i < max_lights; ++i) {
-		m_debugShadowTextures[i] = TextureData{
-			.textureHandle = bgfx::createTexture2D(
-				shadow_map_resolution,
-				shadow_map_resolution,
-				false, 1,
-				bgfx::TextureFormat::D16,
-				BGFX_TEXTURE_BLIT_DST // Required for blitting
-			)
-		};
+	shadow_mtx_arr.resize(max_shadow_layers);
+	shadow_tile_arr.resize(max_shadow_layers);
+
+	// 3. Lights and their clusters live in point sampled float textures, read with texelFetch by the lit shader
+	const uint64_t lookup_flags = BGFX_SAMPLER_POINT | BGFX_SAMPLER_UVW_CLAMP;
+	m_lightDataTexture = bgfx::createTexture2D(LIGHT_TEXELS, (uint16_t)max_lights, false, 1, bgfx::TextureFormat::RGBA32F, lookup_flags);
+	m_lightClusterTexture = bgfx::createTexture2D(LightClusters::GRID_X * LightClusters::GRID_Y, LightClusters::GRID_Z, false, 1, bgfx::TextureFormat::RG32F, lookup_flags);
+	uint32_t index_rows = (uint32_t)((LightClusters::GetIndexCapacity() + max_lights + LightClusters::INDEX_TEXTURE_WIDTH - 1) / LightClusters::INDEX_TEXTURE_WIDTH);
+	m_lightIndexTexture = bgfx::createTexture2D(LightClusters::INDEX_TEXTURE_WIDTH, (uint16_t)index_rows, false, 1, bgfx::TextureFormat::R32F, lookup_flags);
+
+	m_lightDataSampler = bgfx::createUniform("light_data", bgfx::UniformType::Sampler);
+	m_lightClusterSampler = bgfx::createUniform("light_clusters", bgfx::UniformType::Sampler);
+	m_lightIndexSampler = bgfx::createUniform("light_indices", bgfx::UniformType::Sampler);
+
+	frame_block.resize(1 + max_shadow_layers * 5);
+	frame_block_uniform = UniformCache::Resolve("u_frame", bgfx::UniformType::Vec4, (uint16_t)frame_block.size());
+	tex_ao_uniform = UniformCache::Resolve("tex_ao", bgfx::UniformType::Sampler);
 
-		TextureLoader::Register("shadowmap_" + std::to_string(i), m_debugShadowTextures[i]);
+	//Far everywhere until a readback lands, so a renderer that never writes it culls nothing
+	m_hiz_readback_data.resize(HIZ_READBACK_SIZE * HIZ_READBACK_SIZE, 1.0f);
+
+	//Kept in submission order so uniforms sent once hold for every later draw
+	bgfx::setViewMode(VIEW_SCENE_PASS, bgfx::ViewMode::Sequential);
+
+	BuildSsaoKernel();
+
+	// 4. Random rotations of the SSAO kernel around the normal, as cos and sin
+	std::uniform_real_distribution<float> randomAngles(0.0f, 2.0f * 3.14159265f);
+	std::default_random_engine generator;
+	float noise[4 * 4 * 2];
+	for (int i = 0; i < 4 * 4; ++i) {
+		float angle = randomAngles(generator);
+		noise[i * 2] = std::cos(angle);
+		noise[i * 2 + 1] = std::sin(angle);
 	}
+	m_ssaoNoiseTexture = TextureData{
+		.textureHandle = bgfx::createTexture2D(4, 4, false, 1, bgfx::TextureFormat::RG32F, lookup_flags, bgfx::copy(noise, sizeof(noise)))
+	};
+}
+
+void gbe::gfx::bgfx_gab::ForwardRenderer::BuildSsaoKernel()
+{
+	const int count = SSAO_MAX_SAMPLES / ssao_quality;
 
-	light_view_arr.resize(max_lights);
-	light_proj_arr.resize(max_lights);
-	light_color_arr.resize(max_lights);
-	light_pos_arr.resize(max_lights);
-	light_type_arr.resize(max_lights);
-	light_is_square_arr.resize(max_lights);
-	light_nearclip_arr.resize(max_lights);
-	light_range_arr.resize(max_lights);
-	light_bias_min_arr.resize(max_lights);
-	light_bias_mult_arr.resize(max_lights);
-	light_cone_inner_arr.resize(max_lights);
-	light_cone_outer_arr.resize(max_lights);
-
-	// Generate 64 random samples in a hemisphere
-	m_ssao_kernel_data.resize(64);
+	// Random samples in a hemisphere, packed closer to the center the earlier they come
+	m_ssao_kernel_data.assign(SSAO_MAX_SAMPLES, Vector4(0, 0, 0, 0));
 	std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
 	std::default_random_engine generator;
-	for (unsigned int i = 0; i < 64; ++i) {
+	for (int i = 0; i < count; ++i) {
 		Vector3 sample(randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator));
 		sample.Normalize();
 		sample *= randomFloats(generator);
-		float scale = (float)i / 64.0f;
+		float scale = (float)i / count;
 		scale = 0.1f + scale * scale * (1.0f - 0.1f); // Lerp for distribution
 		m_ssao_kernel_data[i] = Vector4(sample.x * scale, sample.y * scale, sample.z * scale, 0.0f);
 	}
 }
 
+void gbe::gfx::bgfx_gab::ForwardRenderer::SetSsaoQuality(SSAO_QUALITY quality)
+{
+	if (quality == ssao_quality)
+		return;
+
+	ssao_quality = quality;
+	BuildSsaoKernel();
+
+	//Only rebuilt here once a frame exists, ReloadFrame makes it otherwise
+	if (bgfx::isValid(ssao_buffer.m_resolveFB)) {
+		DestroySsaoBuffer();
+		ssao_buffer = SsaoBuffer((uint16_t)resolution.x, (uint16_t)resolution.y, ssao_quality);
+	}
+
+	m_frame_valid = false;
+}
+
+void gbe::gfx::bgfx_gab::ForwardRenderer::DestroySsaoBuffer()
+{
+	for (auto fb : { ssao_buffer.m_reducedFB, ssao_buffer.m_aoFB, ssao_buffer.m_resolveFB }) {
+		if (bgfx::isValid(fb)) bgfx::destroy(fb);
+	}
+	DestroyTextureData(ssao_buffer.m_normalTexture);
+	DestroyTextureData(ssao_buffer.m_depthTexture);
+	DestroyTextureData(ssao_buffer.m_aoTexture);
+	DestroyTextureData(ssao_buffer.m_resolveTexture);
+	ssao_buffer = SsaoBuffer();
+}
+
 void gbe::gfx::bgfx_gab::ForwardRenderer::InitializeAssetRequests()
 {
 	//Register Line Drawcall
@@ -98,12 +218,13 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::InitializeAssetRequests()
 	ssao_shader = ShaderLoader::GetAssetRuntimeData("ssao");
 	outline_shader = ShaderLoader::GetAssetRuntimeData("outline");
 	gbuffer_shader = ShaderLoader::GetAssetRuntimeData("gbuffer");
-	bilateralblur_shader = ShaderLoader::GetAssetRuntimeData("bilateralblur");
+	ssaodownsample_shader = ShaderLoader::GetAssetRuntimeData("ssaodownsample");
+	ssaoupsample_shader = ShaderLoader::GetAssetRuntimeData("ssaoupsample");
 	bufferblend_shader = ShaderLoader::GetAssetRuntimeData("bufferblend");
-	id_shader = ShaderLoader::GetAssetRuntimeData("id");
-	uv_shader = ShaderLoader::GetAssetRuntimeData("uv");
+	pick_shader = ShaderLoader::GetAssetRuntimeData("pick");
 	skybox_shader = ShaderLoader::GetAssetRuntimeData("gradientskybox");
 	floorgrid_shader = ShaderLoader::GetAssetRuntimeData("floorgrid");
+	hizdownsample_shader = ShaderLoader::GetAssetRuntimeData("hizdownsample");
 }
 
 void gbe::gfx::bgfx_gab::ForwardRenderer::CleanUp()
@@ -129,8 +250,8 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::CleanUp()
 	destroyGBuffer(gbuffer_all);
 	destroyGBuffer(gbuffer_selected);
 
-	// 3. Destroy SSAO texture
-	DestroyTextureData(m_ssaoTexture);
+	// 3. Destroy SSAO targets
+	DestroySsaoBuffer();
 
 	// 4. Destroy Color/Depth Buffers
 	auto destroyCDBuffer = [](ColorDepthBuffer& _cdb) {
@@ -140,8 +261,25 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::CleanUp()
 		_cdb.m_mainPassFBO = BGFX_INVALID_HANDLE;
 		};
 	destroyCDBuffer(mainscene_buffer);
-	destroyCDBuffer(uv_buffer);
-	destroyCDBuffer(id_buffer);
+
+	if (bgfx::isValid(pick_buffer.m_pickFB)) bgfx::destroy(pick_buffer.m_pickFB);
+	DestroyTextureData(pick_buffer.m_idTexture);
+	DestroyTextureData(pick_buffer.m_uvTexture);
+	DestroyTextureData(pick_buffer.m_depthTexture);
+	pick_buffer.m_pickFB = BGFX_INVALID_HANDLE;
+
+	// 5. Destroy the depth pyramid, its old depths no longer match the screen
+	for (auto& level : m_hiz_levels) {
+		if (bgfx::isValid(level.fb)) bgfx::destroy(level.fb);
+		DestroyTextureData(level.texture);
+	}
+	m_hiz_levels.clear();
+	DestroyTextureData(m_hiz_readback);
+	m_hiz_pending = false;
+	m_occlusion.Invalidate();
+
+	//Every target is gone, the next frame draws all of them
+	m_frame_valid = false;
 }
 
 gbe::gfx::Renderer::CpuDataResponse gbe::gfx::bgfx_gab::ForwardRenderer::PreprocessCpuRequest(CpuDataRequest request)
@@ -158,70 +296,147 @@ gbe::gfx::Renderer::CpuDataResponse gbe::gfx::bgfx_gab::ForwardRenderer::Preproc
 	};
 }
 
-
-void gbe::gfx::bgfx_gab::ForwardRenderer::RenderFrame(const SceneRenderInfo& frameinfo, GraphicsRenderInfo& passinfo)
+void gbe::gfx::bgfx_gab::ForwardRenderer::UploadInstanceBatches(GraphicsRenderInfo& passinfo)
 {
-	//helper function for drawbatch
-	const auto drawbatch = [&passinfo](DrawCall* drawcall, int rendergroup) {
-		std::vector<uint32_t> instances;
+	const uint32_t stride = m_instance_layout.getStride();
+	passinfo.instances_uploaded = 0;
 
-		for (const auto& instanceid : passinfo.callgroups[drawcall])
-		{
-			const auto& info = passinfo.infomap[instanceid];
+	for (auto& pair : passinfo.callgroups)
+	{
+		auto& batch = pair.second;
+		uint32_t count = (uint32_t)batch.matrices.size();
 
-			if(!info.enabled)
-				continue;
+		//Forget the flags too, or entries registered after it empties would never be marked again
+		if (count == 0) {
+			batch.ClearDirty();
+			continue;
+		}
 
-			auto rendergroup_it = info.rendergroups.find(rendergroup);
+		//Grow by doubling, a new buffer has to be filled whole
+		if (batch.buffer_capacity < count) {
+			if (bgfx::isValid(batch.buffer))
+				bgfx::destroy(batch.buffer);
 
-			if (rendergroup_it != info.rendergroups.end())
-				if (rendergroup_it->second)
-					instances.push_back(instanceid);
+			batch.buffer_capacity = std::max<uint32_t>(64, std::bit_ceil(count));
+			batch.buffer = bgfx::createDynamicVertexBuffer(batch.buffer_capacity, m_instance_layout, BGFX_BUFFER_NONE);
+			batch.all_dirty = true;
 		}
-		
-		// 1. Get the number of instances
-		uint32_t instanceCount = (uint32_t)instances.size();
-		if (instanceCount == 0) return false;
 
-		// 3. Bind Mesh
-		const auto& curmesh = drawcall->get_meshdata();
+		batch.TakeDirtyRanges(count, [&](uint32_t begin, uint32_t end) {
+			bgfx::update(batch.buffer, begin, bgfx::copy(&batch.matrices[begin], (end - begin) * stride));
+			passinfo.instances_uploaded += end - begin;
+			});
+	}
+}
+
+void gbe::gfx::bgfx_gab::ForwardRenderer::RenderScene(const SceneRenderInfo& frameinfo, GraphicsRenderInfo& passinfo, bool depth_dirty, bool lights_dirty)
+{
+	//helper function for drawbatch, reads one drawcall's slice of the prepared instances
+	//A visible set limits it to the instances that survived that view's culling
+	const auto drawbatch = [&passinfo](size_t slice_index, int rendergroup, const GraphicsRenderInfo::VisibleSet* visible) {
+		const auto& slice = passinfo.prepared_slices[slice_index];
+		const auto& batch = *slice.batch;
+		uint32_t group_count = batch.GroupCount(rendergroup);
+
+		if (group_count == 0 || !bgfx::isValid(batch.buffer))
+			return false;
+
+		const uint32_t slice_count = slice.end - slice.begin;
+		const uint32_t* run = nullptr;
+		uint32_t run_count = slice_count;
+
+		if (visible != nullptr) {
+			run = visible->indices.data() + visible->slice_offsets[slice_index];
+			run_count = visible->SliceCount(slice_index);
+		}
+
+		const auto prepared_at = [&](uint32_t k) {
+			return (run != nullptr) ? run[k] : slice.begin + k;
+			};
+		const uint64_t group_bit = GraphicsRenderInfo::GroupBit(rendergroup);
+
+		uint32_t instanceCount = group_count;
+		if (run_count != slice_count) {
+			instanceCount = 0;
+			for (uint32_t k = 0; k < run_count; k++)
+			{
+				if (passinfo.prepared[prepared_at(k)].group_mask & group_bit)
+					instanceCount++;
+			}
+		}
+
+		if (instanceCount == 0)
+			return false;
+
+		const auto& curmesh = slice.drawcall->get_meshdata();
 		bgfx::setIndexBuffer(curmesh->index_vbh);
 		bgfx::setVertexBuffer(0, curmesh->vertex_vbh);
 
-		// 2. Allocate an Instance Data Buffer
+		//Every enabled instance is visible and in the group, draw straight from the persistent buffer
+		if (instanceCount == slice_count) {
+			bgfx::setInstanceDataBuffer(batch.buffer, 0, instanceCount);
+			return true;
+		}
+
+		//Only part of the slice is drawn, gather its matrices into a transient buffer
 		// We need 64 bytes (16 floats) per instance for a Matrix4
 		bgfx::InstanceDataBuffer idb;
 		uint32_t stride = 64;
 		bgfx::allocInstanceDataBuffer(&idb, instanceCount, stride);
 
-		// 3. Fill the buffer with your matrices
 		uint8_t* data = idb.data;
-		for (const auto& call_ptr : instances)
+		for (uint32_t k = 0; k < run_count; k++)
 		{
-			Matrix4 modelMatrix = passinfo.infomap[call_ptr].transform;
-			memcpy(data, &modelMatrix, stride);
+			const auto& prepared = passinfo.prepared[prepared_at(k)];
+
+			if ((prepared.group_mask & group_bit) == 0)
+				continue;
+
+			memcpy(data, prepared.matrix, stride);
 			data += stride;
 		}
 
-		// 4. Set geometry and the instance buffer
-		bgfx::setIndexBuffer(curmesh->index_vbh);
-		bgfx::setVertexBuffer(0, curmesh->vertex_vbh);
 		bgfx::setInstanceDataBuffer(&idb); // This replaces setTransform!
 
 		return true;
 		};
 
-	const auto drawbuffer = [&passinfo, &frameinfo, drawbatch, this](RenderViewId viewid, int rendergroup, ShaderData* _shader) {
+	//================== CULLING ========================//
+	passinfo.cull_stats.clear();
+
+	GraphicsRenderInfo::VisibleSet camera_visible;
+	passinfo.Cull(Frustum::FromMatrix(frameinfo.projmat * frameinfo.viewmat), camera_visible);
+	passinfo.cull_stats.push_back({ "Camera", camera_visible.indices.size(), camera_visible.culled });
+
+	//A depth pyramid read back from an earlier frame has arrived, later frames are tested against it
+	if (m_hiz_pending && !m_hiz_levels.empty() && passinfo.frame_id >= m_hiz_frame_done) {
+		const auto caps = bgfx::getCaps();
+		const auto& last = m_hiz_levels.back();
+		//Level i of the chain is the screen halved i + 1 times
+		m_occlusion.Update(m_hiz_readback_data.data(), last.width, last.height, (uint32_t)resolution.x, (uint32_t)resolution.y, (uint32_t)m_hiz_levels.size(),
+			m_hiz_pending_viewproj, caps->originBottomLeft, caps->homogeneousDepth);
+		m_occlusion_viewproj = m_hiz_pending_viewproj;
+		m_occlusion_scene_version = m_hiz_pending_scene_version;
+		m_hiz_pending = false;
+	}
+
+	//Boxes are projected with the camera of the pyramid's frame, so they land where that depth was drawn
+	//Objects it hid show up again a readback late once they come out, the selection outline still draws them
+	m_occluded_visible = camera_visible;
+	if (m_occlusion.IsValid()) {
+		size_t occluded = m_occlusion.Filter(passinfo.prepared_bounds, m_occluded_visible.indices);
+		passinfo.FillSliceOffsets(m_occluded_visible);
+		passinfo.cull_stats.push_back({ "Occlusion", m_occluded_visible.indices.size(), occluded });
+	}
+
+	const auto drawbuffer = [&passinfo, &frameinfo, drawbatch, this](RenderViewId viewid, int rendergroup, ShaderData* _shader, const GraphicsRenderInfo::VisibleSet& visible) {
 		bgfx::setViewClear(viewid, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x000000ff, 1.0f, 0);
 		bgfx::setViewTransform(viewid, (const float*)&frameinfo.viewmat, (const float*)&frameinfo.projmat);
 
 		bool submitted = false;
 
-		for (const auto& shaderset : passinfo.callgroups) {
-			if (shaderset.second.size() == 0)
-				continue;
-
-			if (drawbatch(shaderset.first, rendergroup)) {
+		for (size_t s = 0; s < passinfo.prepared_slices.size(); s++) {
+			if (drawbatch(s, rendergroup, &visible)) {
 				bgfx::setState(BGFX_STATE_DEFAULT);
 				bgfx::submit(viewid, _shader->programHandle);
 				submitted = true;
@@ -233,178 +448,444 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::RenderFrame(const SceneRenderInfo& fra
 		}
 		};
 
-	const auto drawgbuffer = [&drawbuffer, drawbatch, this](GBuffer& buffer, int rendergroup) {
-		drawbuffer(buffer.viewId, rendergroup, gbuffer_shader);
+	const auto drawgbuffer = [&drawbuffer, drawbatch, this](GBuffer& buffer, int rendergroup, const GraphicsRenderInfo::VisibleSet& visible) {
+		drawbuffer(buffer.viewId, rendergroup, gbuffer_shader, visible);
 		};
 
 	// BGFX: Frame submission must start with a `bgfx::touch` or `bgfx::frame`
 	bgfx::touch(VIEW_SCREEN_PASS); // Touch one view to start frame
 
-	//================== 1. G-BUFFER PRE-PASS (For SSAO) ========================//
-	drawgbuffer(gbuffer_all, 0);
-	drawgbuffer(gbuffer_selected, 1); // outline pass for gbuffer
-	//================== CPU PASS ========================//
-	const auto drawcpubuffer = [&](RenderViewId viewid, std::function<void(uint32_t)> submitfunc) {
-		bgfx::setViewClear(viewid, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x000000ff, 1.0f, 0);
-		bgfx::setViewTransform(viewid, (const float*)&frameinfo.viewmat, (const float*)&frameinfo.projmat);
-		for (const auto& shaderset : passinfo.callgroups) {
-			auto drawcall = shaderset.first;
-			std::vector<uint32_t> instances;
-
-			for (const auto& instanceid : passinfo.callgroups[drawcall])
+	//Nothing these passes draw from has changed, their targets still hold the last frame's result
+	//A view without submits or touch is not executed by bgfx, so not even its clear runs
+	if (depth_dirty) {
+		//================== 1. G-BUFFER PRE-PASS (For SSAO) ========================//
+		drawgbuffer(gbuffer_all, 0, m_occluded_visible);
+		drawgbuffer(gbuffer_selected, 1, camera_visible); // outline pass for gbuffer
+
+		//================== HI-Z PYRAMID ========================//
+		//Built from the gbuffer depth only once the last readback has landed, the CPU reduces the read back level further
+		//Skipped once the applied pyramid already comes from this camera and scene, so a still frame settles
+		const Matrix4 viewproj = frameinfo.projmat * frameinfo.viewmat;
+		const bool hiz_current = m_occlusion.IsValid() && m_occlusion_viewproj == viewproj && m_occlusion_scene_version == passinfo.scene_version;
+		if (!m_hiz_pending && !hiz_current && !m_hiz_levels.empty() && bgfx::isValid(m_hiz_readback.textureHandle)) {
+			TextureData* source = &gbuffer_all.m_gbufferDepth;
+			Vector4 source_size((float)resolution.x, (float)resolution.y, 0, 0);
+
+			for (size_t i = 0; i < m_hiz_levels.size(); i++)
 			{
-				const auto& info = passinfo.infomap[instanceid];
-
-				if (!info.enabled)
-					continue;
-
-				const auto check_group = [=](int group) {
-					auto rendergroup_it = info.rendergroups.find(group);
-					if (rendergroup_it != info.rendergroups.end())
-						return rendergroup_it->second;
+				auto& level = m_hiz_levels[i];
+				bgfx::ViewId view = (bgfx::ViewId)(VIEW_HIZ_PASS + i);
 
-					return false;
-					};
+				bgfx::setViewTransform(view, nullptr, nullptr);
+				hizdownsample_shader->ApplyTextureOverride(source, "tex_depth", 0);
+				hizdownsample_shader->ApplyOverride(source_size, "u_hiz_params");
+				RenderFullscreenPass(view, hizdownsample_shader->programHandle);
 
-				if (check_group(0) || check_group(1))
-					instances.push_back(instanceid);
+				source = &level.texture;
+				source_size = Vector4((float)level.width, (float)level.height, 0, 0);
 			}
 
-			// 1. Get the number of instances
-			uint32_t instanceCount = (uint32_t)instances.size();
-			if (instanceCount == 0) continue;
+			const auto& last = m_hiz_levels.back();
+			std::fill(m_hiz_readback_data.begin(), m_hiz_readback_data.end(), 1.0f);
+			bgfx::blit(
+				VIEW_DEBUG_BLITTER,
+				m_hiz_readback.textureHandle,
+				0, 0, 0, 0,
+				last.texture.textureHandle,
+				0, 0, 0, 0,
+				last.width,
+				last.height
+			);
 
-			// 3. Bind Mesh
-			const auto& curmesh = drawcall->get_meshdata();
-			for (const auto& call_ptr : instances)
-			{
-				bgfx::setIndexBuffer(curmesh->index_vbh);
-				bgfx::setVertexBuffer(0, curmesh->vertex_vbh);
+			m_hiz_frame_done = bgfx::readTexture(m_hiz_readback.textureHandle, m_hiz_readback_data.data());
+			m_hiz_pending_viewproj = viewproj;
+			m_hiz_pending_scene_version = passinfo.scene_version;
+			m_hiz_pending = true;
+		}
+		Vector4 cam_params(frameinfo.nearclip, frameinfo.farclip, (float)resolution.x, (float)resolution.y);
+		//================== OUTLINE PASS ========================//
+		InitPP(outline_shader, VIEW_OUTLINE_SELECTED_PASS);
+		outline_shader->ApplyTextureOverride(&gbuffer_selected.m_gbufferNormal, "tex_normal", 0);
+		outline_shader->ApplyTextureOverride(&gbuffer_selected.m_gbufferDepth, "tex_depth", 1);
+		Vector4 outline_params(0.09, 0.01f, 0, 0);
+		outline_shader->ApplyOverride(cam_params, "u_camera_params");
+		outline_shader->ApplyOverride(outline_params, "u_outline_params");
+		SubmitPP();
+		//================== SSAO ========================//
+		//Reduced gbuffer, occlusion at that size, then an edge aware upsample straight into the texture the lit pass reads
+		const auto caps = bgfx::getCaps();
+		const bool perspective = frameinfo.projmat[2][3] != 0;
+		Vector4 ssao_depth(frameinfo.projmat[2][2], frameinfo.projmat[3][2], caps->homogeneousDepth ? 1.0f : 0.0f, perspective ? 1.0f : 0.0f);
+
+		InitPP(ssaodownsample_shader, VIEW_SSAO_DOWNSAMPLE_PASS);
+		curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferNormal, "tex_normal", 0);
+		curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferDepth, "tex_depth", 1);
+		Vector4 ssao_source((float)resolution.x, (float)resolution.y, (float)ssao_buffer.scale, 0);
+		curppshader->ApplyOverride(frameinfo.viewmat, "u_ssao_view");
+		curppshader->ApplyOverride(ssao_depth, "u_ssao_depth");
+		curppshader->ApplyOverride(ssao_source, "u_ssao_source");
+		SubmitPP();
+
+		InitPP(ssao_shader, VIEW_SSAO_PASS);
+		curppshader->ApplyTextureOverride(&ssao_buffer.m_normalTexture, "tex_normal", 0);
+		curppshader->ApplyTextureOverride(&ssao_buffer.m_depthTexture, "tex_depth", 1);
+		curppshader->ApplyTextureOverride(&m_ssaoNoiseTexture, "tex_noise", 2);
+		curppshader->ApplyOverrideArray(m_ssao_kernel_data.data(), "u_kernel", SSAO_MAX_SAMPLES);
+		Vector4 ssao_params(0.5f, 0.025f, (float)(SSAO_MAX_SAMPLES / ssao_quality), 1.0f);
+		Vector4 ssao_proj(frameinfo.projmat[0][0], frameinfo.projmat[1][1], caps->originBottomLeft ? 0.0f : 1.0f, perspective ? 1.0f : 0.0f);
+		Vector4 ssao_target((float)ssao_buffer.width, (float)ssao_buffer.height, 0, 0);
+		curppshader->ApplyOverride(ssao_params, "u_ssao_params");
+		curppshader->ApplyOverride(ssao_proj, "u_ssao_proj");
+		curppshader->ApplyOverride(ssao_target, "u_ssao_target");
+		SubmitPP();
+
+		InitPP(ssaoupsample_shader, VIEW_SSAO_UPSAMPLE_PASS);
+		curppshader->ApplyTextureOverride(&ssao_buffer.m_aoTexture, "tex_ao", 0);
+		curppshader->ApplyTextureOverride(&ssao_buffer.m_depthTexture, "tex_low_depth", 1);
+		curppshader->ApplyTextureOverride(&ssao_buffer.m_normalTexture, "tex_low_normal", 2);
+		curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferDepth, "tex_depth", 3);
+		curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferNormal, "tex_normal", 4);
+		Vector4 ssao_upsample((float)ssao_buffer.width, (float)ssao_buffer.height, (float)ssao_buffer.scale, 32.0f);
+		curppshader->ApplyOverride(frameinfo.viewmat, "u_ssao_view");
+		curppshader->ApplyOverride(ssao_depth, "u_ssao_depth");
+		curppshader->ApplyOverride(ssao_upsample, "u_ssao_upsample");
+		SubmitPP();
+	}
 
-				// 2. Allocate an Instance Data Buffer
-				// We need 64 bytes (16 floats) per instance for a Matrix4
-				bgfx::InstanceDataBuffer idb;
-				uint32_t stride = 64;
-				bgfx::allocInstanceDataBuffer(&idb, 1, stride);
+	//==================SHADOW PASS [VIEW_SHADOW_PASS]========================//
+	//Every shadowed light asks for atlas tiles, one per cascade, sized by how much of the screen it can reach
+	GraphicsRenderInfo::VisibleSet shadow_visible;
+	passinfo.shadow_submissions = 0;
+	passinfo.shadow_layers_reused = 0;
 
-				// 3. Fill the buffer with your matrices
-				uint8_t* data = idb.data;
+	const Frustum camera_frustum = Frustum::FromMatrix(frameinfo.projmat * frameinfo.viewmat);
+	std::vector<ShadowAtlas::Request> shadow_requests;
+	std::vector<size_t> shadow_request_lights;
+	size_t requested_layers = 0;
 
-				Matrix4 modelMatrix = passinfo.infomap[call_ptr].transform;
-				memcpy(data, &modelMatrix, stride);
-				data += stride;
+	const size_t light_count = std::min(frameinfo.lightdatas.size(), (size_t)max_lights);
+	light_shadow_arr.assign(light_count, Vector4(-1, 0, 0, 0));
+	light_cascade_far_arr.assign(light_count, Vector4(FLT_MAX));
 
-				// 4. Set geometry and the instance buffer
-				bgfx::setIndexBuffer(curmesh->index_vbh);
-				bgfx::setVertexBuffer(0, curmesh->vertex_vbh);
-				bgfx::setInstanceDataBuffer(&idb); // This replaces setTransform!
+	for (size_t i = 0; i < light_count; i++)
+	{
+		const auto& light = frameinfo.lightdatas[i];
+		uint32_t layer_count = (uint32_t)light->GetShadowLayerCount();
+		if (layer_count == 0 || requested_layers + layer_count > std::min((size_t)max_shadow_layers, available_views.size()))
+			continue;
 
-				bgfx::setState(BGFX_STATE_DEFAULT);
+		//Fraction of the screen height the light's range spans, directional lights cover all of it
+		float coverage = 1.0f;
+		float importance = std::max({ light->color.x, light->color.y, light->color.z, 0.01f });
+		if (light->type == Light::DIRECTIONAL) {
+			importance *= 4.0f;
+		}
+		else {
+			//Nothing it reaches is on screen, so its shadow would never be sampled
+			if (!camera_frustum.Intersects(AABB(light->position - Vector3(light->range), light->position + Vector3(light->range))))
+				continue;
 
-				submitfunc(call_ptr);
+			float distance = (light->position - frameinfo.camera_pos).Magnitude();
+			if (distance > light->range) {
+				float tangent = light->range / std::sqrt(distance * distance - light->range * light->range);
+				coverage = std::clamp(tangent * frameinfo.projmat[1][1], 0.0f, 1.0f);
 			}
 		}
-		};
-
-	drawcpubuffer(VIEW_ID_PASS, [&](uint32_t call_id) {
-		id_shader->ApplyOverride(BRGA_t(call_id).ToVector4(), "id");
-		bgfx::submit(VIEW_ID_PASS, id_shader->programHandle);
-		});
-	drawcpubuffer(VIEW_UV_PASS, [&](uint32_t call_id) {
-		bgfx::submit(VIEW_UV_PASS, uv_shader->programHandle);
-		});
-	
-
-	Vector4 cam_params(frameinfo.nearclip, frameinfo.farclip, (float)resolution.x, (float)resolution.y);
-	//================== OUTLINE PASS ========================//
-	InitPP(outline_shader, VIEW_OUTLINE_SELECTED_PASS);
-	outline_shader->ApplyTextureOverride(&gbuffer_selected.m_gbufferNormal, "tex_normal", 0);
-	outline_shader->ApplyTextureOverride(&gbuffer_selected.m_gbufferDepth, "tex_depth", 1);
-	Vector4 outline_params(0.09, 0.01f, 0, 0);
-	outline_shader->ApplyOverride(cam_params, "u_camera_params");
-	outline_shader->ApplyOverride(outline_params, "u_outline_params");
-	SubmitPP();
-	//================== SSAO CALCULATION PASS ========================//
-	InitPP(ssao_shader, VIEW_SSAO_PASS);
-	curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferNormal,"tex_normal",0);
-	curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferDepth,"tex_depth",1);
-	curppshader->ApplyOverrideArray(m_ssao_kernel_data.data(), "u_kernel", 64);
-	Vector4 ssao_params(0.09, 0.01f, 0, 0);
-	curppshader->ApplyOverride(cam_params, "u_camera_params");
-	curppshader->ApplyOverride(ssao_params, "u_ssao_params");
-	SubmitPP();
-	float blurrad = 9;
-	float blur_sharpness = 5;
-	InitPP(bilateralblur_shader, VIEW_BLUR0_PASS);
-	curppshader->ApplyTextureOverride(&m_pp_textures[VIEW_SSAO_PASS], "s_tex_input", 0);
-	curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferDepth, "s_tex_depth", 1);
-	Vector4 blur_h_params(blurrad, blur_sharpness, 1.0f, 0.0f); // Direction: Horizontal (1,0)
-	curppshader->ApplyOverride(cam_params, "u_camera_params");
-	curppshader->ApplyOverride(blur_h_params, "u_blur_params");
-	SubmitPP();
-	InitPP(bilateralblur_shader, VIEW_BLUR1_PASS);
-	curppshader->ApplyTextureOverride(&m_pp_textures[VIEW_BLUR0_PASS], "s_tex_input", 0);
-	curppshader->ApplyTextureOverride(&gbuffer_all.m_gbufferDepth, "s_tex_depth", 1);
-	Vector4 blur_v_params(blurrad, blur_sharpness, 0.0f, 1.0f);
-	curppshader->ApplyOverride(cam_params, "u_camera_params");
-	curppshader->ApplyOverride(blur_v_params, "u_blur_params");
-	SubmitPP();
 
-	TransferPPtoTexture(VIEW_BLUR1_PASS, m_ssaoTexture);
+		shadow_requests.push_back({ (uint64_t)(uintptr_t)light, coverage * importance, (uint32_t)(shadow_map_resolution * coverage), layer_count });
+		shadow_request_lights.push_back(i);
+		requested_layers += layer_count;
+	}
 
-	//==================SHADOW PASS [VIEW_SHADOW_PASS]========================//
-	for (size_t i = 0; i < max_lights; i++)
-	{
-		if (i >= available_views.size())
-			break;
+	std::vector<std::vector<ShadowAtlas::Tile>> shadow_tiles;
+	m_shadow_atlas.Allocate(shadow_requests, shadow_tiles);
+	passinfo.shadow_atlas_repacks = m_shadow_atlas.GetRepackCount();
+	passinfo.shadow_atlas_usage = (float)m_shadow_atlas.GetUsedTexels() / ((float)m_shadow_atlas.GetAtlasSize() * m_shadow_atlas.GetAtlasSize());
 
-		bgfx::ViewId shadowViewId = available_views[i];
+	const uint32_t atlas_size = m_shadow_atlas.GetAtlasSize();
+	const bool origin_bottom_left = bgfx::getCaps()->originBottomLeft;
 
-		if (i == frameinfo.lightdatas.size())
-			break;
+	//Lights take consecutive layers, one per cascade, each drawn into its own tile
+	uint32_t next_layer = 0;
+	for (size_t r = 0; r < shadow_requests.size(); r++)
+	{
+		const auto& tiles = shadow_tiles[r];
+		//Dropped to make room for more important lights
+		if (!tiles[0].IsValid())
+			continue;
 
+		size_t i = shadow_request_lights[r];
 		const auto& light = frameinfo.lightdatas[i];
+		uint32_t layer_count = (uint32_t)tiles.size();
 
-		light->UpdateContext(frameinfo.viewmat, frameinfo.projmat_lightusage);
-		Matrix4 lightViewMat = light->GetViewMatrix();
-		Matrix4 lightProjMat = light->GetProjectionMatrix();
-		
-		bgfx::setViewFrameBuffer(shadowViewId, m_shadowbuffers[i]);
+		light->UpdateContext(frameinfo.viewmat, frameinfo.projmat, frameinfo.nearclip, frameinfo.farclip, (int)tiles[0].size);
 
-		bgfx::setViewRect(shadowViewId, 0, 0, shadow_map_resolution, shadow_map_resolution);
-		bgfx::setViewClear(shadowViewId, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
+		light_shadow_arr[i] = Vector4((float)next_layer, (float)layer_count, 0, 0);
+		if (light->type == Light::DIRECTIONAL) {
+			for (uint32_t c = 0; c < layer_count; c++)
+				light_cascade_far_arr[i][c] = light->cascade_far[c];
+		}
 
-		bgfx::setViewTransform(shadowViewId, (const float*)&lightViewMat, (const float*)&lightProjMat);
-		for (const auto& shaderset : passinfo.callgroups)
+		for (uint32_t c = 0; c < layer_count; c++)
 		{
-			if (shaderset.second.size() == 0)
+			uint32_t layer = next_layer + c;
+			const auto& tile = tiles[c];
+			bgfx::ViewId shadowViewId = available_views[layer];
+
+			Matrix4 lightViewMat = light->GetShadowViewMatrix(c);
+			Matrix4 lightProjMat = light->GetShadowProjectionMatrix(c);
+			shadow_mtx_arr[layer] = lightProjMat * lightViewMat;
+
+			//Texture coordinates of the tile, rows count from the bottom on GL
+			float tile_v = origin_bottom_left ? (float)(atlas_size - tile.y - tile.size) : (float)tile.y;
+			float texel = 1.0f / atlas_size;
+			shadow_tile_arr[layer] = Vector4(tile.x * texel, tile_v * texel, tile.size * texel, tile.size * texel);
+
+			std::string stats_name = "Shadow " + std::to_string(i);
+			if (layer_count > 1)
+				stats_name += "." + std::to_string(c);
+
+			//Light frusta usually cover most of the scene, where a flat pass over every box beats walking the tree
+			passinfo.CullFlat(Frustum::FromMatrix(shadow_mtx_arr[layer]), shadow_visible);
+			const GraphicsRenderInfo::VisibleSet* casters = &shadow_visible;
+			passinfo.cull_stats.push_back({ stats_name, shadow_visible.indices.size(), shadow_visible.culled });
+
+			//Nothing this layer sees has changed and its tile has not moved, leave last frame's depth in it
+			//A view without submits or touch is not executed by bgfx, so the tile is not cleared either
+			uint64_t caster_signature = ShadowCasterSignature(passinfo, casters);
+			auto& cache = m_shadow_cache[layer];
+			if (cache.valid && cache.light == light && cache.caster_signature == caster_signature
+				&& cache.tile == tile && cache.view == lightViewMat && cache.proj == lightProjMat) {
+				passinfo.shadow_layers_reused++;
 				continue;
+			}
 
-			drawbatch(shaderset.first, 0);
+			cache = { light, lightViewMat, lightProjMat, caster_signature, tile, true };
 
-			// BGFX: Set State (Depth Test, Culling, etc.)
-			bgfx::setState(
-				BGFX_STATE_WRITE_Z
-				| BGFX_STATE_DEPTH_TEST_LESS
-				| BGFX_STATE_CULL_CW
-			);
+			bgfx::setViewFrameBuffer(shadowViewId, m_shadowAtlasFB);
 
-			bgfx::submit(shadowViewId, this->shadow_shader->programHandle);
+			//The clear is limited to the view rect, so other tiles keep their depth
+			bgfx::setViewRect(shadowViewId, (uint16_t)tile.x, (uint16_t)tile.y, (uint16_t)tile.size, (uint16_t)tile.size);
+			bgfx::setViewClear(shadowViewId, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
+
+			bgfx::setViewTransform(shadowViewId, (const float*)&lightViewMat, (const float*)&lightProjMat);
+			//Clears the tile even when no caster is left
+			bgfx::touch(shadowViewId);
+
+			for (size_t s = 0; s < passinfo.prepared_slices.size(); s++)
+			{
+				if (!passinfo.prepared_slices[s].drawcall->get_materialdata()->getShadowcaster())
+					continue;
+
+				if (!drawbatch(s, 0, casters))
+					continue;
+
+				// BGFX: Set State (Depth Test, Culling, etc.)
+				bgfx::setState(
+					BGFX_STATE_WRITE_Z
+					| BGFX_STATE_DEPTH_TEST_LESS
+					| BGFX_STATE_CULL_CW
+				);
+
+				bgfx::submit(shadowViewId, this->shadow_shader->programHandle);
+				passinfo.shadow_submissions++;
+			}
 		}
+
+		next_layer += layer_count;
 	}
 
+	//Layers past the last light hold nothing worth keeping
+	for (size_t layer = next_layer; layer < m_shadow_cache.size(); layer++)
+		m_shadow_cache[layer].valid = false;
+
 	//==================MAIN PASS [VIEW_MAIN_PASS]========================//
 	// Clear the main pass color/depth before rendering
 	bgfx::setViewClear(VIEW_SCENE_PASS, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x181818ff, 1.0f, 0);
 	bgfx::setViewTransform(VIEW_SCENE_PASS, (const float*)&frameinfo.viewmat, (const float*)&frameinfo.projmat);
 
+	//================== LIGHT CLUSTERS ========================//
+	//Every light is packed into the light data texture, local lights are then binned into the camera's froxels
+	//Kept from the last frame while the camera and lights are unchanged
+	if (depth_dirty || lights_dirty) {
+		std::vector<uint32_t> directional_lights;
+		std::vector<LightClusters::LightSphere> light_spheres;
+		light_data.resize(light_count * LIGHT_TEXELS);
+
+		for (size_t i = 0; i < light_count; i++)
+		{
+			const auto& light = frameinfo.lightdatas[i];
+			Vector3 forward = light->direction.Normalize();
+			float cos_inner = std::cos(gbe::toRad(light->angle_inner_deg) * 0.5f);
+			float cos_outer = std::cos(gbe::toRad(light->angle_outer_deg) * 0.5f);
+
+			Vector4* row = &light_data[i * LIGHT_TEXELS];
+			row[0] = Vector4(light->position, light->range);
+			row[1] = Vector4(light->color, (float)light->type);
+			row[2] = Vector4(Vector3(-forward.x, -forward.y, -forward.z), cos_inner);
+			row[3] = Vector4(cos_outer, light->bias_min, light->bias_mult, 0);
+			row[4] = light_shadow_arr[i];
+			row[5] = light_cascade_far_arr[i];
+
+			if (light->type == Light::DIRECTIONAL) {
+				directional_lights.push_back((uint32_t)i);
+				continue;
+			}
+
+			//Smallest sphere around the cone, a cone wider than a hemisphere keeps the full range
+			LightClusters::LightSphere sphere = { light->position, light->range, (uint32_t)i };
+			if (light->type == Light::CONE && cos_outer > 0) {
+				float sin_outer = std::sqrt(1.0f - cos_outer * cos_outer);
+
+				if (cos_outer < sin_outer) {
+					sphere.center = light->position + forward * (light->range * cos_outer);
+					sphere.radius = light->range * sin_outer;
+				}
+				else {
+					sphere.radius = light->range / (2.0f * cos_outer);
+					sphere.center = light->position + forward * sphere.radius;
+				}
+			}
+			light_spheres.push_back(sphere);
+		}
+
+		m_light_clusters.Build(frameinfo.viewmat, frameinfo.projmat, frameinfo.nearclip, frameinfo.farclip, directional_lights, light_spheres);
+		passinfo.light_cluster_entries = m_light_clusters.GetIndices().size() - directional_lights.size();
+		passinfo.light_cluster_dropped = m_light_clusters.GetDroppedCount();
+
+		if (light_count > 0)
+			bgfx::updateTexture2D(m_lightDataTexture, 0, 0, 0, 0, LIGHT_TEXELS, (uint16_t)light_count, bgfx::copy(light_data.data(), (uint32_t)(light_data.size() * sizeof(Vector4))));
+
+		const auto& cluster_ranges = m_light_clusters.GetClusterRanges();
+		bgfx::updateTexture2D(m_lightClusterTexture, 0, 0, 0, 0, LightClusters::GRID_X * LightClusters::GRID_Y, LightClusters::GRID_Z, bgfx::copy(cluster_ranges.data(), (uint32_t)(cluster_ranges.size() * sizeof(float))));
+
+		//Only the rows holding indices go up, the last one padded with zeros
+		const auto& light_indices = m_light_clusters.GetIndices();
+		const uint32_t index_width = LightClusters::INDEX_TEXTURE_WIDTH;
+		uint32_t index_rows = (uint32_t)((light_indices.size() + index_width - 1) / index_width);
+		if (index_rows > 0) {
+			const bgfx::Memory* mem = bgfx::alloc(index_rows * index_width * sizeof(float));
+			memset(mem->data, 0, mem->size);
+			memcpy(mem->data, light_indices.data(), light_indices.size() * sizeof(float));
+			bgfx::updateTexture2D(m_lightIndexTexture, 0, 0, 0, 0, (uint16_t)index_width, (uint16_t)index_rows, mem);
+		}
+
+		Vector2 slice_scale_bias = m_light_clusters.GetSliceScaleBias();
+		Vector4 light_grid((float)directional_lights.size(), slice_scale_bias.x, slice_scale_bias.y, (float)index_width);
+		frame_block[0] = light_grid;
+	}
+
+	//Per-frame constants of the lit shader in one array, the offsets must match fs_mesh.sc
+	std::copy(shadow_tile_arr.begin(), shadow_tile_arr.end(), frame_block.begin() + 1);
+	memcpy(&frame_block[1 + max_shadow_layers], shadow_mtx_arr.data(), max_shadow_layers * sizeof(Matrix4));
+
+	//================== DRAW LIST ========================//
+	//One sort key per visible drawcall, its depth bucket taken from its nearest visible instance
+	//Instances drawn from a gathered buffer are also ordered near to far, so an instanced draw fills depth front to back
+	const auto view_depth = [&passinfo, &frameinfo](uint32_t p) {
+		const auto& bounds = passinfo.prepared_bounds;
+		const auto& view = frameinfo.viewmat;
+		float x = (bounds.min_x[p] + bounds.max_x[p]) * 0.5f;
+		float y = (bounds.min_y[p] + bounds.max_y[p]) * 0.5f;
+		float z = (bounds.min_z[p] + bounds.max_z[p]) * 0.5f;
+
+		return -(view[0][2] * x + view[1][2] * y + view[2][2] * z + view[3][2]);
+		};
+
+	m_scene_visible = m_occluded_visible;
+	m_scene_drawlist.Clear();
+	for (size_t s = 0; s < passinfo.prepared_slices.size(); s++)
+	{
+		const auto& slice = passinfo.prepared_slices[s];
+		const uint32_t run_count = m_scene_visible.SliceCount(s);
+
+		if (slice.batch->GroupCount(0) == 0 || run_count == 0)
+			continue;
+
+		uint32_t* run = m_scene_visible.indices.data() + m_scene_visible.slice_offsets[s];
+		float nearest = 0;
+
+		if (run_count == slice.end - slice.begin) {
+			//Drawn straight from the persistent buffer in batch order, only the nearest depth matters
+			nearest = view_depth(run[0]);
+			for (uint32_t k = 1; k < run_count; k++)
+				nearest = std::min(nearest, view_depth(run[k]));
+		}
+		else {
+			m_run_depths.clear();
+			for (uint32_t k = 0; k < run_count; k++)
+				m_run_depths.push_back({ view_depth(run[k]), run[k] });
+
+			std::sort(m_run_depths.begin(), m_run_depths.end());
+			for (uint32_t k = 0; k < run_count; k++)
+				run[k] = m_run_depths[k].second;
+
+			nearest = m_run_depths.front().first;
+		}
+
+		const auto& drawcall = slice.drawcall;
+		m_scene_drawlist.Push(DrawList::MakeKey(
+			DrawList::PASS_OPAQUE,
+			drawcall->get_shaderdata()->programHandle.idx,
+			drawcall->get_material_sort_id(),
+			drawcall->get_mesh_sort_id(),
+			DrawList::DepthBucket(nearest, frameinfo.nearclip, frameinfo.farclip)
+		), (uint32_t)s);
+	}
+	m_scene_drawlist.Sort();
+
+	//The scene is drawn in submission order, so values already sent in it are skipped
+	UniformCache::BeginView(VIEW_SCENE_PASS, true);
+	uint32_t last_program = UINT32_MAX;
+	passinfo.program_rebinds = 0;
+	for (const auto& item : m_scene_drawlist.GetItems())
+	{
+		const size_t s = item.slice;
+		const auto& drawcall = passinfo.prepared_slices[s].drawcall;
+		const auto& currentshaderdata = drawcall->get_shaderdata();
+
+		//Uniforms set before a skipped draw would ride along with whatever is submitted next
+		if (!drawbatch(s, 0, &m_scene_visible))
+			continue;
+
+		const uint32_t program = DrawList::GetProgram(item.key);
+		if (program != last_program) {
+			passinfo.program_rebinds++;
+			last_program = program;
+		}
+
+		drawcall->SyncMaterialData();
+
+		// Set light data uniforms
+		
+		bgfx::setTexture(0, m_shadowAtlasSampler, m_shadowAtlasTexture);
+		drawcall->ApplyTextureOverride(&ssao_buffer.m_resolveTexture, tex_ao_uniform, 4); // SSAO map bound to slot 4
+		bgfx::setTexture(5, m_lightDataSampler, m_lightDataTexture);
+		bgfx::setTexture(6, m_lightClusterSampler, m_lightClusterTexture);
+		bgfx::setTexture(7, m_lightIndexSampler, m_lightIndexTexture);
+
+		drawcall->ApplyOverrideArray(frame_block.data(), frame_block_uniform, (int)frame_block.size());
+
+		//bgfx forgets the state after every submit, every scene draw is in the opaque pass for now
+		bgfx::setState(BGFX_STATE_DEFAULT);
+		bgfx::submit(VIEW_SCENE_PASS, currentshaderdata->programHandle);
+	}
+	UniformCache::EndView();
+
+	//Sky and grid go after the opaque meshes so the depth test rejects what they cover, lines go over everything
+	//=================SKYBOX PASS [VIEW_SKYBOX_PASS]
+	skybox_shader->ApplyOverride(Vector4(frameinfo.camera_pos, 1.0f), "camera_pos");
+	RenderFullscreenPass(VIEW_SCENE_PASS, skybox_shader->programHandle, BGFX_STATE_DEPTH_TEST_LEQUAL);
+	RenderFullscreenPass(VIEW_SCENE_PASS, floorgrid_shader->programHandle, BGFX_STATE_DEPTH_TEST_LEQUAL | BGFX_STATE_BLEND_ALPHA);
+	//=================END OF SKYBOX PASS
+
 	//===============LINE PASS [VIEW_LINE_PASS]
 	if (passinfo.lines_this_frame.size() > 0) {
 
 		// BGFX: Update dynamic vertex buffer
 		bgfx::update(m_line_vbh, 0, bgfx::makeRef(passinfo.lines_this_frame.data(), (uint32_t)(passinfo.lines_this_frame.size() * sizeof(gbe::gfx::Vertex))));
 
-		auto lineshaderasset = this->line_call->get_materialdata()->shader;
+		auto lineshaderasset = this->line_call->get_materialdata()->getShader();
 		const auto& lineshader = ShaderLoader::GetAssetRuntimeData(lineshaderasset->Get_assetId());
 
 		// 2. Set Vertex Buffer
@@ -427,86 +908,197 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::RenderFrame(const SceneRenderInfo& fra
 	}
 	//=================END OF LINE PASS
 
-	//=================SKYBOX PASS [VIEW_SKYBOX_PASS]
-	skybox_shader->ApplyOverride(Vector4(frameinfo.camera_pos, 1.0f), "camera_pos");
-	RenderFullscreenPass(VIEW_SCENE_PASS, skybox_shader->programHandle, BGFX_STATE_DEPTH_TEST_LEQUAL);
-	RenderFullscreenPass(VIEW_SCENE_PASS, floorgrid_shader->programHandle, BGFX_STATE_DEPTH_TEST_LEQUAL | BGFX_STATE_BLEND_ALPHA);
-	//=================END OF SKYBOX PASS
+	//============================== BLEND PASS =============================//
 
-	for (size_t i = 0; i < max_lights; i++)
+	InitPP(bufferblend_shader, VIEW_SCREEN_PASS);
+	curppshader->ApplyTextureOverride(&mainscene_buffer.m_mainColorTexture, "tex_buffer_a", 0);
+	curppshader->ApplyTextureOverride(&m_pp_textures[VIEW_OUTLINE_SELECTED_PASS], "tex_buffer_b", 1);
+	Vector4 blend_params(0, 0, 0, 0);
+	curppshader->ApplyOverride(blend_params, "u_blend_params");
+	SubmitPP();
+}
+
+void gbe::gfx::bgfx_gab::ForwardRenderer::RenderFrame(const SceneRenderInfo& frameinfo, GraphicsRenderInfo& passinfo)
+{
+	UniformCache::BeginFrame();
+	passinfo.uniforms_requested = UniformCache::GetRequestedCount();
+	passinfo.uniforms_sent = UniformCache::GetSentCount();
+	passinfo.texture_rebinds = UniformCache::GetTextureRebindCount();
+
+	UploadInstanceBatches(passinfo);
+
+	//================== INVALIDATION ========================//
+	//Each pass is drawn again only when something it reads changed since the last drawn frame
+	//An idle frame draws nothing and the screen keeps showing the last one
+	uint64_t material_version = skybox_call->get_materialdata()->version + line_call->get_materialdata()->version;
+	for (const auto& slice : passinfo.prepared_slices)
+		material_version += slice.drawcall->get_materialdata()->version;
+
+	const uint64_t light_signature = LightSignature(frameinfo.lightdatas);
+	const bool lines_changed = passinfo.lines_this_frame.size() != m_drawn_lines.size()
+		|| (!m_drawn_lines.empty() && memcmp(passinfo.lines_this_frame.data(), m_drawn_lines.data(), m_drawn_lines.size() * sizeof(Vertex)) != 0);
+
+	//Occlusion data from another camera or scene can hide what is in view now, so frames stay dirty
+	//until a pyramid of the current ones has been read back and applied
+	const bool occlusion_stale = m_hiz_pending || (m_occlusion.IsValid()
+		&& (m_occlusion_viewproj != frameinfo.projmat * frameinfo.viewmat || m_occlusion_scene_version != passinfo.scene_version));
+
+	const bool depth_dirty = !m_frame_valid || occlusion_stale
+		|| frameinfo.viewmat != m_drawn_view || frameinfo.projmat != m_drawn_proj
+		|| frameinfo.nearclip != m_drawn_near || frameinfo.farclip != m_drawn_far
+		|| passinfo.scene_version != m_drawn_scene_version;
+	const bool lights_dirty = light_signature != m_drawn_light_signature;
+	const bool scene_dirty = depth_dirty || lights_dirty || lines_changed
+		|| material_version != m_drawn_material_version
+		|| passinfo.content_version != m_drawn_content_version;
+
+	if (scene_dirty) {
+		//The line pass clears the list once it is drawn
+		m_drawn_lines = passinfo.lines_this_frame;
+
+		RenderScene(frameinfo, passinfo, depth_dirty, lights_dirty);
+
+		m_frame_valid = true;
+		m_drawn_view = frameinfo.viewmat;
+		m_drawn_proj = frameinfo.projmat;
+		m_drawn_near = frameinfo.nearclip;
+		m_drawn_far = frameinfo.farclip;
+		m_drawn_scene_version = passinfo.scene_version;
+		m_drawn_content_version = passinfo.content_version;
+		m_drawn_material_version = material_version;
+		m_drawn_light_signature = light_signature;
+	}
+	else {
+		passinfo.lines_this_frame.clear();
+	}
+
+	passinfo.scene_redrawn = scene_dirty;
+	passinfo.depth_redrawn = depth_dirty;
+
+	//============================== CPU CALLS =============================//
+
+	//Texel where a request's readback rectangle starts
+	const auto request_origin = [this](const CpuDataResponse& cpu_req) {
+		Vector2Int from = cpu_req.request.cursor_pixel_pos;
+		from -= Vector2Int(cpu_req.request.rect_size / 2, cpu_req.request.rect_size / 2);
+		from.x = std::max(0, std::min(from.x, (int)resolution.x - cpu_req.request.rect_size));
+		from.y = std::max(0, std::min(from.y, (int)resolution.y - cpu_req.request.rect_size));
+
+		return from;
+		};
+
+	//================== PICKING PASS ========================//
+	//Hover picking and texture painting go through RayPicker, so only outside callers of SubmitCpuDataRequest
+	//reach this pass. Its targets are not allocated until one of them does
+	if (!this->cpu_data_responses.empty() && !bgfx::isValid(pick_buffer.m_pickFB))
+		pick_buffer = PickBuffer(resolution.x, resolution.y, VIEW_PICK_PASS);
+
+	//Only drawn on frames with a request waiting, and only inside the rectangles those requests read back
+	//Ids and uvs go out together to two targets, with one instanced draw per drawcall
+	struct PickRect {
+		uint16_t x, y, size;
+	};
+	std::vector<PickRect> pick_rects;
+	uint16_t union_min[2] = { UINT16_MAX, UINT16_MAX };
+	uint16_t union_max[2] = { 0, 0 };
+
+	//Readback addresses texels, scissors address the view from its top left
+	const bool bottom_left = bgfx::getCaps()->originBottomLeft;
+	for (const auto& cpu_req : this->cpu_data_responses)
 	{
-		// The original code was updating light uniforms for max_lights, even if not present,
-		// which is necessary for uniform arrays in the shader->
-		if (i >= frameinfo.lightdatas.size())
-		{
-			light_color_arr[i] = Vector4(0);
-			light_range_arr[i] = 0;
-			light_type_arr[i] = 0;
+		if (cpu_req.passed || !bgfx::isValid(cpu_req.render_target.textureHandle))
 			continue;
-		}
 
-		const auto& light = frameinfo.lightdatas[i];
+		const int size = cpu_req.request.rect_size;
+		Vector2Int from = request_origin(cpu_req);
+		PickRect rect = { (uint16_t)from.x, (uint16_t)(bottom_left ? resolution.y - from.y - size : from.y), (uint16_t)size };
 
-		light_color_arr[i] = Vector4(light->color, 1);
-		light_view_arr[i] = light->GetViewMatrix();
-		light_proj_arr[i] = light->GetProjectionMatrix();
-		light_pos_arr[i] = Vector4(light->position, 1);
-		light_type_arr[i].x = light->type;
-		light_is_square_arr[i].x = light->square_project;
-		light_nearclip_arr[i].x = light->near_clip;
-		light_range_arr[i].x = light->range;
-		light_bias_min_arr[i].x = light->bias_min;
-		light_bias_mult_arr[i].x = light->bias_mult;
-		light_cone_inner_arr[i].x = gbe::toRad(light->angle_inner_deg);
-		light_cone_outer_arr[i].x = gbe::toRad(light->angle_outer_deg);
+		pick_rects.push_back(rect);
+		union_min[0] = std::min(union_min[0], rect.x);
+		union_min[1] = std::min(union_min[1], rect.y);
+		union_max[0] = std::max<uint16_t>(union_max[0], rect.x + rect.size);
+		union_max[1] = std::max<uint16_t>(union_max[1], rect.y + rect.size);
 	}
 
-	for (const auto& shaderset : passinfo.callgroups)
-	{
-		if (shaderset.second.size() == 0)
-			continue;
+	if (!pick_rects.empty()) {
+		bgfx::setViewClear(VIEW_PICK_PASS, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x000000ff, 1.0f, 0);
+		bgfx::setViewTransform(VIEW_PICK_PASS, (const float*)&frameinfo.viewmat, (const float*)&frameinfo.projmat);
+		//Also keeps the clear to the rectangles
+		bgfx::setViewScissor(VIEW_PICK_PASS, union_min[0], union_min[1], union_max[0] - union_min[0], union_max[1] - union_min[1]);
+		bgfx::touch(VIEW_PICK_PASS);
 
-		const auto& drawcall = shaderset.first;
-		const auto& currentshaderdata = drawcall->get_shaderdata();
+		const uint64_t pickable_groups = GraphicsRenderInfo::GroupBit(0) | GraphicsRenderInfo::GroupBit(1);
+		size_t pick_visible = 0;
+		size_t pick_culled = 0;
 
-		drawcall->SyncMaterialData();
+		for (const auto& rect : pick_rects)
+		{
+			//The camera frustum cropped to the rectangle, so only instances that can cover it are drawn
+			float x0 = 2.0f * rect.x / resolution.x - 1.0f;
+			float x1 = 2.0f * (rect.x + rect.size) / resolution.x - 1.0f;
+			float y0 = 1.0f - 2.0f * (rect.y + rect.size) / resolution.y;
+			float y1 = 1.0f - 2.0f * rect.y / resolution.y;
+
+			Matrix4 crop;
+			crop[0][0] = 2.0f / (x1 - x0);
+			crop[3][0] = -(x1 + x0) / (x1 - x0);
+			crop[1][1] = 2.0f / (y1 - y0);
+			crop[3][1] = -(y1 + y0) / (y1 - y0);
+
+			passinfo.Cull(Frustum::FromMatrix(crop * frameinfo.projmat * frameinfo.viewmat), m_pick_visible);
+			pick_visible += m_pick_visible.indices.size();
+			pick_culled += m_pick_visible.culled;
+
+			for (size_t s = 0; s < passinfo.prepared_slices.size(); s++)
+			{
+				const auto& slice = passinfo.prepared_slices[s];
+				const uint32_t* run = m_pick_visible.indices.data() + m_pick_visible.slice_offsets[s];
+				const uint32_t run_count = m_pick_visible.SliceCount(s);
+
+				uint32_t count = 0;
+				for (uint32_t k = 0; k < run_count; k++)
+				{
+					if (passinfo.prepared[run[k]].group_mask & pickable_groups)
+						count++;
+				}
+
+				if (count == 0)
+					continue;
 
-		// Set light data uniforms
-		
-		bgfx::setTexture(0, m_shadowArraySampler, m_shadowArrayTexture);
-		drawcall->ApplyTextureOverride(&m_ssaoTexture, "tex_ao", 4); // SSAO map bound to slot 4
-
-		drawcall->ApplyOverrideArray<Matrix4>(light_view_arr.data(), "light_view", max_lights);
-		drawcall->ApplyOverrideArray<Matrix4>(light_proj_arr.data(), "light_proj", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_color_arr.data(), "light_color", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_pos_arr.data(), "light_pos", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_type_arr.data(), "light_type", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_is_square_arr.data(), "light_is_square", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_nearclip_arr.data(), "light_nearclip", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_range_arr.data(), "light_range", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_bias_min_arr.data(), "light_bias_min", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_bias_mult_arr.data(), "light_bias_mult", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_cone_inner_arr.data(), "light_cone_inner", max_lights);
-		drawcall->ApplyOverrideArray<Vector4>(light_cone_outer_arr.data(), "light_cone_outer", max_lights);
-
-		drawbatch(shaderset.first, 0);
+				//Matrix then id per instance, the id is read as an attribute instead of a uniform per object
+				bgfx::InstanceDataBuffer idb;
+				bgfx::allocInstanceDataBuffer(&idb, count, PICK_INSTANCE_STRIDE);
 
-		bgfx::setState(BGFX_STATE_DEFAULT);
-		bgfx::submit(VIEW_SCENE_PASS, currentshaderdata->programHandle);
-	}
+				uint8_t* data = idb.data;
+				for (uint32_t k = 0; k < run_count; k++)
+				{
+					const auto& prepared = passinfo.prepared[run[k]];
 
-	//============================== BLEND PASS =============================//
+					if ((prepared.group_mask & pickable_groups) == 0)
+						continue;
 
-	InitPP(bufferblend_shader, VIEW_SCREEN_PASS);
-	curppshader->ApplyTextureOverride(&mainscene_buffer.m_mainColorTexture, "tex_buffer_a", 0);
-	curppshader->ApplyTextureOverride(&m_pp_textures[VIEW_OUTLINE_SELECTED_PASS], "tex_buffer_b", 1);
-	Vector4 blend_params(0, 0, 0, 0);
-	curppshader->ApplyOverride(blend_params, "u_blend_params");
-	SubmitPP();
+					//Instance ids are packed object handles, alpha carries the generation so stale picks can be rejected
+					Vector4 id = BRGA_t(prepared.instance_id).ToVector4();
+					memcpy(data, prepared.matrix, sizeof(Matrix4));
+					memcpy(data + sizeof(Matrix4), &id, sizeof(Vector4));
+					data += PICK_INSTANCE_STRIDE;
+				}
 
-	//============================== CPU CALLS =============================//
+				const auto& curmesh = slice.drawcall->get_meshdata();
+				bgfx::setIndexBuffer(curmesh->index_vbh);
+				bgfx::setVertexBuffer(0, curmesh->vertex_vbh);
+				bgfx::setInstanceDataBuffer(&idb);
+				bgfx::setScissor(rect.x, rect.y, rect.size, rect.size);
+
+				bgfx::setState(BGFX_STATE_DEFAULT);
+				bgfx::submit(VIEW_PICK_PASS, pick_shader->programHandle);
+			}
+		}
+
+		passinfo.cull_stats.push_back({ "Picking", pick_visible, pick_culled });
+	}
 
-	//BLIT AREA AROUND CURSOR FOR ID
+	//BLIT EACH REQUEST'S AREA FOR READBACK
 	for (auto& cpu_req : this->cpu_data_responses)
 	{
 		if (!cpu_req.passed) {
@@ -516,15 +1108,12 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::RenderFrame(const SceneRenderInfo& fra
 				continue;
 			}
 
-			Vector2Int from = cpu_req.request.cursor_pixel_pos;
-			from -= Vector2Int(cpu_req.request.rect_size / 2, cpu_req.request.rect_size / 2);
-			from.x = std::max(0, std::min(from.x, (int)resolution.x - cpu_req.request.rect_size));
-			from.y = std::max(0, std::min(from.y, (int)resolution.y - cpu_req.request.rect_size));
+			Vector2Int from = request_origin(cpu_req);
 
-			auto src_buffer = id_buffer.m_mainColorTexture.textureHandle;
+			auto src_buffer = pick_buffer.m_idTexture.textureHandle;
 
 			if(cpu_req.request.cpu_pass_mode == Renderer::PASS_UV)
-				src_buffer = uv_buffer.m_mainColorTexture.textureHandle;
+				src_buffer = pick_buffer.m_uvTexture.textureHandle;
 
 			bgfx::blit(
 				VIEW_DEBUG_BLITTER,
@@ -558,17 +1147,32 @@ void gbe::gfx::bgfx_gab::ForwardRenderer::RenderFrame(const SceneRenderInfo& fra
 
 	//============================== DEBUG CALLS =============================//
 
-	//BLIT SHADOW PASSES
-	for (uint16_t i = 0; i < (uint16_t)max_lights; ++i) {
+	//BLIT SHADOW ATLAS, only while the image debugger can show it and the atlas may have changed
+	const uint32_t atlas_size = m_shadow_atlas.GetAtlasSize();
+	if (frameinfo.debug_textures && (scene_dirty || !bgfx::isValid(m_debugShadowAtlas.textureHandle))) {
+		if (!bgfx::isValid(m_debugShadowAtlas.textureHandle)) {
+			m_debugShadowAtlas = TextureData{
+				.textureHandle = bgfx::createTexture2D(
+					(uint16_t)atlas_size,
+					(uint16_t)atlas_size,
+					false, 1,
+					bgfx::TextureFormat::D16,
+					BGFX_TEXTURE_BLIT_DST // Required for blitting
+				)
+			};
+
+			TextureLoader::Register("shadowmap_atlas", m_debugShadowAtlas);
+		}
+
 		// blit(viewId, dst, dstMip, dstX, dstY, dstZ, src, srcMip, srcX, srcY, srcZ, width, height, depth)
 		bgfx::blit(
-			VIEW_DEBUG_BLITTER,           // The view that performs the copy
-			m_debugShadowTextures[i].textureHandle, // Destination: Singular 2D texture
-			0, 0, 0, 0,               // Mip 0, X 0, Y 0, Z 0
-			m_shadowArrayTexture,     // Source: Your Texture Array
-			0, 0, 0, i,               // Mip 0, X 0, Y 0, Layer 'i'
-			shadow_map_resolution,
-			shadow_map_resolution
+			VIEW_DEBUG_BLITTER,
+			m_debugShadowAtlas.textureHandle,
+			0, 0, 0, 0,
+			m_shadowAtlasTexture,
+			0, 0, 0, 0,
+			(uint16_t)atlas_size,
+			(uint16_t)atlas_size
 		);
 	}
 }
@@ -582,9 +1186,6 @@ gbe::gfx::TextureData gbe::gfx::bgfx_gab::ForwardRenderer::ReloadFrame(Vector2In
 	uint16_t h = (uint16_t)reso.y;
 
 	//PINGPONGING
-	RegisterFramebuffer(VIEW_SSAO_PASS);
-	RegisterFramebuffer(VIEW_BLUR0_PASS);
-	RegisterFramebuffer(VIEW_BLUR1_PASS);
 	RegisterFramebuffer(VIEW_OUTLINE_SELECTED_PASS, bgfx::TextureFormat::BGRA8);
 	RegisterFramebuffer(VIEW_SCREEN_PASS, bgfx::TextureFormat::BGRA8);
 	TextureLoader::Register("OUTLINE_PASS", m_pp_textures[VIEW_OUTLINE_SELECTED_PASS]);
@@ -594,17 +1195,47 @@ gbe::gfx::TextureData gbe::gfx::bgfx_gab::ForwardRenderer::ReloadFrame(Vector2In
 	gbuffer_selected = GBuffer(w, h, "SELECTED", VIEW_GBUFFER_SELECTED_PASS);
 
 	//SSAO
-	m_ssaoTexture = TextureData{
-		.textureHandle = bgfx::createTexture2D(w, h, false, 1, bgfx::TextureFormat::R8, BGFX_TEXTURE_BLIT_DST)
-	};
-	TextureLoader::Register("m_ssaoTexture", m_ssaoTexture);
+	ssao_buffer = SsaoBuffer(w, h, ssao_quality);
 
 	//MAIN PASS
 	mainscene_buffer = ColorDepthBuffer(w, h, "MAINPASS", VIEW_SCENE_PASS);
 
-	//ID PASS
-	id_buffer = ColorDepthBuffer(w, h, "IDPASS", VIEW_ID_PASS);
-	uv_buffer = ColorDepthBuffer(w, h, "UVPASS", VIEW_UV_PASS);
+	//PICK PASS, created with the first CPU data request at this size
+
+	//HI-Z PYRAMID
+	//Halved until a level fits the readback, a screen too large for that gets no occlusion culling
+	const uint64_t hiz_flags = BGFX_TEXTURE_RT | BGFX_SAMPLER_POINT | BGFX_SAMPLER_UVW_CLAMP;
+	uint16_t level_w = w;
+	uint16_t level_h = h;
+	while (m_hiz_levels.size() < HIZ_MAX_LEVELS && (m_hiz_levels.empty() || level_w > HIZ_READBACK_SIZE || level_h > HIZ_READBACK_SIZE))
+	{
+		level_w = std::max<uint16_t>(1, (level_w + 1) / 2);
+		level_h = std::max<uint16_t>(1, (level_h + 1) / 2);
+
+		HiZLevel level;
+		level.width = level_w;
+		level.height = level_h;
+		level.texture = TextureData{
+			.textureHandle = bgfx::createTexture2D(level_w, level_h, false, 1, bgfx::TextureFormat::R32F, hiz_flags)
+		};
+		level.fb = bgfx::createFrameBuffer(1, &level.texture.textureHandle, false);
+
+		bgfx::ViewId view = (bgfx::ViewId)(VIEW_HIZ_PASS + m_hiz_levels.size());
+		bgfx::setViewFrameBuffer(view, level.fb);
+		bgfx::setViewRect(view, 0, 0, level_w, level_h);
+
+		m_hiz_levels.push_back(level);
+	}
+	TextureLoader::Register("HiZ", m_hiz_levels.front().texture);
+
+	//Renderers that cannot blit or read textures back (Noop, some software backends) get no occlusion culling either
+	const uint64_t hiz_caps = BGFX_CAPS_TEXTURE_BLIT | BGFX_CAPS_TEXTURE_READ_BACK;
+	const bool hiz_supported = (bgfx::getCaps()->supported & hiz_caps) == hiz_caps;
+	if (hiz_supported && level_w <= HIZ_READBACK_SIZE && level_h <= HIZ_READBACK_SIZE) {
+		m_hiz_readback = TextureData{
+			.textureHandle = bgfx::createTexture2D(level_w, level_h, false, 1, bgfx::TextureFormat::R32F, BGFX_TEXTURE_BLIT_DST | BGFX_TEXTURE_READ_BACK)
+		};
+	}
 
 	return m_pp_textures[VIEW_SCREEN_PASS];
 }
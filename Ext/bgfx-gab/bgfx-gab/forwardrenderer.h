@@ -9,6 +9,10 @@
 #include <vector>
 
 #include "Graphics/Renderer.h"
+#include "Graphics/util/ShadowAtlas.h"
+#include "Graphics/util/LightClusters.h"
+#include "Graphics/util/DrawList.h"
+#include "Graphics/util/HiZOcclusion.h"
 #include "ScreenUtil.h"
 
 namespace gbe {
@@ -23,17 +27,19 @@ namespace gbe {
 					//GBuffer
 					VIEW_GBUFFER_PASS,
 					VIEW_GBUFFER_SELECTED_PASS,
+					//Depth pyramid of the gbuffer, one view per level
+					VIEW_HIZ_PASS,
+					VIEW_HIZ_PASS_END = VIEW_HIZ_PASS + 8,
 					//CPU Passes
-					VIEW_ID_PASS,
-					VIEW_UV_PASS,
+					VIEW_PICK_PASS,
 					//Post processing Passes
+					VIEW_SSAO_DOWNSAMPLE_PASS,
 					VIEW_SSAO_PASS,
-					VIEW_BLUR0_PASS,
-					VIEW_BLUR1_PASS,
+					VIEW_SSAO_UPSAMPLE_PASS,
 					VIEW_OUTLINE_SELECTED_PASS,
 					//Shadow Passes
 					VIEW_SHADOW_PASS,
-					VIEW_SHADOW_PASS_END = VIEW_SHADOW_PASS + 20,
+					VIEW_SHADOW_PASS_END = VIEW_SHADOW_PASS + 32,
 					//Main Passes
 					VIEW_SCENE_PASS,
 					VIEW_SCREEN_PASS,
@@ -45,8 +51,19 @@ namespace gbe {
 
 			private:
 				//Settings
-				int max_lights = 10;
+				//Rows of the light data texture, lights past this are not drawn
+				int max_lights = 1024;
+				//Texels each light takes in the light data texture
+				static constexpr int LIGHT_TEXELS = 6;
+				//Shadow views, one per spot light or directional cascade, each drawn into a tile of the atlas
+				int max_shadow_layers = 32;
+				//Largest tile a single shadow view gets
 				int shadow_map_resolution = 1024;
+				int shadow_tile_min = 128;
+				int shadow_atlas_size = 4096;
+				SSAO_QUALITY ssao_quality = SSAO_HALF;
+				//Kernel size at full resolution, each step down in resolution halves it
+				static constexpr int SSAO_MAX_SAMPLES = 32;
 				std::vector<bgfx::ViewId> available_views;
 
 				//============BGFX=======================//
@@ -54,30 +71,42 @@ namespace gbe {
 				ShaderData* shadow_shader;
 				ShaderData* ssao_shader;
 				ShaderData* outline_shader;
-				ShaderData* bilateralblur_shader;
+				ShaderData* ssaodownsample_shader;
+				ShaderData* ssaoupsample_shader;
 				ShaderData* gbuffer_shader;
 				ShaderData* bufferblend_shader;
-				ShaderData* id_shader;
-				ShaderData* uv_shader;
+				ShaderData* pick_shader;
 				ShaderData* skybox_shader;
 				ShaderData* floorgrid_shader;
+				ShaderData* hizdownsample_shader;
 
 				//=============RUNTIME===============//
 				DrawCall* line_call;
 				DrawCall* skybox_call;
 
-				std::vector<Matrix4> light_view_arr;
-				std::vector<Matrix4> light_proj_arr;
-				std::vector<Vector4> light_color_arr;
-				std::vector<Vector4> light_pos_arr;
-				std::vector<Vector4> light_type_arr;
-				std::vector<Vector4> light_is_square_arr;
-				std::vector<Vector4> light_nearclip_arr;
-				std::vector<Vector4> light_range_arr;
-				std::vector<Vector4> light_bias_min_arr;
-				std::vector<Vector4> light_bias_mult_arr;
-				std::vector<Vector4> light_cone_inner_arr;
-				std::vector<Vector4> light_cone_outer_arr;
+				//Light projection times view, per shadow layer
+				std::vector<Matrix4> shadow_mtx_arr;
+				//Atlas texture coordinates of each layer's tile, offset in xy and scale in zw
+				std::vector<Vector4> shadow_tile_arr;
+				//First shadow layer (-1 for none) and layer count, per light
+				std::vector<Vector4> light_shadow_arr;
+				//View depth where each cascade ends, per light
+				std::vector<Vector4> light_cascade_far_arr;
+				//LIGHT_TEXELS texels per light, uploaded once per frame
+				std::vector<Vector4> light_data;
+				//Light grid, then shadow tiles, then shadow matrices as 4 columns each, sent as the u_frame array
+				std::vector<Vector4> frame_block;
+				UniformCache::Id frame_block_uniform;
+				UniformCache::Id tex_ao_uniform;
+				LightClusters m_light_clusters;
+				//Instances inside the rectangle of one CPU request
+				GraphicsRenderInfo::VisibleSet m_pick_visible;
+				//Scene draws of the frame in sort key order, and the camera visible set with each run ordered near to far
+				DrawList m_scene_drawlist;
+				GraphicsRenderInfo::VisibleSet m_scene_visible;
+				std::vector<std::pair<float, uint32_t>> m_run_depths;
+				//Camera visible instances left after the occlusion test, drawn by the gbuffer and scene passes
+				GraphicsRenderInfo::VisibleSet m_occluded_visible;
 
 				//============DYNAMIC============//
 				// BGFX: Textures used as attachments for the Frame Buffers
@@ -110,7 +139,61 @@ namespace gbe {
 				GBuffer gbuffer_all;
 				GBuffer gbuffer_selected;
 
-				TextureData m_ssaoTexture;
+				/// <summary>
+				/// SSAO computed on a reduced copy of the gbuffer, then upsampled along its edges into the full size texture the lit pass reads.
+				/// </summary>
+				struct SsaoBuffer {
+					bgfx::FrameBufferHandle m_reducedFB = BGFX_INVALID_HANDLE;
+					bgfx::FrameBufferHandle m_aoFB = BGFX_INVALID_HANDLE;
+					bgfx::FrameBufferHandle m_resolveFB = BGFX_INVALID_HANDLE;
+					//View space normals and linear depth, nearest of each footprint
+					TextureData m_normalTexture = BGFX_INVALID_HANDLE;
+					TextureData m_depthTexture = BGFX_INVALID_HANDLE;
+					TextureData m_aoTexture = BGFX_INVALID_HANDLE;
+					TextureData m_resolveTexture = BGFX_INVALID_HANDLE;
+					uint16_t width = 0;
+					uint16_t height = 0;
+					int scale = 1;
+
+					inline SsaoBuffer() {}
+
+					inline SsaoBuffer(uint16_t w, uint16_t h, int _scale) {
+						scale = _scale;
+						width = (uint16_t)((w + scale - 1) / scale);
+						height = (uint16_t)((h + scale - 1) / scale);
+
+						const uint64_t flags = BGFX_TEXTURE_RT | BGFX_SAMPLER_POINT | BGFX_SAMPLER_UVW_CLAMP;
+						m_normalTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(width, height, false, 1, bgfx::TextureFormat::RGBA16F, flags)
+						};
+						m_depthTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(width, height, false, 1, bgfx::TextureFormat::R32F, flags)
+						};
+						m_aoTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(width, height, false, 1, bgfx::TextureFormat::R8, flags)
+						};
+						m_resolveTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(w, h, false, 1, bgfx::TextureFormat::R8, flags)
+						};
+						TextureLoader::Register("SSAO_Reduced", m_aoTexture);
+						TextureLoader::Register("m_ssaoTexture", m_resolveTexture);
+
+						bgfx::TextureHandle reducedAttachments[] = { m_normalTexture.textureHandle, m_depthTexture.textureHandle };
+						m_reducedFB = bgfx::createFrameBuffer(BX_COUNTOF(reducedAttachments), reducedAttachments, false);
+						m_aoFB = bgfx::createFrameBuffer(1, &m_aoTexture.textureHandle, false);
+						m_resolveFB = bgfx::createFrameBuffer(1, &m_resolveTexture.textureHandle, false);
+
+						bgfx::setViewFrameBuffer(VIEW_SSAO_DOWNSAMPLE_PASS, m_reducedFB);
+						bgfx::setViewRect(VIEW_SSAO_DOWNSAMPLE_PASS, 0, 0, width, height);
+						bgfx::setViewFrameBuffer(VIEW_SSAO_PASS, m_aoFB);
+						bgfx::setViewRect(VIEW_SSAO_PASS, 0, 0, width, height);
+						bgfx::setViewFrameBuffer(VIEW_SSAO_UPSAMPLE_PASS, m_resolveFB);
+						bgfx::setViewRect(VIEW_SSAO_UPSAMPLE_PASS, 0, 0, w, h);
+					}
+				};
+				SsaoBuffer ssao_buffer;
+				//4x4 tile of kernel rotations, repeated over the reduced screen
+				TextureData m_ssaoNoiseTexture = BGFX_INVALID_HANDLE;
 
 				ShaderData* curppshader;
 				RenderViewId curppview;
@@ -137,17 +220,6 @@ namespace gbe {
 					bgfx::setViewFrameBuffer(viewid, newfb);
 					bgfx::setViewRect(viewid, 0, 0, resolution.x, resolution.y);
 				}
-				inline void TransferPPtoTexture(RenderViewId from, TextureData dest) {
-					bgfx::blit(
-						VIEW_DEBUG_BLITTER,           // The view that performs the copy
-						dest.textureHandle, // Destination: Singular 2D texture
-						0, 0, 0, 0,               // Mip 0, X 0, Y 0, Z 0
-						m_pp_textures[from].textureHandle,     // Source: Your Texture Array
-						0, 0, 0, 0,               // Mip 0, X 0, Y 0, Layer 'i'
-						resolution.x,
-						resolution.y
-					);
-				}
 
 				struct ColorDepthBuffer {
 					bgfx::FrameBufferHandle m_mainPassFBO = BGFX_INVALID_HANDLE;
@@ -171,22 +243,129 @@ namespace gbe {
 					}
 				};
 				ColorDepthBuffer mainscene_buffer;
-				
-				ColorDepthBuffer id_buffer;
-				ColorDepthBuffer uv_buffer;
+
+				/// <summary>
+				/// Object ids and uvs, drawn together as two targets of one pass for CPU readback.
+				/// </summary>
+				struct PickBuffer {
+					bgfx::FrameBufferHandle m_pickFB = BGFX_INVALID_HANDLE;
+					TextureData m_idTexture = BGFX_INVALID_HANDLE;
+					TextureData m_uvTexture = BGFX_INVALID_HANDLE;
+					TextureData m_depthTexture = BGFX_INVALID_HANDLE;
+
+					inline PickBuffer() {}
+
+					inline PickBuffer(float w, float h, RenderViewId _viewid) {
+						m_idTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(w, h, false, 1, bgfx::TextureFormat::BGRA8, BGFX_TEXTURE_RT)
+						};
+						m_uvTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(w, h, false, 1, bgfx::TextureFormat::BGRA8, BGFX_TEXTURE_RT)
+						};
+						m_depthTexture = TextureData{
+							.textureHandle = bgfx::createTexture2D(w, h, false, 1, bgfx::TextureFormat::D24S8, BGFX_TEXTURE_RT_WRITE_ONLY)
+						};
+						TextureLoader::Register("Pick_ID", m_idTexture);
+						TextureLoader::Register("Pick_UV", m_uvTexture);
+						bgfx::TextureHandle pickAttachments[] = { m_idTexture.textureHandle, m_uvTexture.textureHandle, m_depthTexture.textureHandle };
+						m_pickFB = bgfx::createFrameBuffer(BX_COUNTOF(pickAttachments), pickAttachments, false);
+						bgfx::setViewFrameBuffer(_viewid, m_pickFB);
+						bgfx::setViewRect(_viewid, 0, 0, w, h);
+					}
+				};
+				PickBuffer pick_buffer;
+
+				/// <summary>
+				/// One level of the depth pyramid, each texel the farthest depth of the 2x2 texels above it.
+				/// </summary>
+				struct HiZLevel {
+					bgfx::FrameBufferHandle fb = BGFX_INVALID_HANDLE;
+					TextureData texture = BGFX_INVALID_HANDLE;
+					uint16_t width = 0;
+					uint16_t height = 0;
+				};
+				//Levels are halved until one fits the readback, which the CPU reduces further
+				static constexpr uint32_t HIZ_MAX_LEVELS = VIEW_HIZ_PASS_END - VIEW_HIZ_PASS;
+				static constexpr uint32_t HIZ_READBACK_SIZE = 128;
+				std::vector<HiZLevel> m_hiz_levels;
+				TextureData m_hiz_readback = BGFX_INVALID_HANDLE;
+				//Never resized, a readback may still be writing into it
+				std::vector<float> m_hiz_readback_data;
+				//Camera and scene of the frame whose pyramid is being read back, and of the one applied
+				Matrix4 m_hiz_pending_viewproj;
+				uint64_t m_hiz_pending_scene_version = 0;
+				Matrix4 m_occlusion_viewproj;
+				uint64_t m_occlusion_scene_version = 0;
+				uint32_t m_hiz_frame_done = 0;
+				bool m_hiz_pending = false;
+				HiZOcclusion m_occlusion;
+
+				//What the last drawn frame was drawn from, a frame matching all of it draws nothing
+				bool m_frame_valid = false;
+				Matrix4 m_drawn_view;
+				Matrix4 m_drawn_proj;
+				float m_drawn_near = 0;
+				float m_drawn_far = 0;
+				uint64_t m_drawn_scene_version = 0;
+				uint64_t m_drawn_content_version = 0;
+				uint64_t m_drawn_material_version = 0;
+				uint64_t m_drawn_light_signature = 0;
+				std::vector<Vertex> m_drawn_lines;
+				//Model matrix then packed object id, per picked instance
+				static constexpr uint16_t PICK_INSTANCE_STRIDE = 80;
 
 				std::vector<Vector4>  m_ssao_kernel_data;
 
-				bgfx::TextureHandle m_shadowArrayTexture = BGFX_INVALID_HANDLE;
-				std::vector<TextureData> m_debugShadowTextures;
+				bgfx::TextureHandle m_shadowAtlasTexture = BGFX_INVALID_HANDLE;
+				bgfx::FrameBufferHandle m_shadowAtlasFB = BGFX_INVALID_HANDLE;
+				ShadowAtlas m_shadow_atlas = ShadowAtlas(shadow_atlas_size, shadow_tile_min, shadow_map_resolution);
+				//Created the first time the image debugger is open
+				TextureData m_debugShadowAtlas;
 
-				bgfx::UniformHandle m_shadowArraySampler;
-				std::vector<bgfx::FrameBufferHandle> m_shadowbuffers;
+				bgfx::UniformHandle m_shadowAtlasSampler;
+
+				bgfx::TextureHandle m_lightDataTexture = BGFX_INVALID_HANDLE;
+				bgfx::TextureHandle m_lightClusterTexture = BGFX_INVALID_HANDLE;
+				bgfx::TextureHandle m_lightIndexTexture = BGFX_INVALID_HANDLE;
+				bgfx::UniformHandle m_lightDataSampler;
+				bgfx::UniformHandle m_lightClusterSampler;
+				bgfx::UniformHandle m_lightIndexSampler;
+
+				/// <summary>
+				/// What was last drawn into one layer's atlas tile. The tile is kept while all of it still matches.
+				/// </summary>
+				struct ShadowLayerCache {
+					const Light* light = nullptr;
+					Matrix4 view;
+					Matrix4 proj;
+					uint64_t caster_signature = 0;
+					ShadowAtlas::Tile tile;
+					bool valid = false;
+				};
+				std::vector<ShadowLayerCache> m_shadow_cache;
 
 				// BGFX: Vertex buffer for lines
 				bgfx::DynamicVertexBufferHandle m_line_vbh = BGFX_INVALID_HANDLE;
 
+				// BGFX: One model matrix per instance, read as i_data0-3
+				bgfx::VertexLayout m_instance_layout;
+
 				Vector2Int resolution;
+
+				/// <summary>
+				/// Sends the matrices written since the last frame into each drawcall's persistent instance buffer.
+				/// </summary>
+				void UploadInstanceBatches(GraphicsRenderInfo& passinfo);
+				/// <summary>
+				/// Draws every pass behind the final image. The depth passes are kept from the last drawn frame unless depth_dirty,
+				/// the light clusters unless either flag is set.
+				/// </summary>
+				void RenderScene(const SceneRenderInfo& frameinfo, GraphicsRenderInfo& passinfo, bool depth_dirty, bool lights_dirty);
+				/// <summary>
+				/// Fills the SSAO kernel with as many samples as the current quality takes.
+				/// </summary>
+				void BuildSsaoKernel();
+				void DestroySsaoBuffer();
 			public:
 				ForwardRenderer(const GraphicsRenderInfo& passinfo);
 
@@ -197,6 +376,12 @@ namespace gbe {
 
 				void CleanUp();
 
+				// Inherited via Renderer
+				void SetSsaoQuality(SSAO_QUALITY quality) override;
+				inline SSAO_QUALITY GetSsaoQuality() const override {
+					return ssao_quality;
+				}
+
 				inline ~ForwardRenderer() {
 					CleanUp();
 				}
@@ -4,6 +4,7 @@
 #include <string>
 #include <algorithm>
 #include <filesystem>
+#include <atomic>
 
 #include "../AssetTypes/Types.h"
 
@@ -102,7 +103,8 @@ namespace gbe {
 		class AssetLoader : public AssetLoader_base<TAsset, TAssetImportData> {
 		public:
 			struct AsyncLoadTask {
-				bool isDone = false;
+				//Set from a job thread, polled from the main thread
+				std::atomic<bool> isDone = false;
 				std::string id;
 				std::string path;
 				TAssetLoadData loaddata;
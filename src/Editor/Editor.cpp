@@ -54,6 +54,8 @@ gbe::Editor::Editor(RenderPipeline* renderpipeline, Window* window, Time* _mtime
 			this->inspectorwindow.SetInspectorData({}); // Clear inspector if the currently inspected object is deleted
 		}
 
+		this->tree_versions_seen.erase((Object*)deleted);
+
 		auto sel_it = std::find(this->selected.begin(), this->selected.end(), deleted);
 
 		if (sel_it != this->selected.end()) {
@@ -290,12 +292,8 @@ void gbe::Editor::ProcessRawWindowEvent(void* rawwindowevent) {
 				hijack_info.callback(RenderPipeline::GetWindow()->GetMousePixelPos(), pointer_state);
 			}
 			else {
-				if (cur_id_oncursor == UINT32_MAX) { //NOTHING WAS CLICKED
-					SelectSingle(nullptr);
-				}
-				else {
-					SelectSingle(Object::GetObjectById(cur_id_oncursor));
-				}
+				//Resolves to nullptr if nothing was clicked or the object was destroyed since the readback
+				SelectSingle(Object::GetObjectByHandle(cur_handle_oncursor));
 			}
 		}
 	}
@@ -331,52 +329,25 @@ void gbe::Editor::PrepareUpdate()
 	//==============================EDITOR UPDATE==============================//
 	for (const auto& selected_obj: selected)
 	{
-		if (selected_obj->CheckState(Object::TREE_CHANGED, this)) {
+		if (selected_obj->CheckState(Object::TREE_CHANGED, this->tree_versions_seen[selected_obj])) {
 			this->UpdateSelection();
 			break;
 		}
 	}
 
-	if (hijack_info.hijacker == nullptr)
-		RenderPipeline::GetRenderer()->SubmitCpuDataRequest({
-			.override_id = "id_cursor",
-			.cpu_pass_mode = Renderer::CPU_PASS_MODE::PASS_ID,
-			.cursor_pixel_pos = RenderPipeline::GetWindow()->GetMousePixelPos(),
-			.rect_size = 2,
-			.callback = [&](Renderer::CpuDataResponse& response) {
-				std::map<uint32_t, uint32_t> ids;  // This contains all the IDs found in the buffer
-				uint32_t maxAmount = 0;
-				for (auto& pixel : response.cpu_data)
-				{
-					if (0 == (pixel.r | pixel.g | pixel.b)) // Skip background
-					{
-						continue;
-					}
-
-					std::map<uint32_t, uint32_t>::iterator mapIter = ids.find(pixel.hashed());
-					uint32_t amount = 1;
-					if (mapIter != ids.end())
-					{
-						amount = mapIter->second + 1;
-					}
-
-					ids[pixel.hashed()] = amount; // Amount of times this ID (color) has been clicked on in buffer
-					maxAmount = maxAmount > amount ? maxAmount : amount;
-				}
-				this->cur_id_oncursor = UINT32_MAX;
-				if (maxAmount)
-				{
-					for (std::map<uint32_t, uint32_t>::iterator mapIter = ids.begin(); mapIter != ids.end(); mapIter++)
-					{
-						if (mapIter->second == maxAmount)
-						{
-							this->cur_id_oncursor = mapIter->first;
-							break;
-						}
-					}
-				}
-			}
-			});
+	//Picked on the CPU through last frame's camera, so the object under the cursor is known this frame
+	if (hijack_info.hijacker == nullptr) {
+		this->cur_handle_oncursor = ObjectHandle();
+
+		RayPicker::Hit hit;
+		if (RenderPipeline::PickPixel(RenderPipeline::GetWindow()->GetMousePixelPos(), hit)) {
+			//Instance ids are packed handles, stale ids from reused slots fail to resolve
+			auto picked = Object::GetObjectById(hit.instance_id);
+
+			if (picked != nullptr)
+				this->cur_handle_oncursor = picked->GetHandle();
+		}
+	}
 
 	if (pointer_state == POINTER_DOWN)
 		pointer_state = POINTER_HOLD;
@@ -35,6 +35,8 @@ namespace gbe {
 		Time* mtime;
 
 		std::vector<gbe::Object*> selected;
+		//Last TREE_CHANGED version seen per selected object
+		std::unordered_map<gbe::Object*, uint32_t> tree_versions_seen;
 
 		struct EditorAction {
 			std::function<void()> action_done;
@@ -59,7 +61,8 @@ namespace gbe {
 
 		//============GUI===========//
 		bool gui_initialized = false;
-		uint32_t cur_id_oncursor = UINT32_MAX;
+		//Null when nothing is under the cursor
+		ObjectHandle cur_handle_oncursor;
 
 		//DOCKS
 		editor::MenuBar menubar;
@@ -109,6 +112,9 @@ namespace gbe {
 			bool pointer_really_inUi = pointer_inUi && !viewportWindow.Get_pointer_here();
 			return pointer_really_inUi || keyboard_inUi;
 		}
+		inline bool IsImageDebuggerOpen() {
+			return imageDebuggerWindow.Get_is_open();
+		}
 		static void HijackPointer(editor::GuiElement* hijacker, std::function<void(Vector2Int, PointerState)> callback, std::function<void()> on_end_hijack = []() {}) {
 			if (instance->hijack_info.hijacker != nullptr) {
 				instance->hijack_info.on_end_hijack();
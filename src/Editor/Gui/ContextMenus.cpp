@@ -1,36 +1,42 @@
 #include "ContextMenus.h"
 
+#include <memory>
+
 void gbe::editor::ContextMenus::GenericObject(gbe::Object* obj)
 {
 	if (ImGui::BeginPopupContextItem()) {
 		
 		if (ImGui::MenuItem("Delete", "Del")) {
-			auto parent_id = obj->GetParent()->Get_id();
-			auto destroy_id = obj->Get_id();
+			auto parent_handle = obj->GetParent()->GetHandle();
+			//Shared between redo and undo, the respawned object gets a new handle
+			auto destroy_handle = std::make_shared<ObjectHandle>(obj->GetHandle());
 			auto respawn_info = obj->Serialize();
 
 			Editor::CommitAction(
 				[=]() {
-					Engine::GetCurrentRoot()->GetObjectWithId(destroy_id)->Destroy();
+					auto target = Engine::GetCurrentRoot()->GetObjectWithHandle(*destroy_handle);
+
+					if (target != nullptr)
+						target->Destroy();
 				},
 				[=]() {
 					auto info = respawn_info;
 
 					auto undoed = gbe::TypeSerializer::Instantiate(respawn_info.type, &info);
-					undoed->Set_id(destroy_id);
-					undoed->SetParent(Engine::GetCurrentRoot()->GetObjectWithId(parent_id));
+					*destroy_handle = undoed->GetHandle();
+
+					auto parent = Engine::GetCurrentRoot()->GetObjectWithHandle(parent_handle);
+					undoed->SetParent(parent != nullptr ? parent : Engine::GetCurrentRoot());
 				}
 			);
 		}
 		if (ImGui::MenuItem("Duplicate")) {
-			auto parent_id = obj->GetParent()->Get_id();
-			auto destroy_id = obj->Get_id();
 			auto respawn_info = obj->Serialize();
 
 			auto duplicate = gbe::TypeSerializer::Instantiate(respawn_info.type, &respawn_info);
 			duplicate->SetName(obj->GetName() + " Copy");
 
-			duplicate->SetParent(Engine::GetCurrentRoot()->GetObjectWithId(parent_id));
+			duplicate->SetParent(obj->GetParent());
 		}
 
 		ImGui::EndPopup();
@@ -18,6 +18,45 @@ void gbe::editor::StateWindow::DrawSelf()
 	if (ImGui::Button("Step")) {
 		Engine::Step(0.05f);
 	}
+
+	ImGui::Text("Transforms recomputed: %zu", Engine::GetTransformsRecomputed());
+	ImGui::Text("Instances uploaded: %zu", RenderPipeline::GetInstancesUploaded());
+	ImGui::Text("Frame prep: %.3f ms of %.3f ms render CPU", RenderPipeline::GetPrepareTime(), RenderPipeline::GetRenderTime());
+
+	ImGui::Text("Culling kernel: %s", gfx::BoxCuller::GetPathName());
+	ImGui::Text("Shadow draws: %zu, layers reused: %zu", RenderPipeline::GetShadowSubmissions(), RenderPipeline::GetShadowLayersReused());
+	ImGui::Text("Shadow atlas: %.0f%% used, %zu repacks", RenderPipeline::GetShadowAtlasUsage() * 100.0f, RenderPipeline::GetShadowAtlasRepacks());
+	ImGui::Text("Light cluster entries: %zu, dropped: %zu", RenderPipeline::GetLightClusterEntries(), RenderPipeline::GetLightClusterDropped());
+	ImGui::Text("Uniforms set: %zu of %zu requested", RenderPipeline::GetUniformsSent(), RenderPipeline::GetUniformsRequested());
+	ImGui::Text("Scene rebinds: %zu programs, %zu textures", RenderPipeline::GetProgramRebinds(), RenderPipeline::GetTextureRebinds());
+	const std::pair<gfx::Renderer::SSAO_QUALITY, const char*> ssao_modes[] = {
+		{ gfx::Renderer::SSAO_FULL, "Full" },
+		{ gfx::Renderer::SSAO_HALF, "Half" },
+		{ gfx::Renderer::SSAO_QUARTER, "Quarter" }
+	};
+	auto ssao_quality = RenderPipeline::GetSsaoQuality();
+	const char* ssao_name = "Full";
+	for (const auto& [mode, name] : ssao_modes)
+	{
+		if (mode == ssao_quality)
+			ssao_name = name;
+	}
+	if (ImGui::BeginCombo("SSAO resolution", ssao_name)) {
+		for (const auto& [mode, name] : ssao_modes)
+		{
+			if (ImGui::Selectable(name, mode == ssao_quality))
+				RenderPipeline::SetSsaoQuality(mode);
+		}
+		ImGui::EndCombo();
+	}
+
+	ImGui::Text("Redrawn: %s", RenderPipeline::GetDepthRedrawn() ? "everything" : RenderPipeline::GetSceneRedrawn() ? "scene pass only" : "nothing");
+	for (const auto& stats : RenderPipeline::GetCullStats())
+		ImGui::Text("%s: %zu visible, %zu culled", stats.pass.c_str(), stats.visible, stats.culled);
+
+	auto root = Engine::GetCurrentRoot();
+	if (root != nullptr)
+		ImGui::Text("Handler casts: %zu performed, %zu avoided", root->GetCastsPerformed(), root->GetCastsAvoided());
 }
 
 std::string gbe::editor::StateWindow::GetWindowId()
@@ -26,13 +26,16 @@ void gbe::Transform::Reset() {
 
 gbe::Matrix4 gbe::Transform::GetMatrix(bool include_scale) const
 {
+	if (this->matrix_dirty)
+		this->RebuildMatrix();
+
 	if(include_scale)
 		return this->updated_matrix_with_scale;
 	else
 		return this->updated_matrix_without_scale;
 }
 
-void gbe::Transform::OnComponentChange(TransformChangeType value, bool silent)
+void gbe::Transform::RebuildMatrix() const
 {
 	auto newmat = Matrix4();
 	newmat = glm::translate(newmat, this->position.Get());
@@ -53,14 +56,20 @@ void gbe::Transform::OnComponentChange(TransformChangeType value, bool silent)
 	newmat = glm::scale(newmat, this->scale.Get());
 
 	this->updated_matrix_with_scale = newmat;
+	this->matrix_dirty = false;
 
 	if(!this->updated_matrix_without_scale.isfinite())
 		throw std::runtime_error("NAN transform matrix generated.");
 	if (!this->updated_matrix_with_scale.isfinite())
 		throw std::runtime_error("NAN transform matrix generated.");
+}
 
-	if (value == TransformChangeType::ROTATION)
-		this->UpdateAxisVectors();
+void gbe::Transform::OnComponentChange(TransformChangeType value, bool silent)
+{
+	this->matrix_dirty = true;
+
+	if (value & TransformChangeType::ROTATION)
+		this->axis_dirty = true;
 
 	if (!silent && this->onChange)
 		this->onChange(value);
@@ -68,20 +77,31 @@ void gbe::Transform::OnComponentChange(TransformChangeType value, bool silent)
 
 const gbe::Vector3& gbe::Transform::GetRight()
 {
+	if (this->axis_dirty)
+		this->UpdateAxisVectors();
+
 	return this->Right;
 }
 
 const gbe::Vector3& gbe::Transform::GetUp()
 {
+	if (this->axis_dirty)
+		this->UpdateAxisVectors();
+
 	return this->Up;
 }
 const gbe::Vector3& gbe::Transform::GetForward()
 {
+	if (this->axis_dirty)
+		this->UpdateAxisVectors();
+
 	return this->Forward;
 }
 
 void gbe::Transform::UpdateAxisVectors()
 {
+	this->axis_dirty = false;
+
 	auto newbasismat = glm::toMat4(this->rotation.Get());
 	this->Right= (Vector3)newbasismat[0];
 	this->Up=(Vector3)newbasismat[1];
@@ -109,7 +129,6 @@ void gbe::Transform::SetMatrix(Matrix4 mat, bool silent) {
 		this->rotation.Get() = _rotation;
 		this->Skew = _skew;
 
-		UpdateAxisVectors();
 		OnComponentChange(TransformChangeType::ALL, silent);
 	}
 	else {
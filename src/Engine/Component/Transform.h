@@ -7,12 +7,16 @@
 namespace gbe {
 	class Transform {
 	private:
-		Matrix4 updated_matrix_without_scale;
-		Matrix4 updated_matrix_with_scale;
+		//Rebuilt lazily on read, writes only invalidate them
+		mutable Matrix4 updated_matrix_without_scale;
+		mutable Matrix4 updated_matrix_with_scale;
+		mutable bool matrix_dirty = true;
+		bool axis_dirty = false;
 
 		std::function<void(TransformChangeType)> onChange;
 
 		void UpdateAxisVectors();
+		void RebuildMatrix() const;
 		void OnComponentChange(TransformChangeType type, bool silent = false);
 
 		//AXIS VECTORS
@@ -47,6 +51,12 @@ namespace gbe {
 			});
 
 		void Reset();
+		/// <summary>
+		/// Marks the matrix stale after components were written through Get() without notifying.
+		/// </summary>
+		inline void Invalidate(TransformChangeType type) {
+			OnComponentChange(type, true);
+		}
 
 		Transform();
 		Transform(std::function<void(TransformChangeType)> onChange);
@@ -0,0 +1,398 @@
+#include "TransformHierarchy.h"
+
+#include "Engine/Objects/Object.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+std::vector<gbe::Matrix4> gbe::TransformHierarchy::local_matrices;
+std::vector<gbe::Matrix4> gbe::TransformHierarchy::world_matrices;
+std::vector<uint32_t> gbe::TransformHierarchy::world_versions;
+std::vector<int32_t> gbe::TransformHierarchy::parent_indices;
+std::vector<uint8_t> gbe::TransformHierarchy::flags;
+std::vector<uint8_t> gbe::TransformHierarchy::change_types;
+std::vector<gbe::Object*> gbe::TransformHierarchy::owners;
+
+std::vector<gbe::TransformHierarchy::Slot> gbe::TransformHierarchy::index_to_slot;
+std::vector<uint32_t> gbe::TransformHierarchy::slot_to_index;
+std::vector<gbe::TransformHierarchy::Slot> gbe::TransformHierarchy::free_slots;
+
+bool gbe::TransformHierarchy::deferred = false;
+std::vector<gbe::TransformHierarchy::Slot> gbe::TransformHierarchy::pending_slots;
+size_t gbe::TransformHierarchy::recomputed_total = 0;
+
+bool gbe::TransformHierarchy::parallel_writes = false;
+std::mutex gbe::TransformHierarchy::pending_mutex;
+thread_local gbe::Object* gbe::TransformHierarchy::parallel_writer = nullptr;
+
+std::vector<uint32_t> gbe::TransformHierarchy::chain_scratch;
+std::vector<uint32_t> gbe::TransformHierarchy::changed_scratch;
+std::vector<gbe::TransformHierarchy::Notification> gbe::TransformHierarchy::notification_scratch;
+
+bool gbe::TransformHierarchy::order_dirty = false;
+size_t gbe::TransformHierarchy::dirty_count = 0;
+uint32_t gbe::TransformHierarchy::version_counter = 0;
+
+namespace {
+	template<typename T>
+	void Permute(std::vector<T>& arr, const std::vector<uint32_t>& order) {
+		std::vector<T> sorted;
+		sorted.reserve(order.size());
+
+		for (const auto old_index : order)
+			sorted.push_back(arr[old_index]);
+
+		arr.swap(sorted);
+	}
+}
+
+gbe::TransformHierarchy::Slot gbe::TransformHierarchy::Register(Object* owner)
+{
+	Slot slot;
+
+	if (!free_slots.empty()) {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	else {
+		slot = (Slot)slot_to_index.size();
+		slot_to_index.push_back(UINT32_MAX);
+	}
+
+	//New nodes are roots at the end of the arrays, which keeps the parent-sorted order intact
+	uint32_t index = (uint32_t)owners.size();
+
+	local_matrices.push_back(Matrix4(1.0f));
+	world_matrices.push_back(Matrix4(1.0f));
+	world_versions.push_back(++version_counter);
+	parent_indices.push_back(-1);
+	flags.push_back(0);
+	change_types.push_back(TransformChangeType::NONE);
+	owners.push_back(owner);
+	index_to_slot.push_back(slot);
+
+	slot_to_index[slot] = index;
+
+	return slot;
+}
+
+void gbe::TransformHierarchy::UnRegister(Slot slot)
+{
+	if (slot == INVALID_SLOT || slot_to_index[slot] == UINT32_MAX)
+		return;
+
+	uint32_t index = slot_to_index[slot];
+
+	//Leave a hole, compacted on the next rebuild
+	owners[index] = nullptr;
+	flags[index] = 0;
+	slot_to_index[slot] = UINT32_MAX;
+	free_slots.push_back(slot);
+
+	order_dirty = true;
+}
+
+void gbe::TransformHierarchy::SetParent(Slot slot, Slot parent)
+{
+	uint32_t index = slot_to_index[slot];
+	int32_t parent_index = (parent == INVALID_SLOT) ? -1 : (int32_t)slot_to_index[parent];
+
+	parent_indices[index] = parent_index;
+
+	if (parent_index > (int32_t)index)
+		order_dirty = true;
+
+	if ((flags[index] & (DIRTY | REPARENTED)) == 0)
+		dirty_count++;
+
+	flags[index] |= REPARENTED;
+	change_types[index] |= TransformChangeType::ALL;
+}
+
+void gbe::TransformHierarchy::SetLocal(Slot slot, const Matrix4& localmatrix, TransformChangeType changetype)
+{
+	uint32_t index = slot_to_index[slot];
+
+	local_matrices[index] = localmatrix;
+
+	if ((flags[index] & (DIRTY | REPARENTED | DATA_PENDING)) == 0)
+		dirty_count++;
+
+	flags[index] = (flags[index] & ~DATA_PENDING) | DIRTY;
+	change_types[index] |= changetype;
+}
+
+void gbe::TransformHierarchy::MarkPending(Slot slot)
+{
+	std::unique_lock<std::mutex> lock(pending_mutex, std::defer_lock);
+	if (parallel_writes)
+		lock.lock();
+
+	uint32_t index = slot_to_index[slot];
+
+	if ((flags[index] & (DIRTY | REPARENTED | DATA_PENDING)) == 0)
+		dirty_count++;
+
+	flags[index] |= DATA_PENDING;
+
+	if ((flags[index] & QUEUED) == 0) {
+		flags[index] |= QUEUED;
+		pending_slots.push_back(slot);
+	}
+}
+
+void gbe::TransformHierarchy::ResolveChain(uint32_t index)
+{
+	//Pull deferred writes of this chain into the store first, top-down so each sees its resolved parent
+	bool has_unresolved = false;
+	for (int32_t cur = (int32_t)index; cur >= 0 && !has_unresolved; cur = parent_indices[cur])
+		has_unresolved = (flags[cur] & DATA_PENDING) != 0;
+
+	if (has_unresolved) {
+		std::vector<uint32_t> unresolved;
+		for (int32_t cur = (int32_t)index; cur >= 0; cur = parent_indices[cur])
+		{
+			if (flags[cur] & DATA_PENDING)
+				unresolved.push_back(cur);
+		}
+		for (auto it = unresolved.rbegin(); it != unresolved.rend(); ++it)
+			owners[*it]->ResolvePendingTransform();
+	}
+
+	//Find the top-most dirty node above (and including) this one
+	int32_t top = -1;
+	for (int32_t cur = (int32_t)index; cur >= 0; cur = parent_indices[cur])
+	{
+		if (flags[cur] & (DIRTY | REPARENTED))
+			top = cur;
+	}
+
+	if (top < 0)
+		return;
+
+	auto& chain = chain_scratch;
+	chain.clear();
+
+	for (int32_t cur = (int32_t)index; ; cur = parent_indices[cur])
+	{
+		chain.push_back(cur);
+
+		if (cur == top)
+			break;
+	}
+
+	//Flags are left untouched so the sweep still notifies the whole subtree
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+	{
+		uint32_t cur = *it;
+		int32_t p = parent_indices[cur];
+
+		world_matrices[cur] = (p >= 0) ? Matrix4(world_matrices[p] * local_matrices[cur]) : local_matrices[cur];
+		world_versions[cur] = ++version_counter;
+	}
+}
+
+const gbe::Matrix4& gbe::TransformHierarchy::GetWorldMatrix(Slot slot)
+{
+	uint32_t index = slot_to_index[slot];
+
+	if (!parallel_writes && dirty_count > 0)
+		ResolveChain(index);
+
+	return world_matrices[index];
+}
+
+uint32_t gbe::TransformHierarchy::GetWorldVersion(Slot slot)
+{
+	uint32_t index = slot_to_index[slot];
+
+	if (!parallel_writes && dirty_count > 0)
+		ResolveChain(index);
+
+	return world_versions[index];
+}
+
+void gbe::TransformHierarchy::Rebuild()
+{
+	const uint32_t count = (uint32_t)owners.size();
+
+	//Intrusive child lists so the rebuild does not allocate per node
+	std::vector<uint32_t> first_child(count, UINT32_MAX);
+	std::vector<uint32_t> next_sibling(count, UINT32_MAX);
+	std::vector<uint32_t> roots;
+
+	for (uint32_t i = count; i-- > 0;)
+	{
+		if (owners[i] == nullptr)
+			continue;
+
+		int32_t p = parent_indices[i];
+
+		if (p >= 0 && owners[p] != nullptr) {
+			next_sibling[i] = first_child[p];
+			first_child[p] = i;
+		}
+		else {
+			roots.push_back(i);
+		}
+	}
+
+	//Depth-first preorder keeps every subtree contiguous
+	std::vector<uint32_t> order;
+	order.reserve(count);
+	std::vector<uint32_t> stack;
+
+	for (auto root_it = roots.rbegin(); root_it != roots.rend(); ++root_it)
+	{
+		stack.push_back(*root_it);
+
+		while (!stack.empty())
+		{
+			uint32_t cur = stack.back();
+			stack.pop_back();
+			order.push_back(cur);
+
+			//Push in reverse so the first child is visited first
+			size_t stack_start = stack.size();
+			for (uint32_t child = first_child[cur]; child != UINT32_MAX; child = next_sibling[child])
+				stack.push_back(child);
+			std::reverse(stack.begin() + stack_start, stack.end());
+		}
+	}
+
+	std::vector<int32_t> old_to_new(count, -1);
+	for (uint32_t new_index = 0; new_index < (uint32_t)order.size(); new_index++)
+		old_to_new[order[new_index]] = (int32_t)new_index;
+
+	Permute(local_matrices, order);
+	Permute(world_matrices, order);
+	Permute(world_versions, order);
+	Permute(parent_indices, order);
+	Permute(flags, order);
+	Permute(change_types, order);
+	Permute(owners, order);
+	Permute(index_to_slot, order);
+
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+	{
+		int32_t p = parent_indices[i];
+		parent_indices[i] = (p >= 0) ? old_to_new[p] : -1;
+
+		slot_to_index[index_to_slot[i]] = i;
+	}
+
+	order_dirty = false;
+}
+
+size_t gbe::TransformHierarchy::Sweep()
+{
+	if (order_dirty)
+		Rebuild();
+
+	if (dirty_count == 0)
+		return 0;
+
+	auto& notifications = notification_scratch;
+	auto& changed = changed_scratch;
+	notifications.clear();
+	changed.clear();
+
+	const uint32_t count = (uint32_t)owners.size();
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int32_t p = parent_indices[i];
+		bool parent_changed = p >= 0 && (flags[p] & CHANGED);
+
+		if ((flags[i] & (DIRTY | REPARENTED)) == 0 && !parent_changed)
+			continue;
+
+		if (parent_changed)
+			change_types[i] |= change_types[p];
+
+		world_matrices[i] = (p >= 0) ? Matrix4(world_matrices[p] * local_matrices[i]) : local_matrices[i];
+		world_versions[i] = ++version_counter;
+
+		if (parent_changed || (flags[i] & REPARENTED))
+			notifications.push_back({
+				owners[i],
+				(TransformChangeType)change_types[i],
+				(p >= 0) ? world_matrices[p] : Matrix4(1.0f)
+				});
+
+		flags[i] = (flags[i] & (DATA_PENDING | QUEUED)) | CHANGED;
+		changed.push_back(i);
+	}
+
+	//Clear before notifying, handlers may write transforms again
+	for (const auto i : changed)
+	{
+		flags[i] &= ~CHANGED;
+		change_types[i] = TransformChangeType::NONE;
+	}
+	//Only objects still queued can hold unresolved writes
+	dirty_count = pending_slots.size();
+
+	for (const auto& notification : notifications)
+	{
+		if (notification.owner->get_isDestroyed())
+			continue;
+
+		notification.owner->OnExternalTransformationChange(notification.changetype, notification.parentmatrix);
+	}
+
+	return changed.size();
+}
+
+size_t gbe::TransformHierarchy::Flush()
+{
+	//Commits may queue more writes, so iterate by index until the list settles
+	for (size_t i = 0; i < pending_slots.size(); i++)
+	{
+		uint32_t index = slot_to_index[pending_slots[i]];
+
+		if (index == UINT32_MAX || (flags[index] & QUEUED) == 0)
+			continue;
+
+		flags[index] &= ~QUEUED;
+		owners[index]->CommitTransform();
+	}
+	pending_slots.clear();
+
+	size_t recomputed = Sweep();
+	recomputed_total += recomputed;
+
+	return recomputed;
+}
+
+void gbe::TransformHierarchy::BeginParallelWrites()
+{
+	if (!deferred)
+		throw std::runtime_error("Parallel transform writes require deferred mode.");
+
+	parallel_writes = true;
+}
+
+void gbe::TransformHierarchy::EndParallelWrites()
+{
+	parallel_writes = false;
+}
+
+void gbe::TransformHierarchy::SetParallelWriter(Object* writer)
+{
+	parallel_writer = writer;
+}
+
+void gbe::TransformHierarchy::CheckTransformAccess(Object* owner)
+{
+	if (parallel_writes && parallel_writer != owner)
+		throw std::runtime_error("Only WorldMatrix() of other objects can be read during a parallel update.");
+}
+
+void gbe::TransformHierarchy::SetDeferred(bool value)
+{
+	if (deferred && !value)
+		Flush();
+
+	deferred = value;
+}
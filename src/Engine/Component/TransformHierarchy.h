@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+#include "TransformChangeType.h"
+
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+namespace gbe {
+	class Object;
+
+	/// <summary>
+	/// Contiguous storage of every object's local and world matrices.
+	/// Nodes are kept parent-sorted (a parent always sits at a lower index than its children),
+	/// so dirty world matrices can be resolved in one linear sweep instead of recursing per object.
+	/// Objects refer to their node through a stable slot; dense indices move when the arrays are compacted.
+	/// In deferred mode, Transform writes only queue the owning object; Flush() commits each queued object once.
+	/// </summary>
+	class TransformHierarchy {
+	public:
+		typedef uint32_t Slot;
+		static constexpr Slot INVALID_SLOT = UINT32_MAX;
+	private:
+		enum NodeFlags : uint8_t {
+			DIRTY = 1 << 0,			//Local matrix changed since the last sweep
+			REPARENTED = 1 << 1,	//Parent changed since the last sweep
+			CHANGED = 1 << 2,		//World matrix was recomputed in the current sweep
+			DATA_PENDING = 1 << 3,	//Owner holds deferred writes not yet pushed into the store
+			QUEUED = 1 << 4,		//Owner is in the pending list and awaits its commit
+		};
+
+		//SoA NODE DATA, indexed by dense index
+		static std::vector<Matrix4> local_matrices;
+		static std::vector<Matrix4> world_matrices;
+		static std::vector<uint32_t> world_versions;
+		static std::vector<int32_t> parent_indices;
+		static std::vector<uint8_t> flags;
+		static std::vector<uint8_t> change_types;
+		static std::vector<Object*> owners;
+
+		//STABLE HANDLES
+		static std::vector<Slot> index_to_slot;
+		static std::vector<uint32_t> slot_to_index;
+		static std::vector<Slot> free_slots;
+
+		//DEFERRED COMMITS
+		static bool deferred;
+		static std::vector<Slot> pending_slots;
+		static size_t recomputed_total;
+
+		//PARALLEL WRITES
+		static bool parallel_writes;
+		static std::mutex pending_mutex;
+		//Object whose update the calling thread is running while parallel writes are open
+		static thread_local Object* parallel_writer;
+
+		//SCRATCH, reused so resolving and sweeping do not allocate every frame. Never touched while parallel writes are open
+		struct Notification {
+			Object* owner;
+			TransformChangeType changetype;
+			Matrix4 parentmatrix;
+		};
+		static std::vector<uint32_t> chain_scratch;
+		static std::vector<uint32_t> changed_scratch;
+		static std::vector<Notification> notification_scratch;
+
+		static bool order_dirty;
+		static size_t dirty_count;
+		static uint32_t version_counter;
+
+		static void Rebuild();
+		static void ResolveChain(uint32_t index);
+	public:
+		static Slot Register(Object* owner);
+		static void UnRegister(Slot slot);
+
+		static void SetParent(Slot slot, Slot parent);
+		static void SetLocal(Slot slot, const Matrix4& localmatrix, TransformChangeType changetype);
+		/// <summary>
+		/// Queues the owner of a node for the next Flush(). Its data is pulled in early if something reads through it.
+		/// </summary>
+		static void MarkPending(Slot slot);
+
+		/// <summary>
+		/// Returns the up to date world matrix of a node, resolving only its own dirty ancestor chain if needed.
+		/// The reference is only valid until the next Register call.
+		/// </summary>
+		static const Matrix4& GetWorldMatrix(Slot slot);
+		/// <summary>
+		/// Increments every time the node's world matrix is recomputed.
+		/// </summary>
+		static uint32_t GetWorldVersion(Slot slot);
+
+		/// <summary>
+		/// Recomputes every dirty subtree once, parents first, then notifies moved descendants.
+		/// </summary>
+		/// <returns>The number of world matrices recomputed.</returns>
+		static size_t Sweep();
+		/// <summary>
+		/// Commits every queued object once, then sweeps. Call once per frame phase.
+		/// </summary>
+		/// <returns>The number of world matrices recomputed.</returns>
+		static size_t Flush();
+
+		/// <summary>
+		/// While open, MarkPending may be called from job threads and reads return the last flushed
+		/// world matrices without resolving anything. Only valid in deferred mode.
+		/// </summary>
+		static void BeginParallelWrites();
+		static void EndParallelWrites();
+		/// <summary>
+		/// Sets the object whose update the calling thread runs next, or nullptr once it is done.
+		/// </summary>
+		static void SetParallelWriter(Object* writer);
+		/// <summary>
+		/// Throws if parallel writes are open and the calling thread is not running this object's update.
+		/// Other objects may only be read through their WorldMatrix() then.
+		/// </summary>
+		static void CheckTransformAccess(Object* owner);
+
+		static void SetDeferred(bool value);
+		inline static bool IsDeferred() {
+			return deferred;
+		}
+		/// <summary>
+		/// Total world matrices recomputed by every flush so far.
+		/// </summary>
+		inline static size_t GetRecomputedTotal() {
+			return recomputed_total;
+		}
+
+		inline static size_t GetNodeCount() {
+			return owners.size();
+		}
+	};
+}
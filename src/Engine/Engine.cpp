@@ -1,4 +1,5 @@
 #include "Engine.h"
+#include "Global/Console.h"
 
 #include "Editor/gbe_editor.h"
 #include "Math/gbe_math.h"
@@ -70,9 +71,14 @@ namespace gbe {
 		root_object->RegisterHandler(new ObjectHandler<Update>());
 		root_object->RegisterHandler(new ObjectHandler<LateUpdate>());
 
-		if (data != nullptr)
+		if (data != nullptr) {
 			root_object->LoadChildren(data);
 
+			Console::Log("Scene loaded: " + std::to_string(root_object->GetMembershipLookups()) + " objects, "
+				+ std::to_string(root_object->GetCastsPerformed()) + " handler casts, "
+				+ std::to_string(root_object->GetCastsAvoided()) + " avoided.");
+		}
+
 		return root_object;
 	}
 
@@ -80,11 +86,11 @@ namespace gbe {
 		Camera* current_camera = nullptr;
 		auto camera_handler = instance->current_root->GetHandler<Camera>();
 
-		for (const auto& cpair : camera_handler->object_list)
+		for (size_t i = 0; i < camera_handler->Count(); i++)
 		{
-			auto cam = cpair.second;
+			auto cam = camera_handler->At(i);
 
-			if (!cam->Get_enabled())
+			if (!camera_handler->IsEnabledAt(i))
 				continue;
 			if (instance->Get_state() == EngineState::Edit && !cam->GetEditorFlag(Object::EXCLUDE_FROM_OBJECT_TREE))
 				continue;
@@ -132,14 +138,9 @@ namespace gbe {
 
 			instance->time.scale = 1;
 
-			auto& objlist = instance->current_root->GetHandler<PhysicsObject>()->object_list;
-			for (const auto& pair : objlist) {
-				auto& physicsobject = pair.second;
-				if (!physicsobject->Get_enabled())
-					continue;
-				
+			instance->current_root->GetHandler<PhysicsObject>()->ForEachEnabled([](PhysicsObject* physicsobject) {
 				physicsobject->ForceWake();
-			}
+				});
 
 			if (instance->state == EngineState::Edit)
 				Console::Log("Entering Play Mode...");
@@ -272,9 +273,14 @@ namespace gbe {
 
 #pragma endregion
 #pragma region MAIN LOOP
+		//Transform writes are queued from here on and committed at the flush points of each frame phase
+		TransformHierarchy::SetDeferred(true);
+
 		/// MAIN GAME LOOP
 		while (!this->window.ShouldClose())
 		{
+			size_t transforms_recomputed = 0;
+
 			if (this->state == Engine::EngineState::Paused) {
 				if (this->timeleft_stepping > 0)
 					this->time.scale = 1;
@@ -300,32 +306,29 @@ namespace gbe {
 			auto teststate = this->window.GetKeyState(1) == true;
 			if (editor != nullptr && !editor->FocusedOnEditorUI())
 				mInputSystem->UpdateStates([=](std::string name, gbe::input::InputAction* action, bool changed) {
-				for (auto& pair : inputhandler->object_list) {
-					auto& input_player = pair.second;
-
-					if (!input_player->Get_enabled())
-						continue;
+				inputhandler->ForEachEnabled([&](InputPlayer* input_player) {
 					if (input_player->get_player_name() != name)
-						continue;
+						return;
 					if (this->Get_state() == EngineState::Edit && !input_player->GetEditorFlag(Object::EXCLUDE_FROM_OBJECT_TREE))
-						continue;
+						return;
 					if (this->Get_state() != EngineState::Edit && input_player->GetEditorFlag(Object::EXCLUDE_FROM_OBJECT_TREE))
-						continue;
-
-					for (auto& pair : input_player->controllers.object_list) {
-						auto& controller = pair.second;
+						return;
 
+					input_player->controllers.ForEach([action, changed](ControllerBase* controller) {
 						controller->ForEach_inputreceivers([action, changed](InputCustomer_base* input_customer) {
 							input_customer->TryReceive(action, changed);
 							});
-					}
-				}
+						});
+					});
 					}, &this->window);
 
 			//Update GUI system
 
+			//Commit input, editor and deletion writes before anything renders
+			transforms_recomputed += TransformHierarchy::Flush();
+
 			//Early update
-			this->current_root->GetHandler<EarlyUpdate>()->DoOnEnabled([](EarlyUpdate* updatable) {
+			this->current_root->GetHandler<EarlyUpdate>()->ForEachEnabled([](EarlyUpdate* updatable) {
 				updatable->InvokeEarlyUpdate();
 				});
 
@@ -333,11 +336,16 @@ namespace gbe {
 			//EDITOR pushing
 			editor->PrepareUpdate();
 
+			//Commit early update writes, then hand only the renderers that moved to the pipeline
+			transforms_recomputed += TransformHierarchy::Flush();
+			RenderObject::SyncChangedInstances();
+
 			gfx::SceneRenderInfo frameinfo{};
 			frameinfo.pointer_pixelpos = this->window.GetMousePixelPos();
+			frameinfo.debug_textures = editor != nullptr && editor->IsImageDebuggerOpen();
 
 			//Lights colating
-			this->current_root->GetHandler<LightObject>()->DoOnEnabled([&](LightObject* light) {
+			this->current_root->GetHandler<LightObject>()->ForEachEnabled([&](LightObject* light) {
 				frameinfo.lightdatas.push_back(light->GetData());
 				});
 
@@ -348,14 +356,6 @@ namespace gbe {
 				frameinfo.nearclip = current_camera->nearClip;
 				frameinfo.viewmat = current_camera->GetViewMat();
 				frameinfo.projmat = current_camera->GetProjectionMat();
-				frameinfo.projmat_lightusage = current_camera->GetProjectionMat(20);
-				
-				if (current_camera->GetMoved()) {
-					frameinfo.skip_main_pass = false;
-					current_camera->OnRender();
-				}
-				else
-					frameinfo.skip_main_pass = true;
 			}
 			else {
 
@@ -378,14 +378,26 @@ namespace gbe {
 			this->time.UpdateTime();
 			this->time.TickFixed(onTick);
 
-			//Normal Update
-			updatehandler->DoOnEnabled([this](Update* updatable) {
-				updatable->InvokeUpdate(this->time.GetDeltaTime());
-				});
+			//Commit physics writes once instead of per body
+			transforms_recomputed += TransformHierarchy::Flush();
+
+			//Normal Update, objects that declared parallel-safe access run across the job system before the legacy serial ones
+			TransformHierarchy::BeginParallelWrites();
+			updatehandler->ForEachEnabledParallel(
+				[](Update* updatable) { return CanUpdateInParallel(updatable->GetUpdateAccess()); },
+				[this](Update* updatable) { updatable->InvokeUpdate(this->time.GetDeltaTime()); },
+				[]() { TransformHierarchy::EndParallelWrites(); });
 			//Late Update
-			lateupdatehandler->DoOnEnabled([this](LateUpdate* updatable) {
-				updatable->InvokeLateUpdate(this->time.GetDeltaTime());
-				});
+			TransformHierarchy::BeginParallelWrites();
+			lateupdatehandler->ForEachEnabledParallel(
+				[](LateUpdate* updatable) { return CanUpdateInParallel(updatable->GetLateUpdateAccess()); },
+				[this](LateUpdate* updatable) { updatable->InvokeLateUpdate(this->time.GetDeltaTime()); },
+				[]() { TransformHierarchy::EndParallelWrites(); });
+
+			//Commit gameplay writes
+			transforms_recomputed += TransformHierarchy::Flush();
+			this->last_transforms_recomputed = transforms_recomputed;
+
 			instance->timeleft_stepping -= this->time.GetDeltaTime();
 
 			mInputSystem->ResetStates(&this->window);
@@ -405,28 +417,19 @@ namespace gbe {
 				}
 			}
 
-			std::list<Object*> toDeleteRoots;
-
-			this->current_root->CallRecursively([&toDeleteRoots](Object* object) {
-				if (object->get_isDestroyed()) {
-					toDeleteRoots.push_back(object);
-				}
-				}, false);
+			//Only the subtrees queued by Destroy() are visited, already detached and parents first
+			std::vector<Object*> deletees;
+			Object::TakeDestroyed(deletees);
 
-			for (auto rootdeletee : toDeleteRoots)
+			for (auto deletee : deletees)
 			{
-				rootdeletee->SetParent(nullptr);
-
-				rootdeletee->CallRecursively([](Object* child) {
-					for (auto& func : Engine::instance->on_delete_callbacks)
-						func((void*)child);
-
-					}, false);
+				for (auto& func : Engine::instance->on_delete_callbacks)
+					func((void*)deletee);
 			}
 
-			for (auto rootdeletee : toDeleteRoots)
+			for (auto it = deletees.rbegin(); it != deletees.rend(); ++it)
 			{
-				delete rootdeletee;
+				delete *it;
 			}
 
 			if (this->queued_rootchange != nullptr) {
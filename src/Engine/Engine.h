@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Global/Time.h"
+#include "Jobs/JobSystem.h"
 #include "Objects/Root.h"
 #include "Window/gbe_window.h"
 #include "Graphics/gbe_graphics.h"
@@ -20,6 +21,9 @@ namespace gbe {
 	private:
 		static Engine* instance;
 
+		//Constructed first so the renderer and asset loaders can queue jobs during startup
+		JobSystem jobsystem;
+
 		//COMPONENT OBJECTS
 		Window window;
 		RenderPipeline renderpipeline;
@@ -31,6 +35,7 @@ namespace gbe {
 		Time time;
 		double timeleft_stepping = 0;
 		EngineState state = EngineState::Edit;
+		size_t last_transforms_recomputed = 0;
 
 		//SCENE MANAGEMENT
 		std::vector<std::function<void(void*)>> on_delete_callbacks;
@@ -55,6 +60,15 @@ namespace gbe {
 		static bool ChangeRoot(Root* newroot);
 		static Root* CreateBlankRoot(SerializedObject* data = nullptr);
 		static Camera* GetActiveCamera();
+		/// <summary>
+		/// World matrices recomputed by the transform flushes of the last frame.
+		/// </summary>
+		inline static size_t GetTransformsRecomputed() {
+			return instance->last_transforms_recomputed;
+		}
+		inline static JobSystem* GetJobSystem() {
+			return &instance->jobsystem;
+		}
 		inline static Root* GetCurrentRoot() {
 			return instance->current_root;
 		}
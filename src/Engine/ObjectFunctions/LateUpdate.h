@@ -1,8 +1,16 @@
 #pragma once
 
+#include "UpdateAccess.h"
+
 namespace gbe {
 	class LateUpdate {
 	public:
 		virtual void InvokeLateUpdate(float deltatime) = 0;
+		/// <summary>
+		/// Override to opt into parallel dispatch. See UpdateAccess.
+		/// </summary>
+		inline virtual uint32_t GetLateUpdateAccess() {
+			return UPDATE_WRITES_UNKNOWN;
+		}
 	};
 }
\ No newline at end of file
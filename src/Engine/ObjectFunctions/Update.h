@@ -1,8 +1,16 @@
 #pragma once
 
+#include "UpdateAccess.h"
+
 namespace gbe {
 	class Update {
 	public:
 		virtual void InvokeUpdate(float deltatime) = 0;
+		/// <summary>
+		/// Override to opt into parallel dispatch. See UpdateAccess.
+		/// </summary>
+		inline virtual uint32_t GetUpdateAccess() {
+			return UPDATE_WRITES_UNKNOWN;
+		}
 	};
 }
\ No newline at end of file
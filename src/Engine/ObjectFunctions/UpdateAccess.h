@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace gbe {
+	/// <summary>
+	/// What an Update/LateUpdate implementer touches when invoked. Anything other than
+	/// UPDATE_WRITES_OWN_TRANSFORM keeps it on the serial main thread path.
+	/// </summary>
+	enum UpdateAccess : uint32_t {
+		//Only reads and writes its own members
+		UPDATE_THREAD_SAFE = 0,
+		//Writes its own Local()/World(). Other objects must only be read through WorldMatrix(), which returns the last flushed state, their Local()/World() throw
+		UPDATE_WRITES_OWN_TRANSFORM = 1 << 0,
+		//Spawns, destroys, reparents or enables objects
+		UPDATE_WRITES_HIERARCHY = 1 << 1,
+		//Touches physics, rendering, audio, input, the editor or any other engine singleton
+		UPDATE_WRITES_ENGINE = 1 << 2,
+		//Legacy default, nothing was declared
+		UPDATE_WRITES_UNKNOWN = 1u << 31,
+	};
+
+	constexpr uint32_t UPDATE_PARALLEL_ACCESS = UPDATE_WRITES_OWN_TRANSFORM;
+
+	inline bool CanUpdateInParallel(uint32_t access) {
+		return (access & ~UPDATE_PARALLEL_ACCESS) == 0;
+	}
+}
\ No newline at end of file
@@ -3,22 +3,105 @@
 #include <list>
 #include <vector>
 #include <functional>
+#include <unordered_map>
+#include <bit>
+#include <cstdint>
+#include <span>
 #include "Engine/Objects/Object.h"
+#include "Jobs/JobSystem.h"
 
 namespace gbe {
 	class Handler {
 	public:
 		virtual void Remove(Object* object) = 0;
 		virtual bool TryAdd(Object* object) = 0;
+		virtual void SetEnabled(Object* object, bool enabled) = 0;
+		/// <summary>
+		/// Removes or adds many objects in one call, used when whole subtrees move or are deleted.
+		/// </summary>
+		virtual void RemoveBulk(std::span<Object* const> removing) = 0;
+		virtual void TryAddBulk(std::span<Object* const> adding) = 0;
+
+		//OWN MEMBERSHIP, this handler only without forwarding to subhandlers. Root drives these from its per-type table
+		/// <summary>
+		/// Whether this handler takes the object. Only depends on the object's dynamic type.
+		/// </summary>
+		virtual bool AcceptsOwn(Object* object) = 0;
+		virtual bool AddOwn(Object* object) = 0;
+		virtual void RemoveOwn(std::span<Object* const> removing) = 0;
+		virtual void SetEnabledOwn(Object* object, bool enabled) = 0;
+		/// <summary>
+		/// Appends this handler and all of its subhandlers, depth-first.
+		/// </summary>
+		virtual void CollectHandlers(std::vector<Handler*>& out) = 0;
 	};
 
+	/// <summary>
+	/// Keeps every object of a type packed in one array, with a parallel enabled bitset
+	/// so per-frame dispatch walks contiguous memory and never touches disabled objects.
+	/// Removal swaps the last element into the hole, so iteration order is not stable.
+	/// </summary>
 	template<class TValue>
 	class ObjectHandler : public Handler {
 	protected:
 		std::vector<Handler*> subhandlers;
-	public:
-		std::unordered_map<Object*, TValue*> object_list;
 
+		//DENSE STORAGE, indexed together
+		std::vector<TValue*> objects;
+		std::vector<Object*> keys;
+		std::vector<uint64_t> enabled_bits;
+
+		std::unordered_map<Object*, size_t> index_map;
+
+		//Reused by ForEachEnabledParallel so dispatch does not allocate every frame
+		std::vector<uint32_t> parallel_scratch;
+		std::vector<TValue*> serial_scratch;
+
+		inline void SetBit(size_t index, bool value) {
+			if (value)
+				enabled_bits[index >> 6] |= (uint64_t)1 << (index & 63);
+			else
+				enabled_bits[index >> 6] &= ~((uint64_t)1 << (index & 63));
+		}
+
+		//Swap-and-pop, the moved object takes over the removed index
+		void RemoveAt(size_t index) {
+			size_t last = objects.size() - 1;
+
+			if (index != last) {
+				objects[index] = objects[last];
+				keys[index] = keys[last];
+				SetBit(index, IsEnabledAt(last));
+				index_map[keys[index]] = index;
+			}
+
+			SetBit(last, false);
+			objects.pop_back();
+			keys.pop_back();
+
+			if ((objects.size() + 63) / 64 < enabled_bits.size())
+				enabled_bits.pop_back();
+		}
+
+		//Walks the enabled bitset a word at a time and hands out dense indices
+		template<typename TAction>
+		void ForEachEnabledIndex(TAction&& action) {
+			for (size_t word = 0; word < enabled_bits.size(); word++)
+			{
+				uint64_t bits = enabled_bits[word];
+
+				while (bits != 0) {
+					size_t index = (word << 6) + std::countr_zero(bits);
+					bits &= bits - 1;
+
+					if (index >= objects.size())
+						break;
+
+					action(index);
+				}
+			}
+		}
+	public:
 		virtual void OnAdd(TValue*) {}
 		virtual void OnRemove(TValue*) {}
 
@@ -26,37 +109,218 @@ namespace gbe {
 			for (auto subhandler : this->subhandlers)
 				subhandler->Remove(object);
 
-			object_list.erase(object);
+			this->RemoveOwn({ &object, 1 });
+		}
+
+		virtual void RemoveBulk(std::span<Object* const> removing) {
+			for (auto subhandler : this->subhandlers)
+				subhandler->RemoveBulk(removing);
+
+			this->RemoveOwn(removing);
 		}
 
 		virtual bool TryAdd(Object* object) {
 			for (auto subhandler : this->subhandlers)
 				subhandler->TryAdd(object);
 
+			return this->AddOwn(object);
+		}
+
+		virtual void TryAddBulk(std::span<Object* const> adding) {
+			for (auto subhandler : this->subhandlers)
+				subhandler->TryAddBulk(adding);
+
+			objects.reserve(objects.size() + adding.size());
+			keys.reserve(keys.size() + adding.size());
+			index_map.reserve(index_map.size() + adding.size());
+
+			for (auto object : adding)
+				this->AddOwn(object);
+		}
+
+		virtual void SetEnabled(Object* object, bool enabled) {
+			for (auto subhandler : this->subhandlers)
+				subhandler->SetEnabled(object, enabled);
+
+			this->SetEnabledOwn(object, enabled);
+		}
+
+		virtual bool AcceptsOwn(Object* object) {
+			return dynamic_cast<TValue*>(object) != nullptr;
+		}
+
+		virtual bool AddOwn(Object* object) {
+			//Still needed to convert, TValue may be a secondary base of the object
 			TValue* typed_object = dynamic_cast<TValue*>(object);
 
 			if (typed_object == nullptr)
 				return false;
 
-			auto it = object_list.find(object);
-
-			if(it != object_list.end())
+			if (index_map.find(object) != index_map.end())
 				return false;
 
-			object_list.insert_or_assign(object, typed_object);
+			size_t index = objects.size();
+
+			objects.push_back(typed_object);
+			keys.push_back(object);
+			if ((index >> 6) >= enabled_bits.size())
+				enabled_bits.push_back(0);
+			SetBit(index, object->Get_enabled());
+
+			index_map.insert_or_assign(object, index);
 			OnAdd(typed_object);
 
 			return true;
 		}
 
-		void DoOnEnabled(std::function<void(TValue*)> action) {
-			for (auto& existing : this->object_list)
+		virtual void RemoveOwn(std::span<Object* const> removing) {
+			//A few removals from a large handler are cheaper one by one
+			if (removing.size() * 8 < objects.size()) {
+				for (auto object : removing)
+				{
+					auto it = index_map.find(object);
+
+					if (it == index_map.end())
+						continue;
+
+					size_t index = it->second;
+					index_map.erase(it);
+					RemoveAt(index);
+				}
+				return;
+			}
+
+			size_t found = 0;
+			for (auto object : removing)
+			{
+				auto it = index_map.find(object);
+
+				if (it == index_map.end())
+					continue;
+
+				keys[it->second] = nullptr;
+				index_map.erase(it);
+				found++;
+			}
+
+			if (found == 0)
+				return;
+
+			//Compact the survivors in one pass, keeping their order
+			size_t write = 0;
+			for (size_t read = 0; read < keys.size(); read++)
 			{
-				if(!existing.first->Get_enabled())
+				if (keys[read] == nullptr)
 					continue;
 
-				action(existing.second);
+				if (write != read) {
+					objects[write] = objects[read];
+					keys[write] = keys[read];
+					SetBit(write, IsEnabledAt(read));
+					index_map[keys[write]] = write;
+				}
+
+				write++;
+			}
+
+			objects.resize(write);
+			keys.resize(write);
+			enabled_bits.resize((write + 63) / 64);
+
+			if ((write & 63) != 0)
+				enabled_bits.back() &= ((uint64_t)1 << (write & 63)) - 1;
+		}
+
+		virtual void SetEnabledOwn(Object* object, bool enabled) {
+			auto it = index_map.find(object);
+
+			if (it == index_map.end())
+				return;
+
+			SetBit(it->second, enabled);
+		}
+
+		virtual void CollectHandlers(std::vector<Handler*>& out) {
+			out.push_back(this);
+
+			for (auto subhandler : this->subhandlers)
+				subhandler->CollectHandlers(out);
+		}
+
+		inline size_t Count() const {
+			return objects.size();
+		}
+		inline TValue* At(size_t index) const {
+			return objects[index];
+		}
+		inline bool IsEnabledAt(size_t index) const {
+			return (enabled_bits[index >> 6] >> (index & 63)) & 1;
+		}
+		inline const std::vector<TValue*>& GetObjects() const {
+			return objects;
+		}
+
+		/// <summary>
+		/// Calls the action on every member, enabled or not.
+		/// </summary>
+		template<typename TAction>
+		void ForEach(TAction&& action) {
+			for (size_t i = 0; i < objects.size(); i++)
+				action(objects[i]);
+		}
+
+		/// <summary>
+		/// Calls the action on every enabled member, skipping disabled ones 64 at a time.
+		/// Members added by the action may or may not be visited in the same pass.
+		/// </summary>
+		template<typename TAction>
+		void ForEachEnabled(TAction&& action) {
+			this->ForEachEnabledIndex([&](size_t index) { action(objects[index]); });
+		}
+
+		/// <summary>
+		/// Splits the enabled members by is_parallel. Those run in chunks on the job system, then
+		/// on_parallel_done is called, then the rest run serially on this thread in handler order.
+		/// </summary>
+		template<typename TFilter, typename TAction>
+		void ForEachEnabledParallel(TFilter&& is_parallel, TAction&& action, std::function<void()> on_parallel_done = nullptr, size_t min_chunk = 64) {
+			//Parallel members cannot change the hierarchy, so their indices hold until the serial ones run
+			parallel_scratch.clear();
+			serial_scratch.clear();
+
+			this->ForEachEnabledIndex([&](size_t index) {
+				if (is_parallel(objects[index]))
+					parallel_scratch.push_back((uint32_t)index);
+				else
+					serial_scratch.push_back(objects[index]);
+				});
+
+			//Each member may only touch its own transform, anything else fails its access check
+			const auto run_parallel = [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+				{
+					TransformHierarchy::SetParallelWriter(keys[parallel_scratch[i]]);
+					action(objects[parallel_scratch[i]]);
+				}
+				TransformHierarchy::SetParallelWriter(nullptr);
+				};
+
+			auto jobsystem = JobSystem::Get();
+
+			if (jobsystem != nullptr && !parallel_scratch.empty()) {
+				JobCounter counter;
+				jobsystem->ParallelFor(parallel_scratch.size(), min_chunk, run_parallel, &counter);
+				jobsystem->Wait(&counter);
+			}
+			else {
+				run_parallel(0, parallel_scratch.size());
 			}
+
+			if (on_parallel_done)
+				on_parallel_done();
+
+			for (auto member : serial_scratch)
+				action(member);
 		}
 	};
-}
\ No newline at end of file
+}
@@ -38,10 +38,7 @@ void gbe::PhysicsHandler::Update(double dt)
 
 	this->localpipeline->Tick(dt);
 
-	for (auto& pair : this->object_list) {
-
-		auto po = pair.second;
-
+	for (auto po : this->objects) {
 		auto ro = dynamic_cast<RigidObject*>(po);
 
 		if (ro == nullptr)
@@ -59,12 +56,9 @@ void gbe::PhysicsHandler::Update(double dt)
 		ro->World().position.Set(newpos);
 		ro->World().rotation.Set(newrot);
 
-		for (auto& fvpair : this->forcevolume_handler.object_list)
-		{
-			auto fv = fvpair.second;
-
+		this->forcevolume_handler.ForEach([ro](ForceVolume* fv) {
 			fv->TryApply(ro);
-		}
+			});
 	}
 }
 
@@ -1,8 +1,9 @@
 #include "GenericObject.h"
 
-gbe::GenericObject::GenericObject(std::function<void(GenericObject*, float delta)> n_Update)
+gbe::GenericObject::GenericObject(std::function<void(GenericObject*, float delta)> n_Update, uint32_t update_access)
 {
 	this->onUpdate = n_Update;
+	this->update_access = update_access;
 }
 
 void gbe::GenericObject::InvokeUpdate(float delta)
@@ -8,8 +8,12 @@ namespace gbe {
 	class GenericObject : public Object, public Update{
 	private:
 		std::function<void(GenericObject*, float)> onUpdate;
+		uint32_t update_access;
 	public:
-		GenericObject(std::function<void(GenericObject*, float)>);
+		GenericObject(std::function<void(GenericObject*, float)>, uint32_t update_access = UPDATE_WRITES_UNKNOWN);
 		void InvokeUpdate(float delta) override;
+		inline uint32_t GetUpdateAccess() override {
+			return this->update_access;
+		}
 	};
 }
\ No newline at end of file
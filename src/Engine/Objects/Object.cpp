@@ -7,115 +7,109 @@
 
 #include "Editor/gbe_editor.h"
 
-unsigned int gbe::Object::next_avail_id = 0;
-std::unordered_map<unsigned int, gbe::Object*> gbe::Object::valid_objects;
+std::vector<gbe::Object*> gbe::Object::pending_destroy;
+size_t gbe::Object::load_depth = 0;
 
 void gbe::Object::PushState(ObjectStateName state)
 {
 	if (this->isDestroyQueued)
 		return;
 
-	auto it = this->state_checkers.find(state);
-
-	if (it != this->state_checkers.end())
-	{
-		it->second.clear();
-	}
-	else {
-		this->state_checkers.insert_or_assign(state, std::vector<uint16_t>());
-	}
+	this->state_versions[state].fetch_add(1, std::memory_order_release);
 }
 
-bool gbe::Object::CheckState(ObjectStateName state, void* checker)
+void gbe::Object::OnLocalTransformationChange(TransformChangeType changetype)
 {
-	if (this->isDestroyQueued)
-		return false;
-
-	auto it = this->state_checkers.find(state);
-	
-	if (it != this->state_checkers.end())
-	{
-		if (checker == nullptr)
-			return true;
-
-		auto& checkers = it->second;
-
-		auto check_it = std::find(checkers.begin(), checkers.end(), (uint16_t)checker);
+	this->PushState(ObjectStateName::TRANSFORMED_LOCAL);
 
-		if (check_it == checkers.end()) {
-			checkers.push_back((uint16_t)checker);
-			return true;
-		}
+	if (isnan(this->local.GetMatrix()[0][0])) {
+		std::cerr << "NAN transform, resetting transform." << std::endl;
+		this->local.Reset();
 	}
 
-	return false;
+	//Only marks the node dirty, descendants are resolved on read or on the next sweep
+	TransformHierarchy::SetLocal(this->transform_slot, this->local.GetMatrix(), changetype);
 }
 
-void gbe::Object::OnLocalTransformationChange(TransformChangeType changetype)
+void gbe::Object::OnExternalTransformationChange(TransformChangeType changetype, Matrix4 newparentmatrix)
 {
-	this->PushState(ObjectStateName::TRANSFORMED_LOCAL);
+	this->PushState(ObjectStateName::TRANSFORMED_WORLD_NOT_LOCAL);
+}
 
-	auto worldmat = this->parent_matrix * this->local.GetMatrix();
+void gbe::Object::On_Change_enabled(bool _to)
+{
+	this->enabled_hierarchy = _to;
 
-	for (auto child : this->children)
-	{
-		if (child->get_isDestroyed())
-			continue;
+	//Handlers keep their own enabled bits so dispatch does not have to ask every object
+	if (this->root != nullptr)
+		this->root->OnObjectEnabledChange(this, _to);
+}
 
-		child->OnExternalTransformationChange(changetype, worldmat);
-	}
+gbe::Matrix4 gbe::Object::GetParentMatrix()
+{
+	if (this->parent == nullptr)
+		return Matrix4(1.0f);
 
-	//silent because only reflecting
-	this->world.SetMatrix(worldmat, true);
+	return this->parent->WorldMatrix();
+}
 
-	if (isnan(this->local.GetMatrix()[0][0])) {
-		std::cerr << "NAN transform, resetting transform." << std::endl;
-		this->local.Reset();
+void gbe::Object::OnLocalTransformWrite(TransformChangeType changetype)
+{
+	if (!TransformHierarchy::IsDeferred()) {
+		this->OnLocalTransformationChange(changetype);
+		return;
 	}
+
+	this->pending_local_change |= changetype;
+	this->transform_data_pending = true;
+	TransformHierarchy::MarkPending(this->transform_slot);
 }
 
-void gbe::Object::OnExternalTransformationChange(TransformChangeType changetype, Matrix4 newparentmatrix)
+void gbe::Object::ResolvePendingTransform()
 {
-	this->PushState(ObjectStateName::TRANSFORMED_WORLD_NOT_LOCAL);
+	if (!this->transform_data_pending)
+		return;
 
-	this->parent_matrix = newparentmatrix;
-	auto worldmat = this->parent_matrix * this->local.GetMatrix();
+	this->transform_data_pending = false;
+	TransformHierarchy::SetLocal(this->transform_slot, this->local.GetMatrix(), (TransformChangeType)this->pending_local_change);
+}
 
-	for (auto child : this->children)
-	{
-		child->OnExternalTransformationChange(changetype, worldmat);
-	}
+void gbe::Object::CommitTransform()
+{
+	this->ResolvePendingTransform();
 
-	//silent because only reflecting
-	this->world.SetMatrix(worldmat, true);
+	auto changetype = (TransformChangeType)this->pending_local_change;
+	this->pending_local_change = TransformChangeType::NONE;
 
-	if (isnan(this->local.GetMatrix()[0][0])) {
-		std::cerr << "NAN transform, resetting transform." << std::endl;
-		this->local.Reset();
-	}
+	if (changetype != TransformChangeType::NONE && !this->get_isDestroyed())
+		this->OnLocalTransformationChange(changetype);
 }
 
 void gbe::Object::GeneralInit()
 {
 	//TRANSFORM
-	this->parent_matrix = Matrix4(1.0f);
 	this->parent = nullptr;
 
+	if (this->transform_slot == TransformHierarchy::INVALID_SLOT)
+		this->transform_slot = TransformHierarchy::Register(this);
+
 	OnLocalTransformationChange(TransformChangeType::ALL);
-	OnExternalTransformationChange(TransformChangeType::ALL, this->parent_matrix);
+	OnExternalTransformationChange(TransformChangeType::ALL, Matrix4(1.0f));
 
+	//World writes become local writes straight away, so a later local write to the same component still wins
 	this->world.position.AddCallback([this](Vector3 oldval, Vector3 newval) {
 		if (this->get_isDestroyed()) return;
 
-		this->Local().position.Set(Vector3(parent_matrix.Inverted() * Vector4(newval, 1.0f)));
+		this->Local().position.Set(Vector3(this->GetParentMatrix().Inverted() * Vector4(newval, 1.0f)));
 		});
 	this->world.scale.AddCallback([this](Vector3 oldval, Vector3 newval) {
 		if (this->get_isDestroyed()) return;
 
 		Vector3 finalLocalScale;
 
+		//Decomposed from the parent's matrix, its World() may not be read during a parallel update
 		if (parent != nullptr) {
-			auto parent_scale = this->parent->World().scale.Get();
+			auto parent_scale = Transform(this->GetParentMatrix()).scale.Get();
 			finalLocalScale = Vector3(
 				newval.x / parent_scale.x,
 				newval.y / parent_scale.y,
@@ -131,7 +125,7 @@ void gbe::Object::GeneralInit()
 	this->world.rotation.AddCallback([this](Quaternion oldval, Quaternion newval) {
 		if (this->get_isDestroyed()) return;
 
-		auto parent_rot = Quaternion(parent_matrix);
+		auto parent_rot = Quaternion(this->GetParentMatrix());
 		auto new_local_rot = parent_rot.Inverted() * newval;
 		this->Local().rotation.Set(new_local_rot);
 		});
@@ -215,52 +209,78 @@ void gbe::Object::GeneralInit()
 		this->inspectorData->fields.push_back(field);
 	}
 
-	this->id = next_avail_id;
-	next_avail_id++;
-	valid_objects.insert_or_assign(this->id, this);
+	//Lights run GeneralInit a second time, keep the handle they already have
+	if (this->handle.IsNull())
+		this->handle = ObjectRegistry::Register(this);
 }
 
 gbe::Object::Object():
-	local(Transform([this](TransformChangeType type) {this->OnLocalTransformationChange(type); })),
+	local(Transform([this](TransformChangeType type) {this->OnLocalTransformWrite(type); })),
 	world()
 {
 	GeneralInit();
 }
 
 gbe::Object::~Object(){
+	TransformHierarchy::UnRegister(this->transform_slot);
+	ObjectRegistry::Release(this->handle);
 }
 
 gbe::Transform& gbe::Object::World()
 {
+	TransformHierarchy::CheckTransformAccess(this);
+
+	//Unflushed writes are not in the store yet, compose them with the parent instead of reading the stale stored matrix
+	if (this->transform_data_pending) {
+		this->world.SetMatrix(this->GetParentMatrix() * this->local.GetMatrix(), true);
+		this->world_version = 0;
+		return this->world;
+	}
+
+	auto version = TransformHierarchy::GetWorldVersion(this->transform_slot);
+
+	//Decompose only when the stored matrix changed since the last read
+	if (version != this->world_version) {
+		this->world.SetMatrix(TransformHierarchy::GetWorldMatrix(this->transform_slot), true);
+		this->world_version = version;
+	}
+
 	return this->world;
 }
 
+const gbe::Matrix4& gbe::Object::WorldMatrix()
+{
+	return TransformHierarchy::GetWorldMatrix(this->transform_slot);
+}
+
 gbe::Transform& gbe::Object::Local()
 {
+	TransformHierarchy::CheckTransformAccess(this);
+
 	return this->local;
 }
 
 void gbe::Object::ReEnterHierarchy()
 {
-	auto og_parent = this->parent;
+	for (Object* current = this->parent; current != nullptr; current = current->parent)
+		current->OnExitHierarchy(this);
 
-	if (og_parent != nullptr) {
-		og_parent->OnExitHierarchy(this);
-		og_parent->OnEnterHierarchy(this);
-	}
+	for (Object* current = this->parent; current != nullptr; current = current->parent)
+		current->OnEnterHierarchy(this);
 }
 
 void gbe::Object::OnEnterHierarchy(Object* newChild)
 {
-	Object* current = this->parent;
+	//Callers walk the ancestors, so every ancestor hears about an object exactly once
+	this->PushState(TREE_CHANGED);
+}
 
-	while (current != nullptr)
+void gbe::Object::OnEnterHierarchyBulk(std::span<Object* const> entering)
+{
+	for (const auto object : entering)
 	{
-		current->OnEnterHierarchy(newChild);
-		current = current->parent;
+		this->OnEnterHierarchy(object);
 	}
-
-	this->PushState(TREE_CHANGED);
 }
 
 void gbe::Object::OnExitHierarchy(Object* newChild)
@@ -268,6 +288,14 @@ void gbe::Object::OnExitHierarchy(Object* newChild)
 	this->PushState(TREE_CHANGED);
 }
 
+void gbe::Object::OnExitHierarchyBulk(std::span<Object* const> exiting)
+{
+	for (const auto object : exiting)
+	{
+		this->OnExitHierarchy(object);
+	}
+}
+
 gbe::Object* gbe::Object::GetParent()
 {
 	return this->parent;
@@ -278,43 +306,102 @@ void gbe::Object::SetParent(Object* newParent)
 	if (newParent == this->parent)
 		return;
 
-	if (parent != nullptr) {
-		auto propagate_upwards = [this](Object* message) {
-			Object* current = this->parent;
-
-			while (current != nullptr)
-			{
-				current->OnExitHierarchy(message);
-				current = current->parent;
-			}
-			};
+	//Collected once, each ancestor is told about the whole subtree in one call
+	std::vector<Object*> subtree;
+	this->CollectSubtree(subtree);
 
-		this->CallRecursively([propagate_upwards](Object* child) {
-			propagate_upwards(child);
-			});
+	if (parent != nullptr) {
+		for (Object* current = this->parent; current != nullptr; current = current->parent)
+			current->OnExitHierarchyBulk(subtree);
 
 		std::erase(parent->children, this);
 
-		this->parent_matrix = Matrix4(1.0f);
-
 		if (parent->enabled_hierarchy != this->enabled_hierarchy && this->enabled_self)
 			this->On_Change_enabled(parent->enabled_hierarchy);
 	}
 
 	if (newParent != nullptr) {
-		this->CallRecursively([newParent, this](Object* child) {
-			newParent->OnEnterHierarchy(child);
-			});
-		newParent->children.push_back(this);
+		for (Object* current = newParent; current != nullptr; current = current->parent)
+			current->OnEnterHierarchyBulk(subtree);
 
-		this->parent_matrix = newParent->World().GetMatrix();
+		newParent->children.push_back(this);
 	}
 
 	this->parent = newParent;
+	TransformHierarchy::SetParent(this->transform_slot, newParent != nullptr ? newParent->transform_slot : TransformHierarchy::INVALID_SLOT);
 
 	if (!this->isDestroyQueued) { //skip updators because they might access invalid memory
+		//The external change is dispatched by the next sweep
 		OnLocalTransformationChange(TransformChangeType::ALL);
-		OnExternalTransformationChange(TransformChangeType::ALL, this->parent_matrix);
+	}
+}
+
+void gbe::Object::AttachLoaded(Object* child)
+{
+	child->parent = this;
+	this->children.push_back(child);
+
+	TransformHierarchy::SetParent(child->transform_slot, this->transform_slot);
+	child->OnLocalTransformationChange(TransformChangeType::ALL);
+}
+
+void gbe::Object::AnnounceLoadedSubtree()
+{
+	//Depth-first, so the descendants of every loaded object follow it as one contiguous run
+	std::vector<Object*> subtree;
+	//Loaded ancestors of the object being visited, with where their run of descendants starts
+	std::vector<std::pair<Object*, size_t>> path;
+
+	struct Visit {
+		Object* object;
+		size_t depth;
+	};
+	std::vector<Visit> stack;
+
+	//An ancestor's run ends once the walk leaves it, it is then told about all of it in one call
+	const auto close_path = [&](size_t depth) {
+		while (path.size() > depth) {
+			auto [ancestor, start] = path.back();
+			path.pop_back();
+
+			if (subtree.size() > start)
+				ancestor->OnEnterHierarchyBulk(std::span<Object* const>(subtree.data() + start, subtree.size() - start));
+		}
+		};
+
+	for (auto it = this->children.rbegin(); it != this->children.rend(); ++it)
+		stack.push_back({ *it, 0 });
+
+	while (!stack.empty())
+	{
+		auto visit = stack.back();
+		stack.pop_back();
+
+		close_path(visit.depth);
+
+		subtree.push_back(visit.object);
+		path.push_back({ visit.object, subtree.size() });
+
+		for (auto it = visit.object->children.rbegin(); it != visit.object->children.rend(); ++it)
+			stack.push_back({ *it, visit.depth + 1 });
+	}
+	close_path(0);
+
+	//This object and everything above it take the whole tree at once
+	for (Object* current = this; current != nullptr; current = current->parent)
+		current->OnEnterHierarchyBulk(subtree);
+}
+
+void gbe::Object::CollectSubtree(std::vector<Object*>& out)
+{
+	//Breadth-first keeps parents before their children
+	size_t start = out.size();
+	out.push_back(this);
+
+	for (size_t i = start; i < out.size(); i++)
+	{
+		for (const auto child : out[i]->children)
+			out.push_back(child);
 	}
 }
 
@@ -339,14 +426,67 @@ gbe::editor::InspectorData* gbe::Object::GetInspectorData()
 }
 
 void gbe::Object::Destroy()
+{
+	if (this->isDestroyQueued)
+		return;
+
+	pending_destroy.push_back(this);
+	this->MarkDestroyed();
+}
+
+void gbe::Object::MarkDestroyed()
 {
 	this->isDestroyQueued = true;
 
-	valid_objects.insert_or_assign(this->id, nullptr);
+	ObjectRegistry::Invalidate(this->handle);
 
 	for (const auto& child : this->children)
 	{
-		child->Destroy();
+		child->MarkDestroyed();
+	}
+}
+
+void gbe::Object::TakeDestroyed(std::vector<Object*>& out_deletees)
+{
+	if (pending_destroy.empty())
+		return;
+
+	std::vector<Object*> pending;
+	pending.swap(pending_destroy);
+
+	for (const auto object : pending)
+	{
+		//Walk up once: a destroyed ancestor deletes this object with its own subtree
+		//Subtrees outside the scene, detached or never parented, are taken the same way
+		bool covered = false;
+		for (Object* top = object; top->parent != nullptr; top = top->parent)
+			covered = covered || top->parent->isDestroyQueued;
+
+		if (covered)
+			continue;
+
+		size_t start = out_deletees.size();
+		object->CollectSubtree(out_deletees);
+
+		//Children added after Destroy() go with their parent
+		for (size_t i = start; i < out_deletees.size(); i++)
+		{
+			out_deletees[i]->isDestroyQueued = true;
+			ObjectRegistry::Invalidate(out_deletees[i]->handle);
+		}
+
+		auto old_parent = object->parent;
+
+		if (old_parent == nullptr)
+			continue;
+
+		std::span<Object* const> subtree(out_deletees.data() + start, out_deletees.size() - start);
+
+		for (Object* current = old_parent; current != nullptr; current = current->parent)
+			current->OnExitHierarchyBulk(subtree);
+
+		std::erase(old_parent->children, object);
+		object->parent = nullptr;
 	}
 }
 
@@ -391,7 +531,7 @@ gbe::SerializedObject gbe::Object::Serialize() {
 }
 
 gbe::Object::Object(gbe::SerializedObject* data, bool load_children):
-	local(Transform([this](TransformChangeType type) {this->OnLocalTransformationChange(type); })),
+	local(Transform([this](TransformChangeType type) {this->OnLocalTransformWrite(type); })),
 	world([](TransformChangeType type) {}) 
 {
 	GeneralInit();
@@ -406,20 +546,29 @@ gbe::Object::Object(gbe::SerializedObject* data, bool load_children):
 
 void gbe::Object::LoadChildren(SerializedObject* data)
 {
+	//Nested loads only link their children, the outermost load announces the whole tree in one pass
+	load_depth++;
+
 	for (size_t i = 0; i < data->children.size(); i++)
 	{
 		const auto& child = &data->children[i];
 		auto new_child = gbe::TypeSerializer::Instantiate(child->type, child);
-		new_child->PushEditorFlag(Object::SERIALIZABLE);
 
 		if (new_child != nullptr) {
-			new_child->SetParent(this);
+			new_child->PushEditorFlag(Object::SERIALIZABLE);
+			this->AttachLoaded(new_child);
 		}
 		else {
 			data->children.erase(data->children.begin() + i);
 			i--;
 		}
 	}
+
+	load_depth--;
+
+	if (load_depth == 0)
+		this->AnnounceLoadedSubtree();
+
 	std::function<void(gbe::SerializedObject* data, Object* obj)>* _commit_enabled;
 	std::function<void(gbe::SerializedObject* data, Object* obj)> commit_enabled = [&](gbe::SerializedObject* data, Object* obj) {
 		for (size_t i = 0; i < data->children.size(); i++)
@@ -2,6 +2,8 @@
 
 #include "Engine/Component/Transform.h"
 #include "Engine/Component/TransformChangeType.h"
+#include "Engine/Component/TransformHierarchy.h"
+#include "Engine/Objects/ObjectRegistry.h"
 #include "Engine/Serialization/SerializedObject.h"
 
 #include <glm/gtx/matrix_decompose.hpp>
@@ -10,6 +12,8 @@
 #include <list>
 #include <functional>
 #include <algorithm>
+#include <atomic>
+#include <span>
 
 #include "Math/gbe_math.h"
 
@@ -28,7 +32,8 @@ namespace gbe {
 			TRANSFORMED_LOCAL,
 			TRANSFORMED_USER,
 			TRANSFORMED_WORLD_NOT_LOCAL,
-			TREE_CHANGED
+			TREE_CHANGED,
+			STATE_COUNT
 		};
 		enum EditorFlags
 		{
@@ -54,9 +59,11 @@ namespace gbe {
 		};
 
 	private:
-		static std::unordered_map<unsigned int, Object*> valid_objects;
-		static unsigned int next_avail_id;
-		unsigned int id = 0;
+		ObjectHandle handle;
+		//Objects Destroy() was called on directly, their subtrees are collected at the end of the frame
+		static std::vector<Object*> pending_destroy;
+		//Nesting of LoadChildren calls in progress
+		static size_t load_depth;
 
 		std::string name = "Object";
 
@@ -67,24 +74,37 @@ namespace gbe {
 
 		std::vector<Object*> children;
 
-		//A smart way to keep track of states and whether some external objects have already read the state or not.
-		std::unordered_map<int, std::vector<uint16_t>> state_checkers;
+		//Bumped on every PushState. Observers keep the last version they saw, so checks need no per-observer storage here
+		std::atomic<uint32_t> state_versions[STATE_COUNT] = {};
 		EditorFlags editor_flags = (EditorFlags)0;
 
 		Transform local;
 		Transform world;
-		
-		Matrix4 parent_matrix = Matrix4(1.0f);
 
+		//Node in the shared transform store, the world Transform is decomposed from it on demand
+		TransformHierarchy::Slot transform_slot = TransformHierarchy::INVALID_SLOT;
+		uint32_t world_version = 0;
+		//Writes held back until the next flush while the store is deferred
+		uint8_t pending_local_change = TransformChangeType::NONE;
+		bool transform_data_pending = false;
+
+		Matrix4 GetParentMatrix();
+		void OnLocalTransformWrite(TransformChangeType changetype);
+		void ResolvePendingTransform();
+		void CommitTransform();
+		void MarkDestroyed();
+		//Scene load fast path, links a child without notifying anyone
+		void AttachLoaded(Object* child);
+		void AnnounceLoadedSubtree();
+
+		friend class TransformHierarchy;
 	protected:
 		virtual void GeneralInit();
 		Root* root = nullptr;
 		Object* parent = nullptr;
 		virtual void OnLocalTransformationChange(TransformChangeType changetype);
 		virtual void OnExternalTransformationChange(TransformChangeType changetype, Matrix4 newparentmatrix);
-		inline virtual void On_Change_enabled(bool _to) {
-			this->enabled_hierarchy = _to;
-		}
+		virtual void On_Change_enabled(bool _to);
 
 		editor::InspectorData* inspectorData = nullptr;
 	public:
@@ -99,10 +119,32 @@ namespace gbe {
 			this->name = newname;
 		}
 
-		inline static Object* GetObjectById(uint32_t _id) { return valid_objects[_id]; }
+		/// <summary>
+		/// Looks up an object by its packed id, as written by the ID pass.
+		/// </summary>
+		inline static Object* GetObjectById(uint32_t _id) { return ObjectRegistry::ResolvePacked(_id); }
+		inline static Object* GetObjectByHandle(ObjectHandle _handle) { return ObjectRegistry::Resolve(_handle); }
 
 		void PushState(ObjectStateName state);
-		bool CheckState(ObjectStateName state, void* checker);
+		inline uint32_t GetStateVersion(ObjectStateName state) const {
+			return this->state_versions[state].load(std::memory_order_acquire);
+		}
+		/// <summary>
+		/// True if the state was pushed since the observer's last_seen version, which is then updated.
+		/// Safe to call from any thread as long as each observer owns its last_seen.
+		/// </summary>
+		inline bool CheckState(ObjectStateName state, uint32_t& last_seen) const {
+			if (this->isDestroyQueued)
+				return false;
+
+			uint32_t version = this->GetStateVersion(state);
+
+			if (version == last_seen)
+				return false;
+
+			last_seen = version;
+			return true;
+		}
 
 		inline bool GetEditorFlag(EditorFlags flag) {
 			return (this->editor_flags & flag) == flag;
@@ -112,14 +154,7 @@ namespace gbe {
 		}
 
 		inline static bool ValidateObject(Object* obj){
-			auto objid = obj->id;
-			if (valid_objects.find(objid) == valid_objects.end())
-				return false;
-
-			if (valid_objects[objid] != obj)
-				return false;
-
-			return true;
+			return obj != nullptr && ObjectRegistry::IsValid(obj->handle, obj);
 		}
 		inline void Set_enabled(bool _to) {
 			this->enabled_self = _to;
@@ -147,19 +182,31 @@ namespace gbe {
 		inline bool Get_enabled_self() {
 			return this->enabled_self;
 		}
-		inline void Set_id(unsigned int _id) {
-			this->id = _id;
+		inline ObjectHandle GetHandle() const {
+			return this->handle;
 		}
-		inline unsigned int Get_id() {
-			return this->id;
+		/// <summary>
+		/// Packed handle, unique among objects that are not yet deleted. Used as the render instance id.
+		/// </summary>
+		inline uint32_t Get_id() const {
+			return this->handle.Packed();
 		}
 
 		Transform& World();
 		Transform& Local();
+		/// <summary>
+		/// World matrix straight from the transform store, without decomposing it into the World() Transform.
+		/// </summary>
+		const Matrix4& WorldMatrix();
 
 		void ReEnterHierarchy();
 		virtual void OnEnterHierarchy(Object* newChild);
 		virtual void OnExitHierarchy(Object* newChild);
+		/// <summary>
+		/// Called once per ancestor when a whole subtree leaves or enters. Defaults to the per object call.
+		/// </summary>
+		virtual void OnExitHierarchyBulk(std::span<Object* const> exiting);
+		virtual void OnEnterHierarchyBulk(std::span<Object* const> entering);
 		Object* GetParent();
 		virtual void SetParent(Object* newParent);
 		Object* GetChildAt(size_t i);
@@ -182,11 +229,21 @@ namespace gbe {
 
 		void Destroy();
 		bool get_isDestroyed();
+		/// <summary>
+		/// Detaches every destroyed subtree from its live parent, notifying each ancestor once per subtree.
+		/// Subtrees outside the current scene are taken too, so none stays queued.
+		/// </summary>
+		/// <param name="out_deletees">Receives every object of the detached subtrees, parents first. The caller deletes them.</param>
+		static void TakeDestroyed(std::vector<Object*>& out_deletees);
 		inline void SetRoot(Root* newroot) {
 			this->root = newroot;
 		}
 
 		void CallRecursively(std::function<void(Object*)> action, bool bottom_up = true);
+		/// <summary>
+		/// Appends this object and all its descendants, parents before children.
+		/// </summary>
+		void CollectSubtree(std::vector<Object*>& out);
 
 		//SERIALIZATION
 		virtual SerializedObject Serialize();
@@ -0,0 +1,78 @@
+#include "ObjectRegistry.h"
+
+#include <stdexcept>
+
+std::vector<gbe::Object*> gbe::ObjectRegistry::slot_objects = { nullptr };
+std::vector<uint32_t> gbe::ObjectRegistry::slot_generations = { 0 };
+std::vector<uint32_t> gbe::ObjectRegistry::slot_to_dense = { UINT32_MAX };
+std::vector<uint32_t> gbe::ObjectRegistry::free_indices;
+
+std::vector<gbe::Object*> gbe::ObjectRegistry::dense_objects;
+std::vector<uint32_t> gbe::ObjectRegistry::dense_to_slot;
+
+gbe::ObjectHandle gbe::ObjectRegistry::Register(Object* object)
+{
+	uint32_t index;
+
+	if (!free_indices.empty()) {
+		index = free_indices.back();
+		free_indices.pop_back();
+	}
+	else {
+		index = (uint32_t)slot_objects.size();
+
+		if (index > ObjectHandle::PACKED_INDEX_MASK)
+			throw std::runtime_error("Object registry is full.");
+
+		slot_objects.push_back(nullptr);
+		slot_generations.push_back(0);
+		slot_to_dense.push_back(UINT32_MAX);
+	}
+
+	slot_objects[index] = object;
+	slot_to_dense[index] = (uint32_t)dense_objects.size();
+	dense_objects.push_back(object);
+	dense_to_slot.push_back(index);
+
+	return { index, slot_generations[index] };
+}
+
+void gbe::ObjectRegistry::RemoveDense(uint32_t index)
+{
+	uint32_t dense = slot_to_dense[index];
+
+	if (dense == UINT32_MAX)
+		return;
+
+	//Swap-and-pop, the moved object takes over the removed position
+	uint32_t last = (uint32_t)dense_objects.size() - 1;
+	if (dense != last) {
+		dense_objects[dense] = dense_objects[last];
+		dense_to_slot[dense] = dense_to_slot[last];
+		slot_to_dense[dense_to_slot[dense]] = dense;
+	}
+
+	dense_objects.pop_back();
+	dense_to_slot.pop_back();
+	slot_to_dense[index] = UINT32_MAX;
+}
+
+void gbe::ObjectRegistry::Invalidate(ObjectHandle handle)
+{
+	if (Resolve(handle) == nullptr)
+		return;
+
+	RemoveDense(handle.index);
+	slot_objects[handle.index] = nullptr;
+}
+
+void gbe::ObjectRegistry::Release(ObjectHandle handle)
+{
+	if (handle.IsNull() || handle.index >= slot_objects.size() || slot_generations[handle.index] != handle.generation)
+		return;
+
+	RemoveDense(handle.index);
+	slot_objects[handle.index] = nullptr;
+	slot_generations[handle.index]++;
+	free_indices.push_back(handle.index);
+}
\ No newline at end of file
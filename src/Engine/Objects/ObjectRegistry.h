@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	class Object;
+
+	/// <summary>
+	/// Index plus generation reference to a registered object. A stale handle (its object destroyed
+	/// and the slot reused) never resolves, since the slot's generation has moved on.
+	/// </summary>
+	struct ObjectHandle {
+		uint32_t index = 0;
+		uint32_t generation = 0;
+
+		//Packed form fits the 32 bit colour of the ID pass: 24 bit index, low 8 bits of the generation
+		static constexpr uint32_t PACKED_INDEX_BITS = 24;
+		static constexpr uint32_t PACKED_INDEX_MASK = (1u << PACKED_INDEX_BITS) - 1;
+
+		inline bool IsNull() const {
+			return index == 0;
+		}
+		inline uint32_t Packed() const {
+			return (index & PACKED_INDEX_MASK) | (generation << PACKED_INDEX_BITS);
+		}
+		inline bool operator==(const ObjectHandle& other) const {
+			return index == other.index && generation == other.generation;
+		}
+	};
+
+	/// <summary>
+	/// Generational slot map of every live object.
+	/// Lookups and validation are a single array access, released slots are reused with a bumped generation.
+	/// Live objects are also kept packed in one array for iteration; its order is not stable.
+	/// </summary>
+	class ObjectRegistry {
+	private:
+		//SLOTS, indexed by handle index. Slot 0 is reserved so a packed id is never the ID pass clear colour
+		static std::vector<Object*> slot_objects;
+		static std::vector<uint32_t> slot_generations;
+		static std::vector<uint32_t> slot_to_dense;
+		static std::vector<uint32_t> free_indices;
+
+		//DENSE LIVE OBJECTS
+		static std::vector<Object*> dense_objects;
+		static std::vector<uint32_t> dense_to_slot;
+
+		static void RemoveDense(uint32_t index);
+	public:
+		static ObjectHandle Register(Object* object);
+		/// <summary>
+		/// Stops the handle from resolving but keeps the slot reserved, so its packed id stays unique
+		/// until the object is actually deleted.
+		/// </summary>
+		static void Invalidate(ObjectHandle handle);
+		/// <summary>
+		/// Frees the slot for reuse. Call when the object is deleted.
+		/// </summary>
+		static void Release(ObjectHandle handle);
+
+		/// <returns>The object, or nullptr if the handle is stale or invalidated.</returns>
+		inline static Object* Resolve(ObjectHandle handle) {
+			if (handle.index >= slot_objects.size() || slot_generations[handle.index] != handle.generation)
+				return nullptr;
+
+			return slot_objects[handle.index];
+		}
+		/// <summary>
+		/// Resolves the packed form, only the low 8 generation bits are compared.
+		/// </summary>
+		inline static Object* ResolvePacked(uint32_t packed) {
+			uint32_t index = packed & ObjectHandle::PACKED_INDEX_MASK;
+
+			if (index >= slot_objects.size() || (slot_generations[index] & 0xFF) != (packed >> ObjectHandle::PACKED_INDEX_BITS))
+				return nullptr;
+
+			return slot_objects[index];
+		}
+		inline static bool IsValid(ObjectHandle handle, const Object* object) {
+			return object != nullptr && Resolve(handle) == object;
+		}
+
+		/// <summary>
+		/// Every registered object that is not invalidated, packed.
+		/// </summary>
+		inline static const std::vector<Object*>& GetObjects() {
+			return dense_objects;
+		}
+		inline static size_t GetCount() {
+			return dense_objects.size();
+		}
+	};
+}
\ No newline at end of file
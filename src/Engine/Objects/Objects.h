@@ -2,6 +2,7 @@
 
 #include "Root.h"
 #include "Object.h"
+#include "ObjectRegistry.h"
 #include "GenericObject.h"
 
 #include "Rendering/Camera.h"
@@ -16,14 +16,6 @@ namespace gbe {
         float nearClip;
         float farClip;
 
-        bool moved = true;
-        inline bool GetMoved() {
-            return moved;
-        }
-        inline void OnRender() {
-            moved = false;
-        }
-
         Camera();
 
         Vector3 WorldUp = Vector3(0, 1, 0);
@@ -33,11 +25,6 @@ namespace gbe {
         virtual Matrix4 GetProjectionMat(float override_range) = 0;
         Vector3 ScreenToRay(Vector2 normalizedscreenpos);
         Vector2 WorldToScreen(Vector3 worldpos);
-
-        inline virtual void OnExternalTransformationChange(TransformChangeType changetype, Matrix4 newparentmatrix) override {
-            Camera::moved = true;
-            Object::OnExternalTransformationChange(changetype, newparentmatrix);
-		}
     };
 
     struct OrthographicCamera : public Camera {
@@ -45,4 +45,29 @@ void gbe::DirectionalLight::GeneralInit()
 	backtrack_field->setter = [=](float val) {this->mLight.dir_backtrack_dist = val; };
 
 	this->inspectorData->fields.push_back(backtrack_field);
+
+	{
+		auto field = new gbe::editor::InspectorFloat();
+		field->name = "Cascades";
+		field->getter = [=]() {return (float)this->mLight.cascade_count; };
+		field->setter = [=](float val) {this->mLight.cascade_count = std::clamp((int)std::round(val), 1, gfx::Light::MAX_CASCADES); };
+
+		this->inspectorData->fields.push_back(field);
+	}
+	{
+		auto field = new gbe::editor::InspectorFloat();
+		field->name = "Cascade split lambda";
+		field->getter = [=]() {return this->mLight.cascade_lambda; };
+		field->setter = [=](float val) {this->mLight.cascade_lambda = std::clamp(val, 0.0f, 1.0f); };
+
+		this->inspectorData->fields.push_back(field);
+	}
+	{
+		auto field = new gbe::editor::InspectorFloat();
+		field->name = "Shadow distance";
+		field->getter = [=]() {return this->mLight.shadow_distance; };
+		field->setter = [=](float val) {this->mLight.shadow_distance = std::max(val, 0.1f); };
+
+		this->inspectorData->fields.push_back(field);
+	}
 }
\ No newline at end of file
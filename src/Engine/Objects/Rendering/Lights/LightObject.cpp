@@ -25,6 +25,9 @@ SerializedObject gbe::LightObject::Serialize()
 	obj.serialized_variables.insert_or_assign("range", std::to_string(mLight.range));
 	obj.serialized_variables.insert_or_assign("bias_min", std::to_string(mLight.bias_min));
 	obj.serialized_variables.insert_or_assign("bias_mult", std::to_string(mLight.bias_mult));
+	obj.serialized_variables.insert_or_assign("cascade_count", std::to_string(mLight.cascade_count));
+	obj.serialized_variables.insert_or_assign("cascade_lambda", std::to_string(mLight.cascade_lambda));
+	obj.serialized_variables.insert_or_assign("shadow_distance", std::to_string(mLight.shadow_distance));
 
 	return obj;
 }
@@ -43,6 +46,15 @@ gbe::LightObject::LightObject(SerializedObject* data) : Object(data)
 	mLight.range = std::stof(data->serialized_variables["range"]);
 	mLight.bias_min = std::stof(data->serialized_variables["bias_min"]);
 	mLight.bias_mult = std::stof(data->serialized_variables["bias_mult"]);
+
+	//Saved before cascades existed, keep the defaults
+	const auto& vars = data->serialized_variables;
+	if (vars.find("cascade_count") != vars.end())
+		mLight.cascade_count = std::stoi(vars.at("cascade_count"));
+	if (vars.find("cascade_lambda") != vars.end())
+		mLight.cascade_lambda = std::stof(vars.at("cascade_lambda"));
+	if (vars.find("shadow_distance") != vars.end())
+		mLight.shadow_distance = std::stof(vars.at("shadow_distance"));
 }
 
 void gbe::LightObject::GeneralInit()
@@ -12,6 +12,7 @@
 using namespace gbe::gfx;
 
 std::unordered_map<gbe::RenderObject::PrimitiveType, gbe::gfx::DrawCall*> gbe::RenderObject::primitive_drawcalls;
+std::vector<gbe::RenderObject*> gbe::RenderObject::changed_renderers;
 
 const std::unordered_map<gbe::RenderObject::PrimitiveType, std::string> gbe::RenderObject::PrimitiveTypeStrs =
 {
@@ -25,7 +26,7 @@ const std::unordered_map<gbe::RenderObject::PrimitiveType, std::string> gbe::Ren
 gbe::RenderObject::RenderObject(DrawCall* mDrawCall)
 {
 	this->mDrawCall = mDrawCall;
-	to_update = RenderPipeline::Get_Instance()->RegisterInstance(this->Get_id(), mDrawCall, this->World().GetMatrix());
+	RegisterInstance();
 
 	InitInspector();
 }
@@ -33,7 +34,7 @@ gbe::RenderObject::RenderObject(DrawCall* mDrawCall)
 gbe::RenderObject::RenderObject(PrimitiveType _ptype)
 {
 	this->mDrawCall = primitive_drawcalls[_ptype];
-	to_update = RenderPipeline::Get_Instance()->RegisterInstance(this->Get_id(), mDrawCall, this->World().GetMatrix());
+	RegisterInstance();
 	this->ptype = _ptype;
 
 	InitInspector();
@@ -41,10 +42,56 @@ gbe::RenderObject::RenderObject(PrimitiveType _ptype)
 
 gbe::RenderObject::~RenderObject()
 {
-	if (to_update != nullptr)
+	if (this->changed_index != SIZE_MAX)
+		changed_renderers[this->changed_index] = nullptr;
+
+	if (instance_registered)
 		RenderPipeline::Get_Instance()->UnRegisterInstanceAll(this->Get_id());
 }
 
+void gbe::RenderObject::RegisterInstance()
+{
+	RenderPipeline::Get_Instance()->RegisterInstance(this->Get_id(), mDrawCall, this->WorldMatrix());
+	instance_registered = true;
+}
+
+void gbe::RenderObject::QueueInstanceSync()
+{
+	if (this->changed_index != SIZE_MAX)
+		return;
+
+	this->changed_index = changed_renderers.size();
+	changed_renderers.push_back(this);
+}
+
+void gbe::RenderObject::OnLocalTransformationChange(TransformChangeType changetype)
+{
+	Object::OnLocalTransformationChange(changetype);
+	QueueInstanceSync();
+}
+
+void gbe::RenderObject::OnExternalTransformationChange(TransformChangeType changetype, Matrix4 newparentmatrix)
+{
+	Object::OnExternalTransformationChange(changetype, newparentmatrix);
+	QueueInstanceSync();
+}
+
+void gbe::RenderObject::SyncChangedInstances()
+{
+	for (const auto renderer : changed_renderers)
+	{
+		if (renderer == nullptr)
+			continue;
+
+		renderer->changed_index = SIZE_MAX;
+
+		if (renderer->instance_registered && !renderer->get_isDestroyed())
+			RenderPipeline::UpdateInstanceTransform(renderer->Get_id(), renderer->WorldMatrix());
+	}
+
+	changed_renderers.clear();
+}
+
 void gbe::RenderObject::InitInspector()
 {
 	{
@@ -60,19 +107,13 @@ void gbe::RenderObject::InitInspector()
 			RenderPipeline::UnRegisterInstanceAll(this->Get_id());
 
 			this->mDrawCall = newdrawcall;
-			to_update = RenderPipeline::Get_Instance()->RegisterInstance(this->Get_id(), mDrawCall, this->World().GetMatrix());
+			RegisterInstance();
 			};
 		f->assettype = asset::AssetType::MATERIAL;
 		this->inspectorData->fields.push_back(f);
 	}
 }
 
-void gbe::RenderObject::InvokeEarlyUpdate()
-{
-	if (to_update != nullptr)
-		*to_update = this->World().GetMatrix();
-}
-
 void gbe::RenderObject::On_Change_enabled(bool _to) {
 	Object::On_Change_enabled(_to);
 
@@ -113,7 +154,7 @@ gbe::RenderObject::RenderObject(SerializedObject* data) : Object(data)
 	auto input_mat = MaterialLoader::GetAssetById(data->serialized_variables["mat"]);
 	auto drawcall = RenderPipeline::RegisterDrawCall(input_mesh, input_mat);
 	this->mDrawCall = drawcall;
-	to_update = RenderPipeline::Get_Instance()->RegisterInstance(this->Get_id(), mDrawCall, this->World().GetMatrix());
+	RegisterInstance();
 
 	InitInspector();
 }
@@ -130,7 +171,7 @@ std::vector<std::vector<gbe::Vector3>> gbe::RenderObject::GetWorldSpaceVertexes(
 		for (const auto& vertindex : face)
 		{
 			auto pos = Vector4(src_verts[vertindex].pos, 1);
-			auto world_pos = Vector3(this->World().GetMatrix() * pos);
+			auto world_pos = Vector3(this->WorldMatrix() * pos);
 
 			newface.push_back(world_pos);
 		}
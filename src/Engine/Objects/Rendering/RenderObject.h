@@ -1,13 +1,13 @@
 #pragma once
 
 #include "../Object.h"
-#include "Engine/ObjectFunctions/EarlyUpdate.h"
 #include "Graphics/Data/Drawcall.h"
 
 #include <unordered_map>
+#include <vector>
 
 namespace gbe {
-	class RenderObject : public Object, public EarlyUpdate {
+	class RenderObject : public Object {
 	public:
 		enum PrimitiveType {
 			NONE = 0,
@@ -28,12 +28,21 @@ namespace gbe {
 
 		//RENDERING CACHE
 		gfx::DrawCall* mDrawCall = nullptr;
-		Matrix4* to_update = nullptr;
+		bool instance_registered = false;
+
+		//Renderers whose world matrix changed since the last sync, only these are sent to the pipeline
+		static std::vector<RenderObject*> changed_renderers;
+		size_t changed_index = SIZE_MAX;
+
+		void RegisterInstance();
+		void QueueInstanceSync();
 
 		PrimitiveType ptype = PrimitiveType::NONE;
 
 	protected:
 		void On_Change_enabled(bool _to) override;
+		void OnLocalTransformationChange(TransformChangeType changetype) override;
+		void OnExternalTransformationChange(TransformChangeType changetype, Matrix4 newparentmatrix) override;
 	public:
 		static inline void RegisterPrimitiveDrawcall(PrimitiveType ptype, gfx::DrawCall* drawtype) {
 			primitive_drawcalls.insert_or_assign(ptype, drawtype);
@@ -49,8 +58,11 @@ namespace gbe {
 
 		SerializedObject Serialize() override;
 
-		// Inherited via EarlyUpdate
-		virtual void InvokeEarlyUpdate() override;
+		/// <summary>
+		/// Sends the world matrix of every renderer that moved since the last call to the render pipeline.
+		/// Call after the last transform flush before rendering.
+		/// </summary>
+		static void SyncChangedInstances();
 
 		inline gfx::DrawCall* Get_DrawCall() {
 			return this->mDrawCall;
@@ -45,6 +45,4 @@ void gbe::LineRenderer::InvokeEarlyUpdate()
 		this->Local().scale.Set(Vector3(this->thickness, 1, delta_mag / 2));
 		this->Local().rotation.Set(Quaternion::LookAtRotation(delta_dir, to_eye));
 	}
-	
-	RenderObject::InvokeEarlyUpdate();
 }
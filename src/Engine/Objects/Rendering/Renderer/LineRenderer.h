@@ -4,7 +4,7 @@
 #include "Engine/ObjectFunctions/EarlyUpdate.h"
 
 namespace gbe {
-	class LineRenderer : public RenderObject{
+	class LineRenderer : public RenderObject, public EarlyUpdate {
 	private:
 		Object* a;
 		Object* b;
@@ -15,6 +15,6 @@ namespace gbe {
 
 		void SetThickness(float value);
 		Vector3 GetPos(int which);
-		virtual void InvokeEarlyUpdate();
+		virtual void InvokeEarlyUpdate() override;
 	};
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "Root.h"
 
+#include <bit>
+#include <stdexcept>
+
 gbe::Root::~Root()
 {
 	for (auto handler : this->handlers)
@@ -10,26 +13,112 @@ gbe::Root::~Root()
 
 void gbe::Root::RegisterHandler(Handler* handler)
 {
+	std::vector<Handler*> added;
+	handler->CollectHandlers(added);
+
+	if (this->flat_handlers.size() + added.size() > 64)
+		throw std::runtime_error("A root supports at most 64 handlers including subhandlers.");
+
 	this->handlers.push_back(handler);
+	this->flat_handlers.insert(this->flat_handlers.end(), added.begin(), added.end());
+
+	this->membership_masks.clear();
+	this->handler_lookup.clear();
 }
 
-void gbe::Root::OnEnterHierarchy(Object* newChild)
+uint64_t gbe::Root::GetMembershipMask(Object* object)
 {
-	Object::OnEnterHierarchy(newChild);
+	auto it = this->membership_masks.find(typeid(*object));
 
-	for (auto handler : this->handlers)
+	if (it != this->membership_masks.end())
+		return it->second;
+
+	//Membership only depends on the dynamic type, so the casts run once per class
+	uint64_t mask = 0;
+	for (size_t i = 0; i < this->flat_handlers.size(); i++)
 	{
-		handler->TryAdd(newChild);
+		if (this->flat_handlers[i]->AcceptsOwn(object))
+			mask |= (uint64_t)1 << i;
 	}
-	newChild->SetRoot(this);
+
+	this->membership_masks.insert_or_assign(typeid(*object), mask);
+	this->casts_performed += this->flat_handlers.size();
+
+	return mask;
+}
+
+void gbe::Root::OnEnterHierarchy(Object* newChild)
+{
+	this->OnEnterHierarchyBulk({ &newChild, 1 });
 }
 
 void gbe::Root::OnExitHierarchy(Object* newChild)
 {
-	Object::OnExitHierarchy(newChild);
+	this->OnExitHierarchyBulk({ &newChild, 1 });
+}
 
-	for (auto handler : this->handlers)
+void gbe::Root::OnExitHierarchyBulk(std::span<Object* const> exiting)
+{
+	this->PushState(TREE_CHANGED);
+
+	this->bulk_masks.clear();
+	for (const auto object : exiting)
+		this->bulk_masks.push_back(this->GetMembershipMask(object));
+
+	//One removal per handler, holding only the objects it can contain
+	for (size_t h = 0; h < this->flat_handlers.size(); h++)
 	{
-		handler->Remove(newChild);
+		this->bulk_members.clear();
+		for (size_t i = 0; i < exiting.size(); i++)
+		{
+			if ((this->bulk_masks[i] >> h) & 1)
+				this->bulk_members.push_back(exiting[i]);
+		}
+
+		if (!this->bulk_members.empty())
+			this->flat_handlers[h]->RemoveOwn(this->bulk_members);
+	}
+}
+
+void gbe::Root::OnEnterHierarchyBulk(std::span<Object* const> entering)
+{
+	this->PushState(TREE_CHANGED);
+
+	this->bulk_masks.clear();
+	for (const auto object : entering)
+	{
+		uint64_t mask = this->GetMembershipMask(object);
+		size_t memberships = std::popcount(mask);
+
+		//Each membership still casts once to convert the pointer, every other handler is skipped
+		this->membership_lookups++;
+		this->casts_performed += memberships;
+		this->casts_avoided += this->flat_handlers.size() - memberships;
+
+		this->bulk_masks.push_back(mask);
+		object->SetRoot(this);
+	}
+
+	//Handler by handler, so each one fills its arrays in a single run
+	for (size_t h = 0; h < this->flat_handlers.size(); h++)
+	{
+		for (size_t i = 0; i < entering.size(); i++)
+		{
+			if ((this->bulk_masks[i] >> h) & 1)
+				this->flat_handlers[h]->AddOwn(entering[i]);
+		}
+	}
+}
+
+void gbe::Root::OnObjectEnabledChange(Object* object, bool enabled)
+{
+	uint64_t mask = this->GetMembershipMask(object);
+
+	while (mask != 0)
+	{
+		size_t h = std::countr_zero(mask);
+		mask &= mask - 1;
+
+		this->flat_handlers[h]->SetEnabledOwn(object, enabled);
 	}
 }
\ No newline at end of file
@@ -3,10 +3,27 @@
 #include "Engine/Objects/Object.h"
 #include "Engine/ObjectHandlers/ObjectHandler.h"
 
+#include <typeindex>
+#include <unordered_map>
+
 namespace gbe{
 	class Root : public Object {
 	private:
-		std::list<Handler*> handlers;
+		std::vector<Handler*> handlers;
+		//Registered handlers and all their subhandlers. Bit i of a membership mask stands for flat_handlers[i]
+		std::vector<Handler*> flat_handlers;
+
+		//Which handlers take an object, by dynamic type. Filled on first sight of each class
+		std::unordered_map<std::type_index, uint64_t> membership_masks;
+		std::unordered_map<std::type_index, Handler*> handler_lookup;
+		std::vector<uint64_t> bulk_masks;
+		std::vector<Object*> bulk_members;
+
+		size_t membership_lookups = 0;
+		size_t casts_performed = 0;
+		size_t casts_avoided = 0;
+
+		uint64_t GetMembershipMask(Object* object);
 	public:
 		inline Root(){
 		}
@@ -17,22 +34,23 @@ namespace gbe{
 		~Root();
 		void RegisterHandler(Handler* handler);
 
-		inline Object* GetObjectWithId(unsigned int _id) {
-			Object* chosen = nullptr;
-
-			this->CallRecursively([&](Object* child) {
-				if (child->Get_id() == _id)
-					chosen = child;
-				});
-
-			return chosen;
+		inline Object* GetObjectWithHandle(ObjectHandle _handle) {
+			return ObjectRegistry::Resolve(_handle);
 		}
 
 		virtual void OnEnterHierarchy(Object* newChild);
 		virtual void OnExitHierarchy(Object* newChild);
+		virtual void OnExitHierarchyBulk(std::span<Object* const> exiting);
+		virtual void OnEnterHierarchyBulk(std::span<Object* const> entering);
+		void OnObjectEnabledChange(Object* object, bool enabled);
 
 		template<typename T>
 		ObjectHandler<T>* GetHandler() {
+			auto it = this->handler_lookup.find(typeid(T));
+
+			if (it != this->handler_lookup.end())
+				return static_cast<ObjectHandler<T>*>(it->second);
+
 			ObjectHandler<T>* toreturn = nullptr;
 
 			for (auto handler : this->handlers)
@@ -43,7 +61,25 @@ namespace gbe{
 					break;
 			}
 
+			this->handler_lookup.insert_or_assign(typeid(T), toreturn);
+
 			return toreturn;
 		}
+
+		/// <summary>
+		/// Objects that went through the membership table while entering this root.
+		/// </summary>
+		inline size_t GetMembershipLookups() const {
+			return this->membership_lookups;
+		}
+		/// <summary>
+		/// dynamic_casts run for handler membership, and the ones a TryAdd on every handler would have run on top of that.
+		/// </summary>
+		inline size_t GetCastsPerformed() const {
+			return this->casts_performed;
+		}
+		inline size_t GetCastsAvoided() const {
+			return this->casts_avoided;
+		}
 	};
 }
\ No newline at end of file
@@ -22,6 +22,7 @@
 #include "ObjectFunctions/LateUpdate.h"
 #include "ObjectFunctions/Update.h"
 #include "ObjectFunctions/PhysicsUpdate.h"
+#include "ObjectFunctions/UpdateAccess.h"
 #include "ObjectHandlers/ObjectHandler.h"
 #include "ObjectHandlers/PhysicsHandler.h"
 #include "ObjectHandlers/ColliderHandler.h"
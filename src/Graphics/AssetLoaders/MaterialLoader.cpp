@@ -7,9 +7,9 @@ using namespace gbe;
 using namespace gfx;
 
 void MaterialLoader::LoadAsset_(asset::Material* asset, const asset::data::MaterialImportData& importdata, MaterialData* data) {
-    data->shader = asset::Shader::GetAssetById(importdata.shader);
-    data->shadowcaster = importdata.shadowcaster != 0;
-    data->defaultrendergroup = importdata.defaultrendergroup;
+    data->setShader(asset::Shader::GetAssetById(importdata.shader));
+    data->setShadowcaster(importdata.shadowcaster != 0);
+    data->setDefaultRendergroup(importdata.defaultrendergroup);
 
     auto newinspectordata = new editor::InspectorData();
 
@@ -17,13 +17,43 @@ namespace gbe {
 			Matrix4 value_mat4;
 			asset::Texture* value_tex;
 			int tex_stage;
+
+			//Resolved on the first sync, a replaced override resolves again
+			UniformCache::Id uniform = UniformCache::INVALID_ID;
 		};
 
 		struct MaterialData {
-			std::unordered_map<std::string, MaterialOverride> overrides;
-			bool shadowcaster;
-			int defaultrendergroup;
+		private:
+			//Behind setters so every change bumps version
+			bool shadowcaster = false;
+			int defaultrendergroup = 0;
 			asset::Shader* shader = nullptr;
+		public:
+			std::unordered_map<std::string, MaterialOverride> overrides;
+			//Bumped by every setter, so a drawn frame can tell the material changed since
+			uint64_t version = 0;
+
+			inline bool getShadowcaster() const {
+				return this->shadowcaster;
+			}
+			inline void setShadowcaster(bool value) {
+				this->shadowcaster = value;
+				this->version++;
+			}
+			inline int getDefaultRendergroup() const {
+				return this->defaultrendergroup;
+			}
+			inline void setDefaultRendergroup(int value) {
+				this->defaultrendergroup = value;
+				this->version++;
+			}
+			inline asset::Shader* getShader() const {
+				return this->shader;
+			}
+			inline void setShader(asset::Shader* value) {
+				this->shader = value;
+				this->version++;
+			}
 
 			size_t getOverrideCount() const {
 				return this->overrides.size();
@@ -47,6 +77,7 @@ namespace gbe {
 				materialOverride.value_bool = value;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 			template<>
 			void setOverride<float>(std::string id, float value) {
@@ -55,6 +86,7 @@ namespace gbe {
 				materialOverride.value_float = value;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 			template<>
 			void setOverride<Vector2>(std::string id, Vector2 value) {
@@ -63,6 +95,7 @@ namespace gbe {
 				materialOverride.value_vec2 = value;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 			template<>
 			void setOverride<Vector3>(std::string id, Vector3 value) {
@@ -71,6 +104,7 @@ namespace gbe {
 				materialOverride.value_vec3 = value;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 			template<>
 			void setOverride<Vector4>(std::string id, Vector4 value) {
@@ -79,6 +113,7 @@ namespace gbe {
 				materialOverride.value_vec4 = value;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 			template<>
 			void setOverride<Matrix4>(std::string id, Matrix4 value) {
@@ -87,6 +122,7 @@ namespace gbe {
 				materialOverride.value_mat4 = value;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 
 			void setTextureOverride(std::string id, asset::Texture* value, int stage) {
@@ -96,6 +132,7 @@ namespace gbe {
 				materialOverride.tex_stage = stage;
 
 				this->overrides.insert_or_assign(id, materialOverride);
+				this->version++;
 			}
 		};
 
@@ -8,6 +8,7 @@
 #include <vector>
 #include <map>
 #include <thread>
+#include "Jobs/JobSystem.h"
 #include <mikktspace.h>
 
 using namespace gbe::asset::data;
@@ -213,12 +214,18 @@ void gbe::gfx::MeshLoader::OnAsyncTaskCompleted(MeshLoader::AsyncLoadTask* loadt
         throw std::runtime_error("Failed to create bgfx Index Buffer");
     }
 
+    // BOUNDS, used for culling
+    AABB bounds;
+    for (const auto& vertex : meshloadtask->out_vertices)
+        bounds.Encapsulate(vertex.pos);
+
     auto newdata = MeshData{
         .vertex_vbh = vertexBufferHandle, // Pass the bgfx handle
         .index_vbh = indexBufferHandle,   // Pass the bgfx handle
         .vertices = meshloadtask->out_vertices,
         .indices = meshloadtask->out_indices,
         .faces = meshloadtask->out_faces,
+        .bounds = bounds,
     };
 
 	Register(meshloadtask->id, newdata);
@@ -245,15 +252,19 @@ void gbe::gfx::MeshLoader::LoadAsset_(asset::Mesh* asset, const asset::data::Mes
 
     RegisterAsyncTask(task);
 
-    // Launch worker thread
-    // In a production environment, use a ThreadPool instead of raw std::thread
-    std::thread worker(&ProcessMeshAsync, task);
-    worker.detach();
+    // Queue on the engine job system, buffers are created on the main thread in OnAsyncTaskCompleted
+    auto jobsystem = JobSystem::Get();
+    if (jobsystem != nullptr) {
+        jobsystem->RunBackground([task]() {
+            ProcessMeshAsync(task);
+            });
+    }
+    else {
+        // No engine yet (tools, headless runs), import on this thread and let the completion poll pick it up
+        ProcessMeshAsync(task);
+    }
 }
 
-// NOTE: You must implement a function called every frame on the Main Thread
-// to check 'task->isDone', create BGFX buffers, and set asset->SetIsLoading(false).
-
 void gbe::gfx::MeshLoader::UnLoadAsset_(MeshData* data)
 {
     if (bgfx::isValid(data->vertex_vbh)) bgfx::destroy(data->vertex_vbh);
@@ -50,6 +50,9 @@ namespace gbe {
 			std::vector<Vertex> vertices;
 			std::vector<uint16_t> indices;
 			std::vector<std::vector<uint16_t>> faces;
+
+			//Object space bounds of every vertex
+			AABB bounds;
 		};
 
 		class MeshLoader : public asset::AssetLoader<asset::Mesh, asset::data::MeshImportData, MeshData> {
@@ -1,10 +1,6 @@
 #include "ShaderLoader.h"
 #include <stdexcept>
 
-
-std::unordered_map<std::string, bgfx::UniformHandle> gbe::gfx::ShaderData::m_uniforms;
-std::unordered_map<std::string, bgfx::UniformHandle> gbe::gfx::ShaderData::m_uniformarrays;
-
 // Utility to read a binary file (shader)
 std::vector<char> readfile(std::filesystem::path path) {
     std::ifstream file(path, std::ios::ate | std::ios::binary);
@@ -51,6 +47,10 @@ void gbe::gfx::ShaderLoader::LoadAsset_(asset::Shader* asset, const asset::data:
         throw std::runtime_error("Failed to create bgfx shader handles!");
     }
 
+    // Resolve every uniform now, so draws only pass ids around
+    UniformCache::RegisterShader(vertHandle);
+    UniformCache::RegisterShader(fragHandle);
+
     // 2. Create the bgfx program handle
     // The 'true' flag tells bgfx to destroy the individual shader handles 
     // when the program handle is destroyed.
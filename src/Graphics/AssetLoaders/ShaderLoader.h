@@ -4,6 +4,7 @@
 #include "Math/gbe_math.h"
 
 #include "TextureLoader.h"
+#include "Graphics/util/UniformCache.h"
 #include <bgfx/bgfx.h> // ADDED bgfx header
 
 #include <optional>
@@ -13,6 +14,7 @@
 #include <sstream>
 #include <unordered_map>
 #include <map> 
+#include <type_traits>
 
 namespace gbe {
 	namespace gfx {
@@ -50,136 +52,60 @@ namespace gbe {
 			std::vector<ShaderField> uniformfields;
 			asset::Shader* asset;
 
-			static std::unordered_map<std::string, bgfx::UniformHandle> m_uniforms;
-			static std::unordered_map<std::string, bgfx::UniformHandle> m_uniformarrays;
-
-			inline bool GetUniform(bgfx::UniformHandle& out, std::string& name) const {
-				auto it = m_uniforms.find(name);
-				if (it != m_uniforms.end())
-				{
-					out = it->second;
-					return true;
-				}
-
-				return false;
-			}
-
-
-			inline bool GetUniformArray(bgfx::UniformHandle& out, const std::string& name) const {
-				auto it = m_uniformarrays.find(name);
-				if (it != m_uniformarrays.end())
-				{
-					out = it->second;
-					return true;
-				}
-
-				return false;
-			}
-
-			template<typename T>
-			void RegisterUniform(std::string& name, int size = 1) {
-				throw new std::runtime_error("Unsupported uniform type.");
-			}
-
-			void Internal_CreateVec4Uniform(std::string& name, int size) {
-				bgfx::UniformHandle handle = bgfx::createUniform(name.c_str(), bgfx::UniformType::Vec4, size);
-				
-				if(size == 1)
-					m_uniforms[name] = handle;
-				else
-					m_uniformarrays[name] = handle;
-
-			}
-
-			template <>
-			void RegisterUniform<int>(std::string& name, int size) {
-				Internal_CreateVec4Uniform(name, size);
-			}
-			template <>
-			void RegisterUniform<float>(std::string& name, int size) {
-				Internal_CreateVec4Uniform(name, size);
+			inline static Vector4 ToUniformVec4(float value) {
+				return Vector4(value, 0, 0, 0);
 			}
-			template <>
-			void RegisterUniform<Vector2>(std::string& name, int size) {
-				Internal_CreateVec4Uniform(name, size);
+			inline static Vector4 ToUniformVec4(int value) {
+				return Vector4((float)value, 0, 0, 0);
 			}
-			template <>
-			void RegisterUniform<Vector3>(std::string& name, int size) {
-				Internal_CreateVec4Uniform(name, size);
+			inline static Vector4 ToUniformVec4(const Vector2& value) {
+				return Vector4(value.x, value.y, 0, 0);
 			}
-			template <>
-			void RegisterUniform<Vector4>(std::string& name, int size) {
-				Internal_CreateVec4Uniform(name, size);
+			inline static Vector4 ToUniformVec4(const Vector3& value) {
+				return Vector4(value, 0);
 			}
-			template <>
-			void RegisterUniform<Matrix4>(std::string& name, int size) {
-				bgfx::UniformHandle handle = bgfx::createUniform(name.c_str(), bgfx::UniformType::Mat4, size);
-				if (size == 1)
-					m_uniforms[name] = handle;
-				else
-					m_uniformarrays[name] = handle;
-			}
-
-			template <>
-			void RegisterUniform<TextureData>(std::string& name, int size) {
-				bgfx::UniformHandle handle = bgfx::createUniform(name.c_str(), bgfx::UniformType::Sampler, size);
-				if (size == 1)
-					m_uniforms[name] = handle;
-				else
-					m_uniformarrays[name] = handle;
+			inline static Vector4 ToUniformVec4(const Vector4& value) {
+				return value;
 			}
 
 			// BGFX: ApplyOverride for simple types (bool, float, vec, matrix)
 			// It uses bgfx::setUniform to update the uniform on the active view/command buffer.
-			template<typename T>
-			inline bool ApplyOverride(const T& valueref, std::string target) {
-
-				bgfx::UniformHandle handle;
-
-				if (!this->GetUniform(handle, target))
-					this->RegisterUniform<T>(target); //temporary fix, we want to do this at shader loading stage
-
-				this->GetUniform(handle, target);
-
-				bgfx::setUniform(handle, &valueref, 1);
-
+			// Hot paths resolve the name once with UniformCache::Resolve and pass the id.
+			inline bool ApplyOverride(const Vector4& valueref, UniformCache::Id target) {
+				UniformCache::Set(target, &valueref, 1);
 				return true;
 			}
-
-			template<>
-			inline bool ApplyOverride<TextureData>(const TextureData& valueref, std::string target)
-			{
-				throw new std::runtime_error("Use ApplyTextureOverride instead.");
+			inline bool ApplyOverride(const Matrix4& valueref, UniformCache::Id target) {
+				UniformCache::Set(target, &valueref, 1);
+				return true;
+			}
+			template<typename T>
+			inline bool ApplyOverride(const T& valueref, const std::string& target) {
+				if constexpr (std::is_same_v<T, Matrix4>)
+					return ApplyOverride(valueref, UniformCache::Resolve(target, bgfx::UniformType::Mat4));
+				else
+					return ApplyOverride(ToUniformVec4(valueref), UniformCache::Resolve(target, bgfx::UniformType::Vec4));
 			}
-			// BGFX: ApplyOverride specialization for TextureData
-			inline bool ApplyTextureOverride(TextureData* valueref, std::string target, int stage) {
-
-				bgfx::UniformHandle handle;
-
-				if (!this->GetUniform(handle, target))
-					this->RegisterUniform<TextureData>(target); //temporary fix, we want to do this at shader loading stage
-
-				this->GetUniform(handle, target);
-
-				bgfx::setTexture(stage, handle, valueref->textureHandle);
 
+			// BGFX: Texture bindings only last for the next submit, so they are never deduplicated
+			inline bool ApplyTextureOverride(TextureData* valueref, UniformCache::Id target, int stage) {
+				UniformCache::SetTexture((uint8_t)stage, target, valueref->textureHandle);
 				return true;
 			}
+			inline bool ApplyTextureOverride(TextureData* valueref, const std::string& target, int stage) {
+				return ApplyTextureOverride(valueref, UniformCache::Resolve(target, bgfx::UniformType::Sampler), stage);
+			}
 
 			template<typename T>
-			inline bool ApplyOverrideArray(const T* valueref, std::string target, int count) {
-
-				bgfx::UniformHandle handle;
-
-				if (!this->GetUniformArray(handle, target))
-					this->RegisterUniform<T>(target, count); //temporary fix, we want to do this at shader loading stage
-
-				this->GetUniformArray(handle, target);
-
-				bgfx::setUniform(handle, valueref, count);
-
+			inline bool ApplyOverrideArray(const T* valueref, UniformCache::Id target, int count) {
+				UniformCache::Set(target, valueref, (uint16_t)count);
 				return true;
 			}
+			template<typename T>
+			inline bool ApplyOverrideArray(const T* valueref, const std::string& target, int count) {
+				const auto type = std::is_same_v<T, Matrix4> ? bgfx::UniformType::Mat4 : bgfx::UniformType::Vec4;
+				return ApplyOverrideArray(valueref, UniformCache::Resolve(target, type, (uint16_t)count), count);
+			}
 		};
 
 		class ShaderLoader : public asset::AssetLoader<asset::Shader, asset::data::ShaderImportData, ShaderData> {
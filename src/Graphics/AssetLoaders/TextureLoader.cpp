@@ -151,6 +151,9 @@ void gbe::gfx::TextureLoader::LoadAsset_(gbe::asset::Texture* target, const asse
     loaddata->bitsPerPixel = 32;
 
     bimg::imageFree(imageContainer);
+
+    //Materials may already point at this asset and be drawing the default image
+    RenderPipeline::InvalidateFrame();
 }
 
 void gbe::gfx::TextureLoader::UnLoadAsset_(TextureData* data)
@@ -14,7 +14,7 @@ namespace gbe {
 
     DrawCall::DrawCall(asset::Mesh* mesh, asset::Material* material)
     {
-        auto shader_id = MaterialLoader::GetAssetRuntimeData(material->Get_assetId())->shader->Get_assetId();
+        auto shader_id = MaterialLoader::GetAssetRuntimeData(material->Get_assetId())->getShader()->Get_assetId();
 
         this->shaderdata = ShaderLoader::GetAssetRuntimeData(shader_id);
         this->m_mesh = mesh;
@@ -41,29 +41,31 @@ namespace gbe {
 
     bool gfx::DrawCall::SyncMaterialData()
     {
-        for (size_t m_i = 0; m_i < this->get_materialdata()->getOverrideCount(); m_i++)
+        for (auto& [id, overridedata] : this->get_materialdata()->overrides)
         {
-            std::string id;
-            auto& overridedata = this->get_materialdata()->getOverride(m_i, id);
+            if (overridedata.uniform == UniformCache::INVALID_ID) {
+                const auto type = (overridedata.type == asset::Shader::UniformFieldType::TEXTURE) ? bgfx::UniformType::Sampler : bgfx::UniformType::Vec4;
+                overridedata.uniform = UniformCache::Resolve(id, type);
+            }
 
             if (overridedata.type == asset::Shader::UniformFieldType::BOOL) {
                 // BOOL is typically represented as a float/int in shaders
-                this->ApplyOverride<float>(overridedata.value_bool ? 1.0f : 0.0f, id);
+                this->ApplyOverride(ShaderData::ToUniformVec4(overridedata.value_bool ? 1.0f : 0.0f), overridedata.uniform);
             }
             else if (overridedata.type == asset::Shader::UniformFieldType::FLOAT) {
-                this->ApplyOverride<float>(overridedata.value_float, id);
+                this->ApplyOverride(ShaderData::ToUniformVec4(overridedata.value_float), overridedata.uniform);
             }
             else if (overridedata.type == asset::Shader::UniformFieldType::INT) {
-                this->ApplyOverride<int>((int)overridedata.value_float, id); // Cast float to int
+                this->ApplyOverride(ShaderData::ToUniformVec4((int)overridedata.value_float), overridedata.uniform); // Cast float to int
             }
             else if (overridedata.type == asset::Shader::UniformFieldType::VEC2) {
-                this->ApplyOverride<Vector2>(overridedata.value_vec2, id);
+                this->ApplyOverride(ShaderData::ToUniformVec4(overridedata.value_vec2), overridedata.uniform);
             }
             else if (overridedata.type == asset::Shader::UniformFieldType::VEC3) {
-                this->ApplyOverride<Vector3>(overridedata.value_vec3, id);
+                this->ApplyOverride(ShaderData::ToUniformVec4(overridedata.value_vec3), overridedata.uniform);
             }
             else if (overridedata.type == asset::Shader::UniformFieldType::VEC4) {
-                this->ApplyOverride<Vector4>(overridedata.value_vec4, id);
+                this->ApplyOverride(overridedata.value_vec4, overridedata.uniform);
             }
             else if (overridedata.type == asset::Shader::UniformFieldType::TEXTURE)
             {
@@ -76,7 +78,7 @@ namespace gbe {
                 else
                     findtexturedata = TextureLoader::GetAssetRuntimeData(overridedata.value_tex->Get_assetId());
 
-                this->ApplyTextureOverride(findtexturedata, id, overridedata.tex_stage);
+                this->ApplyTextureOverride(findtexturedata, overridedata.uniform, overridedata.tex_stage);
             }
         }
 
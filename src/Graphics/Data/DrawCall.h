@@ -27,6 +27,10 @@ namespace gbe {
             // BGFX: Stores the shader program and uniform handles
             ShaderData* shaderdata;
 
+            //Small ids of the mesh and material, given by the render pipeline for draw sort keys
+            uint32_t mesh_sort_id = 0;
+            uint32_t material_sort_id = 0;
+
         public:
             DrawCall(asset::Mesh* mesh, asset::Material* material);
             ~DrawCall(); // The destructor must now destroy bgfx handles
@@ -41,24 +45,37 @@ namespace gbe {
                 return shaderdata;
             }
 
+            inline void set_sort_ids(uint32_t mesh_id, uint32_t material_id) {
+                mesh_sort_id = mesh_id;
+                material_sort_id = material_id;
+            }
+            inline uint32_t get_mesh_sort_id() const {
+                return mesh_sort_id;
+            }
+            inline uint32_t get_material_sort_id() const {
+                return material_sort_id;
+            }
+
             // SyncMaterialData remains the same for overriding values before a draw call
             bool SyncMaterialData();
 
             // BGFX: ApplyOverride for simple types (bool, float, vec, matrix)
             // It uses bgfx::setUniform to update the uniform on the active view/command buffer.
-            template<typename T>
-            inline bool ApplyOverride(const T& valueref, std::string target) const {
+            // The target is a uniform name or an id from UniformCache::Resolve.
+            template<typename T, typename TTarget>
+            inline bool ApplyOverride(const T& valueref, const TTarget& target) const {
                 this->shaderdata->ApplyOverride(valueref, target);
                 return true;
             }
 
-            inline bool ApplyTextureOverride(TextureData* valueref, std::string target, int stage) const {
+            template<typename TTarget>
+            inline bool ApplyTextureOverride(TextureData* valueref, const TTarget& target, int stage) const {
                 this->shaderdata->ApplyTextureOverride(valueref, target, stage);
                 return true;
             }
 
-            template<typename T>
-            inline bool ApplyOverrideArray(const T* valueref, std::string target, int count) const {
+            template<typename T, typename TTarget>
+            inline bool ApplyOverrideArray(const T* valueref, const TTarget& target, int count) const {
                 this->shaderdata->ApplyOverrideArray(valueref, target, count);
                 return true;
             }
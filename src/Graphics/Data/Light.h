@@ -2,6 +2,9 @@
 
 #include "Math/gbe_math.h"
 
+#include <array>
+#include <algorithm>
+
 namespace gbe::gfx {
     struct Light {
         enum LightType {
@@ -21,10 +24,18 @@ namespace gbe::gfx {
         LightType type;
 
         //Directional
+        static constexpr int MAX_CASCADES = 4;
         float override_dist = 50;
         float dir_backtrack_dist = 100;
-        std::vector<gbe::Vector4> frustrum_corners;
-        Vector3 frustrum_center;
+        int cascade_count = 4;
+        //Split placement, 0 spaces the cascades evenly and 1 logarithmically
+        float cascade_lambda = 0.75f;
+        //Camera distance covered by the cascades, capped by the camera's far clip
+        float shadow_distance = 60;
+        //View depth where each cascade ends
+        std::array<float, MAX_CASCADES> cascade_far = {};
+        std::array<gbe::Matrix4, MAX_CASCADES> cascade_view;
+        std::array<gbe::Matrix4, MAX_CASCADES> cascade_proj;
 
         //Cone
         float angle_inner_deg = 50;
@@ -44,7 +55,20 @@ namespace gbe::gfx {
         gbe::Matrix4 proj_cache;
         gbe::Matrix4 view_cache;
 
-        inline void UpdateContext(gbe::Matrix4 _cam_view, gbe::Matrix4 _cam_proj) {
+        /// <summary>
+        /// Shadow map layers this light needs, one per cascade for directional lights.
+        /// Point lights have no shadow lookup in the lit shader, so they take none.
+        /// </summary>
+        inline int GetShadowLayerCount() const {
+            if (type == POINT)
+                return 0;
+            if (type != DIRECTIONAL)
+                return 1;
+
+            return std::clamp(cascade_count, 1, MAX_CASCADES);
+        }
+
+        inline void UpdateContext(gbe::Matrix4 _cam_view, gbe::Matrix4 _cam_proj, float _cam_near, float _cam_far, int _shadow_resolution) {
             cam_view = _cam_view;
             cam_proj = _cam_proj;
 
@@ -54,26 +78,76 @@ namespace gbe::gfx {
             if(type != DIRECTIONAL)
 				return;
 
-            frustrum_corners = gbe::Matrix4::get_frustrum_corners(cam_proj, cam_view);
-            frustrum_center = gbe::Matrix4::get_frustrum_center(frustrum_corners);
-
-            float radius = 0.0f;
-            for (uint32_t j = 0; j < 8; j++) {
-                Vector3 delta = (Vector3)frustrum_corners[j] - frustrum_center;
-                float distance = delta.Magnitude();
-                radius = glm::max(radius, distance);
+            int count = GetShadowLayerCount();
+            float split_near = _cam_near;
+            float split_far = std::max(split_near + 0.01f, std::min(_cam_far, shadow_distance));
+
+            //Half extents of the camera's view at depth 1, the frustum at depth d is these times d
+            //Orthographic cameras keep the same extents at every depth
+            bool perspective = _cam_proj[2][3] != 0;
+            float extent_x = 1.0f / _cam_proj[0][0];
+            float extent_y = 1.0f / _cam_proj[1][1];
+            glm::mat4 cam_world = glm::inverse((glm::mat4)_cam_view);
+
+            Vector3 up = std::abs(direction.y) > 0.99f ? Vector3(0, 0, 1) : Vector3(0, 1, 0);
+            //Rotation only light space, the texel grid is fixed in it so cascades do not shimmer as the camera moves
+            glm::mat4 light_rotation = glm::lookAt(glm::vec3(0), (glm::vec3)direction, (glm::vec3)up);
+            glm::mat4 light_rotation_inv = glm::inverse(light_rotation);
+
+            float cascade_near = split_near;
+            for (int c = 0; c < count; c++)
+            {
+                float p = (float)(c + 1) / count;
+                float split_log = split_near * std::pow(split_far / split_near, p);
+                float split_uniform = split_near + (split_far - split_near) * p;
+                float cascade_end = cascade_lambda * split_log + (1.0f - cascade_lambda) * split_uniform;
+
+                //Slice corners in world space
+                std::array<glm::vec3, 8> corners;
+                for (int k = 0; k < 8; k++)
+                {
+                    float depth = (k & 4) ? cascade_end : cascade_near;
+                    float scale = perspective ? depth : 1.0f;
+                    glm::vec4 corner(
+                        ((k & 1) ? 1.0f : -1.0f) * extent_x * scale,
+                        ((k & 2) ? 1.0f : -1.0f) * extent_y * scale,
+                        -depth,
+                        1.0f
+                    );
+                    corners[k] = glm::vec3(cam_world * corner);
+                }
+
+                glm::vec3 center(0.0f);
+                for (const auto& corner : corners)
+                    center += corner;
+                center /= 8.0f;
+
+                //A bounding sphere keeps the cascade's size the same however the camera turns
+                float radius = 0.0f;
+                for (const auto& corner : corners)
+                    radius = std::max(radius, glm::length(corner - center));
+                radius = std::ceil(radius * 16.0f) / 16.0f;
+
+                //Move the center in whole shadow map texels
+                float texel = (2.0f * radius) / (float)_shadow_resolution;
+                glm::vec3 light_center = glm::vec3(light_rotation * glm::vec4(center, 1.0f));
+                light_center.x = std::floor(light_center.x / texel) * texel;
+                light_center.y = std::floor(light_center.y / texel) * texel;
+                center = glm::vec3(light_rotation_inv * glm::vec4(light_center, 1.0f));
+
+                float backtrack = radius + dir_backtrack_dist;
+                cascade_view[c] = glm::lookAt(center - ((glm::vec3)direction * backtrack), center, (glm::vec3)up);
+                cascade_proj[c] = glm::ortho(-radius, radius, -radius, radius, 0.0f, backtrack + radius);
+                cascade_far[c] = cascade_end;
+
+                cascade_near = cascade_end;
             }
-            radius = std::ceil(radius * 16.0f) / 16.0f;
-
-            glm::vec3 maxExtents = glm::vec3(radius);
-            glm::vec3 minExtents = -maxExtents;
 
             created_context_view = true;
             created_context_proj = true;
 
-            range = radius * 2;
-            view_cache = glm::lookAt(frustrum_center - (direction * dir_backtrack_dist), frustrum_center, glm::vec3(0.0f, 1.0f, 0.0f));
-            proj_cache = glm::ortho(minExtents.x, maxExtents.x, minExtents.y, maxExtents.y, 0.0f, range + dir_backtrack_dist);
+            view_cache = cascade_view[0];
+            proj_cache = cascade_proj[0];
             near_clip = 0;
         }
 
@@ -121,5 +195,21 @@ namespace gbe::gfx {
             created_context_proj = true;
             return proj_cache;
         }
+
+        /// <summary>
+        /// Matrices of one shadow map layer of this light, layer being the cascade for directional lights.
+        /// </summary>
+        inline gbe::Matrix4 GetShadowViewMatrix(int layer) {
+            if (type == DIRECTIONAL)
+                return cascade_view[layer];
+
+            return GetViewMatrix();
+        }
+        inline gbe::Matrix4 GetShadowProjectionMatrix(int layer) {
+            if (type == DIRECTIONAL)
+                return cascade_proj[layer];
+
+            return GetProjectionMatrix();
+        }
     };
 }
\ No newline at end of file
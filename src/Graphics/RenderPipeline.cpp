@@ -2,6 +2,10 @@
 
 // Update includes
 #include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <string>
 #include "Editor/gbe_editor.h" 
 
 // Helper to initialize bgfx for SDL
@@ -90,6 +94,12 @@ gbe::RenderPipeline::~RenderPipeline()
 {
 	delete(this->cur_renderer);
 
+	for (auto& pair : this->currentrenderinfo.callgroups)
+	{
+		if (bgfx::isValid(pair.second.buffer))
+			bgfx::destroy(pair.second.buffer);
+	}
+
 	bgfx::shutdown();
 }
 
@@ -123,7 +133,21 @@ void gbe::RenderPipeline::RenderFrame(const SceneRenderInfo& frameinfo)
 		handled_resolution_change = true;
 	}
 
+	//Resolve every instance once, the passes only read slices of the result
+	//Instances only change through calls that bump the scene version, so without one the last result still holds
+	auto prepare_start = std::chrono::steady_clock::now();
+	if (this->currentrenderinfo.scene_version != this->prepared_scene_version) {
+		PrepareFrame();
+		this->prepared_scene_version = this->currentrenderinfo.scene_version;
+	}
+	auto prepare_end = std::chrono::steady_clock::now();
+
 	this->cur_renderer->RenderFrame(frameinfo, this->currentrenderinfo);
+	this->last_viewproj = frameinfo.projmat * frameinfo.viewmat;
+	auto render_end = std::chrono::steady_clock::now();
+
+	this->prepare_cpu_ms = std::chrono::duration<double, std::milli>(prepare_end - prepare_start).count();
+	this->render_cpu_ms = std::chrono::duration<double, std::milli>(render_end - prepare_start).count();
 
 	//EDITOR/GUI PASS [VIEW_EDITOR_PASS]
 	// The editor/GUI is rendered last to the screen.
@@ -135,18 +159,49 @@ void gbe::RenderPipeline::RenderFrame(const SceneRenderInfo& frameinfo)
 
 gbe::gfx::DrawCall* gbe::RenderPipeline::RegisterDrawCall(asset::Mesh* mesh, asset::Material* material)
 {
-	for (const auto& pair : Instance->currentrenderinfo.callgroups)
-	{
-		const auto& drawcall = pair.first;
+	auto& drawcall = Instance->drawcalls[{ mesh, material }];
+	if (drawcall != nullptr)
+		return drawcall;
+
+	drawcall = new DrawCall(mesh, material);
+	drawcall->set_sort_ids(
+		Instance->mesh_sort_ids.try_emplace(mesh, (uint32_t)Instance->mesh_sort_ids.size()).first->second,
+		Instance->material_sort_ids.try_emplace(material, (uint32_t)Instance->material_sort_ids.size()).first->second
+	);
 
-		if (drawcall->get_meshasset() == mesh && drawcall->get_materialasset() == material) {
-			return drawcall;
-		}
-	}
+	return drawcall;
+}
 
-	auto newdrawcall = new DrawCall(mesh, material);
+bool gbe::RenderPipeline::Raycast(const Vector3& origin, const Vector3& direction, float max_distance, RayPicker::Hit& hit)
+{
+	//Same groups the GPU picking pass draws
+	const uint64_t pickable_groups = GraphicsRenderInfo::GroupBit(0) | GraphicsRenderInfo::GroupBit(1);
 
-	return newdrawcall;
+	return Instance->raypicker.Raycast(Instance->currentrenderinfo, origin, direction, max_distance, pickable_groups, hit);
+}
+
+bool gbe::RenderPipeline::PickPixel(Vector2Int pixel, RayPicker::Hit& hit)
+{
+	const auto resolution = Instance->viewport_resolution;
+	if (resolution.x <= 0 || resolution.y <= 0)
+		return false;
+
+	//Pixel centre to NDC, pixels count down from the top
+	float x = 2.0f * (pixel.x + 0.5f) / resolution.x - 1.0f;
+	float y = 1.0f - 2.0f * (pixel.y + 0.5f) / resolution.y;
+
+	glm::mat4 inverse = glm::inverse((glm::mat4)Instance->last_viewproj);
+	glm::vec4 near_point = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+	glm::vec4 far_point = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+
+	Vector3 origin = glm::vec3(near_point) / near_point.w;
+	Vector3 ray = glm::vec3(far_point) / far_point.w - (glm::vec3)origin;
+	float length = ray.Magnitude();
+
+	if (!std::isfinite(length) || length <= 0.0f)
+		return false;
+
+	return Raycast(origin, ray * (1.0f / length), length, hit);
 }
 
 DrawCall* gbe::RenderPipeline::RegisterDefaultDrawCall(asset::Mesh* mesh, asset::Material* material)
@@ -161,43 +216,212 @@ DrawCall* gbe::RenderPipeline::GetDefaultDrawCall()
 	return Instance->default_drawcall;
 }
 
-gbe::Matrix4* gbe::RenderPipeline::RegisterInstance(uint32_t instance_id, DrawCall* drawcall, Matrix4 matrix)
+namespace {
+	using InstanceBatch = gbe::gfx::GraphicsRenderInfo::InstanceBatch;
+	using InstanceMap = std::unordered_map<uint32_t, gbe::gfx::GraphicsRenderInfo::InstanceInfo>;
+
+	void SwapBatchEntries(InstanceMap& infomap, InstanceBatch& batch, uint32_t a, uint32_t b) {
+		if (a == b)
+			return;
+
+		std::swap(batch.instances[a], batch.instances[b]);
+		std::swap(batch.matrices[a], batch.matrices[b]);
+		std::swap(batch.group_masks[a], batch.group_masks[b]);
+		std::swap(batch.world_bounds[a], batch.world_bounds[b]);
+		std::swap(batch.change_stamps[a], batch.change_stamps[b]);
+		infomap[batch.instances[a]].batch_index = a;
+		infomap[batch.instances[b]].batch_index = b;
+
+		batch.MarkDirty(a);
+		batch.MarkDirty(b);
+	}
+
+	void CountGroups(InstanceBatch& batch, uint64_t group_mask, int delta) {
+		while (group_mask != 0) {
+			batch.group_counts[std::countr_zero(group_mask)] += delta;
+			group_mask &= group_mask - 1;
+		}
+	}
+
+	uint64_t CheckedGroupBit(int rendergroup) {
+		uint64_t bit = gbe::gfx::GraphicsRenderInfo::GroupBit(rendergroup);
+
+		if (bit == 0)
+			throw std::runtime_error("Rendergroup " + std::to_string(rendergroup) + " is out of range.");
+
+		return bit;
+	}
+}
+
+void gbe::RenderPipeline::PrepareFrame()
+{
+	auto& renderinfo = this->currentrenderinfo;
+
+	renderinfo.prepared.clear();
+	renderinfo.prepared_slices.clear();
+	renderinfo.prepared_bounds.Clear();
+
+	size_t total = 0;
+	for (auto& pair : renderinfo.callgroups)
+	{
+		if (pair.second.enabled_count == 0)
+			continue;
+
+		renderinfo.prepared_slices.push_back({ pair.first, &pair.second, 0, 0 });
+		total += pair.second.enabled_count;
+	}
+
+	std::sort(renderinfo.prepared_slices.begin(), renderinfo.prepared_slices.end(), [](const auto& a, const auto& b) {
+		if (a.drawcall->get_shaderdata() != b.drawcall->get_shaderdata())
+			return a.drawcall->get_shaderdata() < b.drawcall->get_shaderdata();
+
+		if (a.drawcall->get_material_sort_id() != b.drawcall->get_material_sort_id())
+			return a.drawcall->get_material_sort_id() < b.drawcall->get_material_sort_id();
+
+		return a.drawcall->get_mesh_sort_id() < b.drawcall->get_mesh_sort_id();
+		});
+
+	renderinfo.prepared.reserve(total);
+	renderinfo.prepared_bounds.Reserve(total);
+	for (auto& slice : renderinfo.prepared_slices)
+	{
+		auto& batch = *slice.batch;
+		slice.begin = (uint32_t)renderinfo.prepared.size();
+		batch.prepared_begin = slice.begin;
+
+		for (uint32_t i = 0; i < batch.enabled_count; i++)
+		{
+			renderinfo.prepared.push_back({
+				slice.drawcall,
+				batch.group_masks[i],
+				&batch.matrices[i],
+				batch.instances[i],
+				i,
+				batch.change_stamps[i]
+				});
+			renderinfo.prepared_bounds.Push(batch.world_bounds[i]);
+		}
+
+		slice.end = (uint32_t)renderinfo.prepared.size();
+	}
+}
+
+void gbe::RenderPipeline::RegisterInstance(uint32_t instance_id, DrawCall* drawcall, Matrix4 matrix)
 {
+	auto& renderinfo = Instance->currentrenderinfo;
+	uint64_t default_bit = CheckedGroupBit(drawcall->get_materialdata()->getDefaultRendergroup());
+
+	if (renderinfo.infomap.find(instance_id) != renderinfo.infomap.end())
+		UnRegisterInstanceAll(instance_id);
+
+	auto& batch = renderinfo.callgroups[drawcall];
+	uint32_t index = (uint32_t)batch.instances.size();
+
+	if (index == 0)
+		batch.local_bounds = drawcall->get_meshdata()->bounds;
+
 	//COMMITTING
-	Instance->currentrenderinfo.infomap.insert_or_assign(
+	renderinfo.infomap.insert_or_assign(
 		instance_id,
 		GraphicsRenderInfo::InstanceInfo{
-			.transform = matrix,
 			.drawcall = drawcall,
-			.rendergroups = {
-				{
-					drawcall->get_materialdata()->defaultrendergroup, true
-				}
-			}
+			.batch = &batch,
+			.batch_index = index
 		});
 
-	auto drawcall_it = Instance->currentrenderinfo.callgroups.find(drawcall);
-	if (drawcall_it == Instance->currentrenderinfo.callgroups.end()) {
-		Instance->currentrenderinfo.callgroups.insert_or_assign(
-			drawcall,
-			std::vector<uint32_t>{ instance_id }
-		);
-	}
-	else {
-		drawcall_it->second.push_back(instance_id);
-	}
+	auto& info = renderinfo.infomap[instance_id];
+	AABB world_bounds = batch.local_bounds.Transformed(matrix);
+	info.bvh_leaf = renderinfo.bvh.Insert(world_bounds, &info);
+
+	batch.instances.push_back(instance_id);
+	batch.matrices.push_back(matrix);
+	batch.group_masks.push_back(default_bit);
+	batch.world_bounds.push_back(world_bounds);
+	batch.change_stamps.push_back(++renderinfo.change_counter);
+	batch.MarkDirty(index);
+	renderinfo.scene_version++;
+
+	//New instances start enabled, move it to the end of the enabled range
+	SwapBatchEntries(renderinfo.infomap, batch, index, batch.enabled_count);
+	batch.enabled_count++;
+	CountGroups(batch, default_bit, 1);
+}
+
+void gbe::gfx::GraphicsRenderInfo::Cull(const Frustum& frustum, VisibleSet& out) const
+{
+	out.indices.clear();
+
+	out.nodes_tested = this->bvh.Query(frustum, [&](InstanceInfo* info) {
+		//Disabled instances stay in the tree but are not in the prepared array
+		if (!info->enabled)
+			return;
+
+		out.indices.push_back(info->batch->prepared_begin + info->batch_index);
+		});
+
+	std::sort(out.indices.begin(), out.indices.end());
+	FillSliceOffsets(out);
+}
+
+void gbe::gfx::GraphicsRenderInfo::CullFlat(const Frustum& frustum, VisibleSet& out) const
+{
+	out.indices.resize(this->prepared.size());
+	out.indices.resize(BoxCuller::Cull(frustum, this->prepared_bounds, out.indices.data()));
+	out.nodes_tested = this->prepared.size();
+
+	FillSliceOffsets(out);
+}
+
+void gbe::gfx::GraphicsRenderInfo::FillSliceOffsets(VisibleSet& out) const
+{
+	out.culled = this->prepared.size() - out.indices.size();
+
+	//Slices are in prepared order, so each one's run starts where its first index would be
+	out.slice_offsets.clear();
+	out.slice_offsets.reserve(this->prepared_slices.size() + 1);
+	for (const auto& slice : this->prepared_slices)
+		out.slice_offsets.push_back((uint32_t)(std::lower_bound(out.indices.begin(), out.indices.end(), slice.begin) - out.indices.begin()));
+	out.slice_offsets.push_back((uint32_t)out.indices.size());
+}
+
+void gbe::RenderPipeline::UpdateInstanceTransform(uint32_t instance_id, const Matrix4& matrix)
+{
+	auto info_it = Instance->currentrenderinfo.infomap.find(instance_id);
+
+	if (info_it == Instance->currentrenderinfo.infomap.end())
+		return;
+
+	auto& batch = Instance->currentrenderinfo.callgroups[info_it->second.drawcall];
+	uint32_t index = info_it->second.batch_index;
 
-	return &Instance->currentrenderinfo.infomap[instance_id].transform;
+	batch.matrices[index] = matrix;
+	batch.world_bounds[index] = batch.local_bounds.Transformed(matrix);
+	batch.change_stamps[index] = ++Instance->currentrenderinfo.change_counter;
+	batch.MarkDirty(index);
+	Instance->currentrenderinfo.scene_version++;
+
+	Instance->currentrenderinfo.bvh.Update(info_it->second.bvh_leaf, batch.world_bounds[index]);
 }
 
 void gbe::RenderPipeline::RegisterAdditionalGroup(uint32_t instance_id, int rendergroup)
 {
+	uint64_t bit = CheckedGroupBit(rendergroup);
 	auto it = Instance->currentrenderinfo.infomap.find(instance_id);
 
 	if (it == Instance->currentrenderinfo.infomap.end())
 		return;
 
-	it->second.rendergroups.insert_or_assign(rendergroup, true);
+	auto& batch = Instance->currentrenderinfo.callgroups[it->second.drawcall];
+	auto& group_mask = batch.group_masks[it->second.batch_index];
+
+	if (group_mask & bit)
+		return;
+
+	group_mask |= bit;
+	Instance->currentrenderinfo.scene_version++;
+
+	if (it->second.enabled)
+		batch.group_counts[rendergroup]++;
 }
 
 void gbe::RenderPipeline::UnRegisterInstanceGroup(uint32_t instance_id, int rendergroup)
@@ -209,40 +433,79 @@ void gbe::RenderPipeline::UnRegisterInstanceGroup(uint32_t instance_id, int rend
 
 	auto& renderinfo = info_it->second;
 
-	if (rendergroup == renderinfo.drawcall->get_materialdata()->defaultrendergroup)
+	if (rendergroup == renderinfo.drawcall->get_materialdata()->getDefaultRendergroup())
 		return;
 
-	renderinfo.rendergroups.erase(rendergroup);
+	uint64_t bit = GraphicsRenderInfo::GroupBit(rendergroup);
+	auto& batch = Instance->currentrenderinfo.callgroups[renderinfo.drawcall];
+	auto& group_mask = batch.group_masks[renderinfo.batch_index];
+
+	if ((group_mask & bit) == 0)
+		return;
+
+	group_mask &= ~bit;
+	Instance->currentrenderinfo.scene_version++;
+
+	if (renderinfo.enabled)
+		batch.group_counts[rendergroup]--;
 }
 
 void gbe::RenderPipeline::UnRegisterInstanceAll(uint32_t instance_id)
 {
-	auto info_it = Instance->currentrenderinfo.infomap.find(instance_id);
+	auto& infomap = Instance->currentrenderinfo.infomap;
+	auto info_it = infomap.find(instance_id);
 
-	if (info_it == Instance->currentrenderinfo.infomap.end())
+	if (info_it == infomap.end())
 		return;
 
 	auto& renderinfo = info_it->second;
+	auto& batch = Instance->currentrenderinfo.callgroups[renderinfo.drawcall];
 
+	//Leave the enabled range first so the swap with the last entry keeps both ranges intact
+	if (renderinfo.enabled) {
+		CountGroups(batch, batch.group_masks[renderinfo.batch_index], -1);
+		batch.enabled_count--;
+		SwapBatchEntries(infomap, batch, renderinfo.batch_index, batch.enabled_count);
+	}
 
-	auto& callgroup = Instance->currentrenderinfo.callgroups[renderinfo.drawcall];
-
-	callgroup.erase(
-		std::remove(callgroup.begin(), callgroup.end(), instance_id),
-		callgroup.end()
-	);
-
-	Instance->currentrenderinfo.infomap.erase(instance_id);
+	SwapBatchEntries(infomap, batch, renderinfo.batch_index, (uint32_t)batch.instances.size() - 1);
+	batch.instances.pop_back();
+	batch.matrices.pop_back();
+	batch.group_masks.pop_back();
+	batch.world_bounds.pop_back();
+	batch.change_stamps.pop_back();
 
+	Instance->currentrenderinfo.bvh.Remove(renderinfo.bvh_leaf);
+	infomap.erase(instance_id);
+	Instance->currentrenderinfo.scene_version++;
 }
 
 void gbe::RenderPipeline::SetEnableInstance(uint32_t instance_id, bool value)
 {
-	auto info_it = Instance->currentrenderinfo.infomap.find(instance_id);
+	auto& infomap = Instance->currentrenderinfo.infomap;
+	auto info_it = infomap.find(instance_id);
 
-	if (info_it == Instance->currentrenderinfo.infomap.end())
+	if (info_it == infomap.end())
 		return;
 
 	auto& renderinfo = info_it->second;
+
+	if (renderinfo.enabled == value)
+		return;
+
+	auto& batch = Instance->currentrenderinfo.callgroups[renderinfo.drawcall];
+
+	if (value) {
+		SwapBatchEntries(infomap, batch, renderinfo.batch_index, batch.enabled_count);
+		batch.enabled_count++;
+		CountGroups(batch, batch.group_masks[renderinfo.batch_index], 1);
+	}
+	else {
+		CountGroups(batch, batch.group_masks[renderinfo.batch_index], -1);
+		batch.enabled_count--;
+		SwapBatchEntries(infomap, batch, renderinfo.batch_index, batch.enabled_count);
+	}
+
 	renderinfo.enabled = value;
-}
+	Instance->currentrenderinfo.scene_version++;
+}
\ No newline at end of file
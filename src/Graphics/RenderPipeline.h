@@ -32,6 +32,7 @@
 #include "Data/CallInstance.h"
 #include "Data/Light.h"
 #include "Renderer.h"
+#include "util/RayPicker.h"
 
 namespace gbe {
 
@@ -53,15 +54,33 @@ namespace gbe {
 
 		//============RUNTIME=======================//
 		DrawCall* default_drawcall;
+		//Every drawcall made, so asking again for the same mesh and material returns the same one
+		std::map<std::pair<asset::Mesh*, asset::Material*>, DrawCall*> drawcalls;
+		//Small ids of the meshes and materials drawcalls were made with, for draw sort keys
+		std::unordered_map<asset::Mesh*, uint32_t> mesh_sort_ids;
+		std::unordered_map<asset::Material*, uint32_t> material_sort_ids;
 
 		GraphicsRenderInfo currentrenderinfo;
+		RayPicker raypicker;
+		//View projection of the last rendered frame, pixel picks cast their rays through it
+		Matrix4 last_viewproj;
+		//Scene version the prepared arrays were built from
+		uint64_t prepared_scene_version = UINT64_MAX;
 
 		//============DYNAMICALLY ALLOCATED=======================//
 		Renderer* cur_renderer;
 
 		bool handled_resolution_change = true;
 
+		//CPU time of the last frame, in milliseconds
+		double prepare_cpu_ms = 0;
+		double render_cpu_ms = 0;
+
 		void ReloadFrame(); // BGFX function to create frame buffers/textures
+		/// <summary>
+		/// Flattens the enabled instances of every drawcall into the prepared array, one slice per drawcall.
+		/// </summary>
+		void PrepareFrame();
 
 	public:
 		static inline Renderer* GetRenderer() {
@@ -112,10 +131,97 @@ namespace gbe {
 
 		void RenderFrame(const SceneRenderInfo& frameinfo);
 
-		static gbe::Matrix4* RegisterInstance(uint32_t instance_id, DrawCall* drawcall, gbe::Matrix4 matrix);
+		static void RegisterInstance(uint32_t instance_id, DrawCall* drawcall, gbe::Matrix4 matrix);
+		/// <summary>
+		/// Writes a new matrix for the instance, only this entry is uploaded again on the next frame.
+		/// </summary>
+		static void UpdateInstanceTransform(uint32_t instance_id, const gbe::Matrix4& matrix);
 		static void RegisterAdditionalGroup(uint32_t instance_id, int rendergroup = 0);
 		static void UnRegisterInstanceGroup(uint32_t instance_id, int rendergroup);
 		static void UnRegisterInstanceAll(uint32_t instance_id);
 		static void SetEnableInstance(uint32_t instance_id, bool value);
+		/// <summary>
+		/// Draws the next frame in full, for changes the renderer cannot track itself such as a texture's new contents.
+		/// </summary>
+		inline static void InvalidateFrame() {
+			if (Instance != nullptr)
+				Instance->currentrenderinfo.content_version++;
+		}
+
+		/// <summary>
+		/// Nearest pickable instance along the ray, found on the CPU with no GPU readback.
+		/// </summary>
+		/// <param name="direction">Normalized.</param>
+		static bool Raycast(const Vector3& origin, const Vector3& direction, float max_distance, RayPicker::Hit& hit);
+		/// <summary>
+		/// Raycast through a pixel of the viewport, using the camera of the last rendered frame.
+		/// </summary>
+		static bool PickPixel(Vector2Int pixel, RayPicker::Hit& hit);
+		inline static size_t GetInstancesUploaded() {
+			return Instance->currentrenderinfo.instances_uploaded;
+		}
+		inline static size_t GetShadowSubmissions() {
+			return Instance->currentrenderinfo.shadow_submissions;
+		}
+		inline static size_t GetShadowLayersReused() {
+			return Instance->currentrenderinfo.shadow_layers_reused;
+		}
+		inline static size_t GetShadowAtlasRepacks() {
+			return Instance->currentrenderinfo.shadow_atlas_repacks;
+		}
+		inline static float GetShadowAtlasUsage() {
+			return Instance->currentrenderinfo.shadow_atlas_usage;
+		}
+		inline static size_t GetLightClusterEntries() {
+			return Instance->currentrenderinfo.light_cluster_entries;
+		}
+		inline static size_t GetLightClusterDropped() {
+			return Instance->currentrenderinfo.light_cluster_dropped;
+		}
+		inline static size_t GetUniformsRequested() {
+			return Instance->currentrenderinfo.uniforms_requested;
+		}
+		inline static size_t GetUniformsSent() {
+			return Instance->currentrenderinfo.uniforms_sent;
+		}
+		inline static size_t GetProgramRebinds() {
+			return Instance->currentrenderinfo.program_rebinds;
+		}
+		inline static size_t GetTextureRebinds() {
+			return Instance->currentrenderinfo.texture_rebinds;
+		}
+		/// <summary>
+		/// Whether the last frame drew the scene again, and its depth passes, or showed an earlier frame's.
+		/// </summary>
+		inline static bool GetSceneRedrawn() {
+			return Instance->currentrenderinfo.scene_redrawn;
+		}
+		inline static bool GetDepthRedrawn() {
+			return Instance->currentrenderinfo.depth_redrawn;
+		}
+		/// <summary>
+		/// Ambient occlusion resolution of the active renderer.
+		/// </summary>
+		inline static Renderer::SSAO_QUALITY GetSsaoQuality() {
+			return Instance->cur_renderer->GetSsaoQuality();
+		}
+		inline static void SetSsaoQuality(Renderer::SSAO_QUALITY quality) {
+			Instance->cur_renderer->SetSsaoQuality(quality);
+		}
+		/// <summary>
+		/// CPU time spent preparing the last frame, and in the whole renderer call including preparation.
+		/// </summary>
+		inline static double GetPrepareTime() {
+			return Instance->prepare_cpu_ms;
+		}
+		inline static double GetRenderTime() {
+			return Instance->render_cpu_ms;
+		}
+		/// <summary>
+		/// Visible and culled instance counts of each culled pass in the last frame.
+		/// </summary>
+		inline static const std::vector<GraphicsRenderInfo::PassCullStats>& GetCullStats() {
+			return Instance->currentrenderinfo.cull_stats;
+		}
 	};
 }
\ No newline at end of file
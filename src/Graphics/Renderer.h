@@ -5,8 +5,13 @@
 
 #include "Data/Light.h"
 #include "Data/DrawCall.h"
+#include "util/DynamicBVH.h"
+#include "util/BoxCuller.h"
 
 #include <queue>
+#include <algorithm>
+#include <array>
+#include <bgfx/bgfx.h>
 
 namespace gbe {
 	namespace gfx {
@@ -16,24 +21,208 @@ namespace gbe {
 			Vector2Int pointer_pixelpos;
 			gbe::Matrix4 viewmat;
 			gbe::Matrix4 projmat;
-			gbe::Matrix4 projmat_lightusage;
 			float nearclip;
 			float farclip;
-			bool skip_main_pass;
+			//Copy renderer internals into textures the image debugger can show
+			bool debug_textures = false;
 
 			//Environment info
 			std::vector<gfx::Light*> lightdatas;
 		};
 
 		struct GraphicsRenderInfo {
+			//Rendergroups are bits of a 64 bit mask
+			static constexpr int MAX_RENDERGROUPS = 64;
+
+			struct InstanceBatch;
 			struct InstanceInfo {
-				gbe::Matrix4 transform;
 				DrawCall* drawcall;
-				std::unordered_map<int, bool> rendergroups;
+				InstanceBatch* batch = nullptr;
 				bool enabled = true;
+				//Position in the drawcall's batch, moves when other instances are removed or toggled
+				uint32_t batch_index = 0;
+				int32_t bvh_leaf = DynamicBVH<InstanceInfo*>::NULL_NODE;
+			};
+			/// <summary>
+			/// Every instance of one drawcall, with its matrices mirrored in a persistent GPU buffer shared by all passes.
+			/// Enabled instances are kept first so a pass can draw them as one contiguous range.
+			/// Only the entries written since the last upload are sent again.
+			/// </summary>
+			struct InstanceBatch {
+				std::vector<uint32_t> instances;
+				std::vector<gbe::Matrix4> matrices;
+				std::vector<uint64_t> group_masks;
+				std::vector<AABB> world_bounds;
+				//Value of change_counter when each instance was last registered or moved
+				std::vector<uint64_t> change_stamps;
+				uint32_t enabled_count = 0;
+				//Enabled instances in each rendergroup
+				std::array<uint32_t, MAX_RENDERGROUPS> group_counts = {};
+
+				//UPLOAD TRACKING
+				std::vector<uint32_t> dirty_indices;
+				std::vector<uint8_t> dirty_flags;
+				bool all_dirty = true;
+
+				//Created and grown by the renderer
+				bgfx::DynamicVertexBufferHandle buffer = BGFX_INVALID_HANDLE;
+				uint32_t buffer_capacity = 0;
+
+				//Mesh bounds, transformed per instance for culling
+				AABB local_bounds;
+				//Where this batch's slice starts in the prepared array this frame
+				uint32_t prepared_begin = 0;
+
+				inline uint32_t GroupCount(int rendergroup) const {
+					if (rendergroup < 0 || rendergroup >= MAX_RENDERGROUPS)
+						return 0;
+
+					return group_counts[rendergroup];
+				}
+				inline void MarkDirty(uint32_t index) {
+					if (index >= dirty_flags.size())
+						dirty_flags.resize(matrices.size(), 0);
+
+					if (dirty_flags[index])
+						return;
+
+					dirty_flags[index] = 1;
+					dirty_indices.push_back(index);
+				}
+				inline void ClearDirty() {
+					for (const auto index : dirty_indices)
+						dirty_flags[index] = 0;
+					dirty_indices.clear();
+					all_dirty = false;
+				}
+				/// <summary>
+				/// Calls upload(begin, end) for each range of the first count entries written since the last call, then forgets them.
+				/// Everything goes up as one range when the batch is all dirty or more than half of it changed.
+				/// </summary>
+				template<class TUpload>
+				void TakeDirtyRanges(uint32_t count, TUpload&& upload) {
+					if (count > 0 && (all_dirty || dirty_indices.size() * 2 > count)) {
+						upload(0u, count);
+					}
+					else if (count > 0 && !dirty_indices.empty()) {
+						//Neighbouring entries go up in one update
+						std::sort(dirty_indices.begin(), dirty_indices.end());
+
+						size_t i = 0;
+						while (i < dirty_indices.size())
+						{
+							uint32_t start = dirty_indices[i];
+							uint32_t end = start + 1;
+
+							if (start >= count)
+								break;
+
+							while (++i < dirty_indices.size() && dirty_indices[i] == end && end < count)
+								end++;
+
+							upload(start, end);
+						}
+					}
+
+					ClearDirty();
+				}
 			};
 			std::unordered_map<uint32_t, InstanceInfo> infomap;
-			std::unordered_map<DrawCall*, std::vector<uint32_t>> callgroups;
+			std::unordered_map<DrawCall*, InstanceBatch> callgroups;
+			//World bounds of every registered instance
+			DynamicBVH<InstanceInfo*> bvh;
+			//Bumped on every instance registration or move, so stamps never repeat
+			uint64_t change_counter = 0;
+			//Bumped by every instance change a pass can see: registration, removal, moves, toggles and rendergroups
+			uint64_t scene_version = 0;
+			//Bumped when something drawn changes outside the instances, materials and lights, such as a texture's contents
+			uint64_t content_version = 0;
+			//Matrices sent to the GPU on the last frame
+			size_t instances_uploaded = 0;
+			//Shadow draws submitted on the last frame, and shadow layers kept from the frame before
+			size_t shadow_submissions = 0;
+			size_t shadow_layers_reused = 0;
+			//Times the shadow atlas moved its tiles, and the fraction of it in use on the last frame
+			size_t shadow_atlas_repacks = 0;
+			float shadow_atlas_usage = 0;
+			//Light entries in the camera's clusters on the last frame, and those left out of full clusters
+			size_t light_cluster_entries = 0;
+			size_t light_cluster_dropped = 0;
+			//Uniform sets asked for on the last frame, and those left after deduplication
+			size_t uniforms_requested = 0;
+			size_t uniforms_sent = 0;
+			//Program and texture changes between consecutive scene draws on the last frame
+			size_t program_rebinds = 0;
+			size_t texture_rebinds = 0;
+			//Whether the last frame drew the scene again, and its depth passes, instead of keeping an earlier frame's
+			bool scene_redrawn = false;
+			bool depth_redrawn = false;
+
+			//FRAME PREPARATION, rebuilt once per frame before any pass runs
+			struct PreparedInstance {
+				DrawCall* drawcall;
+				uint64_t group_mask;
+				const gbe::Matrix4* matrix;
+				uint32_t instance_id;
+				uint32_t batch_index;
+				uint64_t change_stamp;
+			};
+			/// <summary>
+			/// The enabled instances of one drawcall, as the range [begin, end) of the prepared array.
+			/// Their order matches the batch, so a slice covering a whole group is the persistent buffer range [0, end - begin).
+			/// </summary>
+			struct PreparedSlice {
+				DrawCall* drawcall;
+				InstanceBatch* batch;
+				uint32_t begin;
+				uint32_t end;
+			};
+			std::vector<PreparedInstance> prepared;
+			//World bounds of the prepared instances, same order
+			AABBArray prepared_bounds;
+			//Sorted so drawcalls sharing a shader and material are adjacent
+			std::vector<PreparedSlice> prepared_slices;
+
+			/// <summary>
+			/// Prepared instances that passed one view's culling, in prepared order.
+			/// The run of slice s is indices[slice_offsets[s]] up to indices[slice_offsets[s + 1]].
+			/// </summary>
+			struct VisibleSet {
+				std::vector<uint32_t> indices;
+				std::vector<uint32_t> slice_offsets;
+				size_t culled = 0;
+				size_t nodes_tested = 0;
+
+				inline uint32_t SliceCount(size_t slice) const {
+					return slice_offsets[slice + 1] - slice_offsets[slice];
+				}
+			};
+			struct PassCullStats {
+				std::string pass;
+				size_t visible;
+				size_t culled;
+			};
+			//Filled by the renderer each frame
+			std::vector<PassCullStats> cull_stats;
+
+			/// <summary>
+			/// Collects the prepared instances whose world bounds touch the frustum. Call after the frame is prepared.
+			/// </summary>
+			void Cull(const Frustum& frustum, VisibleSet& out) const;
+			/// <summary>
+			/// Same result as Cull, by testing every prepared instance with the batch kernel instead of walking the tree.
+			/// Cheaper for views that see most of the scene, and its output needs no sorting.
+			/// </summary>
+			void CullFlat(const Frustum& frustum, VisibleSet& out) const;
+
+			void FillSliceOffsets(VisibleSet& out) const;
+
+			inline static uint64_t GroupBit(int rendergroup) {
+				if (rendergroup < 0 || rendergroup >= MAX_RENDERGROUPS)
+					return 0;
+
+				return (uint64_t)1 << rendergroup;
+			}
 
 			//LINES
 			uint32_t frame_id = 0;
@@ -47,6 +236,12 @@ namespace gbe {
 				PASS_ID,
 				PASS_UV
 			};
+			//Screen pixels per ambient occlusion texel on each side, lower quality also takes fewer samples
+			enum SSAO_QUALITY {
+				SSAO_FULL = 1,
+				SSAO_HALF = 2,
+				SSAO_QUARTER = 4
+			};
 
 			struct BRGA_t {
 				uint8_t b;
@@ -56,12 +251,13 @@ namespace gbe {
 
 				BRGA_t() : b(0), g(0), r(0), a(0) {}
 				uint32_t hashed() const {
-					return (uint32_t(b) << 0) | (uint32_t(g) << 8) | (uint32_t(r) << 16);
+					return (uint32_t(b) << 0) | (uint32_t(g) << 8) | (uint32_t(r) << 16) | (uint32_t(a) << 24);
 				}
 				BRGA_t(uint32_t hash) {
 					b = (hash >> 0) & 0xFF;
 					g = (hash >> 8) & 0xFF;
 					r = (hash >> 16) & 0xFF;
+					a = (hash >> 24) & 0xFF;
 				}
 				Vector4 ToVector4() const {
 					return Vector4(float(r) / 255.0f, float(g) / 255.0f, float(b) / 255.0f, float(a) / 255.0f);
@@ -111,6 +307,14 @@ namespace gbe {
 			virtual TextureData ReloadFrame(Vector2Int reso) = 0;
 			virtual void RenderFrame(const SceneRenderInfo& frameinfo, GraphicsRenderInfo& passinfo) = 0;
 			virtual void InitializeAssetRequests() = 0;
+
+			/// <summary>
+			/// Resolution ambient occlusion is computed at, for renderers that have it.
+			/// </summary>
+			virtual void SetSsaoQuality(SSAO_QUALITY quality) {}
+			virtual SSAO_QUALITY GetSsaoQuality() const {
+				return SSAO_FULL;
+			}
 		};
 	}
 }
\ No newline at end of file
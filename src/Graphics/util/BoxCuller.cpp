@@ -0,0 +1,218 @@
+#include "BoxCuller.h"
+
+#include <bit>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define GBE_BOXCULLER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GBE_TARGET_AVX2
+#else
+#define GBE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define GBE_BOXCULLER_X86 0
+#endif
+
+using namespace gbe;
+using namespace gbe::gfx;
+
+namespace {
+	//One frustum plane with the box component arrays that hold its farthest corner.
+	//Picking the arrays once per plane leaves no per-box select in the inner loops
+	struct PlaneStream {
+		float nx, ny, nz, d;
+		const float* px;
+		const float* py;
+		const float* pz;
+	};
+
+	void SetupPlanes(const Frustum& frustum, const AABBArray& boxes, PlaneStream(&streams)[6]) {
+		for (int p = 0; p < 6; p++)
+		{
+			const auto& plane = frustum.planes[p];
+			streams[p] = {
+				plane.x, plane.y, plane.z, plane.w,
+				plane.x >= 0 ? boxes.max_x.data() : boxes.min_x.data(),
+				plane.y >= 0 ? boxes.max_y.data() : boxes.min_y.data(),
+				plane.z >= 0 ? boxes.max_z.data() : boxes.min_z.data()
+			};
+		}
+	}
+
+	inline bool IsVisible(const PlaneStream(&streams)[6], size_t i) {
+		for (const auto& p : streams)
+		{
+			if (p.nx * p.px[i] + p.ny * p.py[i] + p.nz * p.pz[i] + p.d < 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	size_t CullRange(const PlaneStream(&streams)[6], size_t begin, size_t end, uint32_t* out) {
+		size_t written = 0;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			if (IsVisible(streams, i))
+				out[written++] = (uint32_t)i;
+		}
+
+		return written;
+	}
+
+	//Writes the index of every set bit, lowest first
+	inline size_t EmitMask(uint32_t mask, size_t base, uint32_t* out) {
+		size_t written = 0;
+
+		while (mask != 0) {
+			out[written++] = (uint32_t)(base + std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+
+		return written;
+	}
+
+#if GBE_BOXCULLER_X86
+	//SSE2 is part of x86-64, so this path needs no check. Two 4 wide halves make up each batch of 8
+	size_t CullSSE(const PlaneStream(&streams)[6], size_t count, uint32_t* out) {
+		const __m128 zero = _mm_setzero_ps();
+		size_t written = 0;
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128 visible_lo = _mm_cmpeq_ps(zero, zero);
+			__m128 visible_hi = visible_lo;
+
+			for (const auto& p : streams)
+			{
+				const __m128 nx = _mm_set1_ps(p.nx);
+				const __m128 ny = _mm_set1_ps(p.ny);
+				const __m128 nz = _mm_set1_ps(p.nz);
+				const __m128 d = _mm_set1_ps(p.d);
+
+				__m128 dot_lo = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, _mm_loadu_ps(p.px + i)),
+					_mm_mul_ps(ny, _mm_loadu_ps(p.py + i))),
+					_mm_mul_ps(nz, _mm_loadu_ps(p.pz + i))), d);
+				__m128 dot_hi = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, _mm_loadu_ps(p.px + i + 4)),
+					_mm_mul_ps(ny, _mm_loadu_ps(p.py + i + 4))),
+					_mm_mul_ps(nz, _mm_loadu_ps(p.pz + i + 4))), d);
+
+				visible_lo = _mm_and_ps(visible_lo, _mm_cmpge_ps(dot_lo, zero));
+				visible_hi = _mm_and_ps(visible_hi, _mm_cmpge_ps(dot_hi, zero));
+
+				//Every box of the batch is already out
+				if (_mm_movemask_ps(_mm_or_ps(visible_lo, visible_hi)) == 0)
+					break;
+			}
+
+			uint32_t mask = (uint32_t)_mm_movemask_ps(visible_lo) | ((uint32_t)_mm_movemask_ps(visible_hi) << 4);
+			written += EmitMask(mask, i, out + written);
+		}
+
+		return written + CullRange(streams, i, count, out + written);
+	}
+
+	GBE_TARGET_AVX2 size_t CullAVX2(const PlaneStream(&streams)[6], size_t count, uint32_t* out) {
+		const __m256 zero = _mm256_setzero_ps();
+		size_t written = 0;
+		size_t i = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 visible = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+			for (const auto& p : streams)
+			{
+				__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(p.nx), _mm256_loadu_ps(p.px + i)),
+					_mm256_mul_ps(_mm256_set1_ps(p.ny), _mm256_loadu_ps(p.py + i))),
+					_mm256_mul_ps(_mm256_set1_ps(p.nz), _mm256_loadu_ps(p.pz + i))), _mm256_set1_ps(p.d));
+
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(dot, zero, _CMP_GE_OQ));
+
+				if (_mm256_testz_ps(visible, visible))
+					break;
+			}
+
+			written += EmitMask((uint32_t)_mm256_movemask_ps(visible), i, out + written);
+		}
+
+		return written + CullRange(streams, i, count, out + written);
+	}
+
+	bool HasAVX2() {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		//The OS also has to save the upper halves of the ymm registers
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+}
+
+size_t gbe::gfx::BoxCuller::Cull(const Frustum& frustum, const AABBArray& boxes, uint32_t* out)
+{
+	PlaneStream streams[6];
+	SetupPlanes(frustum, boxes, streams);
+
+#if GBE_BOXCULLER_X86
+	if (GetPath() == AVX2)
+		return CullAVX2(streams, boxes.Size(), out);
+
+	return CullSSE(streams, boxes.Size(), out);
+#else
+	return CullRange(streams, 0, boxes.Size(), out);
+#endif
+}
+
+size_t gbe::gfx::BoxCuller::CullScalar(const Frustum& frustum, const AABBArray& boxes, uint32_t* out)
+{
+	PlaneStream streams[6];
+	SetupPlanes(frustum, boxes, streams);
+
+	return CullRange(streams, 0, boxes.Size(), out);
+}
+
+gbe::gfx::BoxCuller::Path gbe::gfx::BoxCuller::GetPath()
+{
+#if GBE_BOXCULLER_X86
+	static const Path path = HasAVX2() ? AVX2 : SSE;
+	return path;
+#else
+	return SCALAR;
+#endif
+}
+
+const char* gbe::gfx::BoxCuller::GetPathName()
+{
+	switch (GetPath())
+	{
+	case AVX2:
+		return "AVX2";
+	case SSE:
+		return "SSE";
+	default:
+		return "Scalar";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// Boxes stored as one array per component, so a batch of them can be tested against a plane in a few vector loads.
+		/// </summary>
+		struct AABBArray {
+			std::vector<float> min_x, min_y, min_z;
+			std::vector<float> max_x, max_y, max_z;
+
+			inline size_t Size() const {
+				return min_x.size();
+			}
+			inline void Clear() {
+				for (auto component : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z })
+					component->clear();
+			}
+			inline void Reserve(size_t count) {
+				for (auto component : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z })
+					component->reserve(count);
+			}
+			inline void Push(const AABB& box) {
+				min_x.push_back(box.min.x);
+				min_y.push_back(box.min.y);
+				min_z.push_back(box.min.z);
+				max_x.push_back(box.max.x);
+				max_y.push_back(box.max.y);
+				max_z.push_back(box.max.z);
+			}
+		};
+
+		/// <summary>
+		/// Tests every box of an AABBArray against a frustum, 8 boxes per iteration.
+		/// Uses AVX2 when the CPU has it, SSE on other x86 CPUs, and plain floats elsewhere.
+		/// </summary>
+		class BoxCuller {
+		public:
+			enum Path {
+				SCALAR,
+				SSE,
+				AVX2
+			};
+
+			/// <summary>
+			/// Writes the index of every box touching the frustum to out, in ascending order.
+			/// </summary>
+			/// <param name="out">Needs room for boxes.Size() entries.</param>
+			/// <returns>The number of indices written.</returns>
+			static size_t Cull(const Frustum& frustum, const AABBArray& boxes, uint32_t* out);
+			/// <summary>
+			/// Same as Cull, always on the scalar path.
+			/// </summary>
+			static size_t CullScalar(const Frustum& frustum, const AABBArray& boxes, uint32_t* out);
+
+			static Path GetPath();
+			static const char* GetPathName();
+		};
+	}
+}
\ No newline at end of file
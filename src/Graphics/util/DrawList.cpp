@@ -0,0 +1,53 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	constexpr uint32_t DEPTH_SHIFT = 0;
+	constexpr uint32_t MESH_SHIFT = DEPTH_SHIFT + gbe::gfx::DrawList::DEPTH_BITS;
+	constexpr uint32_t MATERIAL_SHIFT = MESH_SHIFT + gbe::gfx::DrawList::MESH_BITS;
+	constexpr uint32_t PROGRAM_SHIFT = MATERIAL_SHIFT + gbe::gfx::DrawList::MATERIAL_BITS;
+	constexpr uint32_t PASS_SHIFT = PROGRAM_SHIFT + gbe::gfx::DrawList::PROGRAM_BITS;
+	static_assert(PASS_SHIFT + gbe::gfx::DrawList::PASS_BITS == 64, "Sort key fields must fill 64 bits.");
+
+	constexpr uint64_t Mask(uint32_t bits) {
+		return ((uint64_t)1 << bits) - 1;
+	}
+}
+
+uint64_t gbe::gfx::DrawList::MakeKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t mesh, uint32_t depth_bucket)
+{
+	return ((pass & Mask(PASS_BITS)) << PASS_SHIFT)
+		| ((program & Mask(PROGRAM_BITS)) << PROGRAM_SHIFT)
+		| ((material & Mask(MATERIAL_BITS)) << MATERIAL_SHIFT)
+		| ((mesh & Mask(MESH_BITS)) << MESH_SHIFT)
+		| ((depth_bucket & Mask(DEPTH_BITS)) << DEPTH_SHIFT);
+}
+
+uint32_t gbe::gfx::DrawList::DepthBucket(float depth, float near, float far)
+{
+	near = std::max(near, 0.01f);
+	far = std::max(far, near * 1.01f);
+	depth = std::clamp(depth, near, far);
+
+	float t = std::log(depth / near) / std::log(far / near);
+	return (uint32_t)(t * (float)Mask(DEPTH_BITS));
+}
+
+uint32_t gbe::gfx::DrawList::GetPass(uint64_t key)
+{
+	return (uint32_t)((key >> PASS_SHIFT) & Mask(PASS_BITS));
+}
+
+uint32_t gbe::gfx::DrawList::GetProgram(uint64_t key)
+{
+	return (uint32_t)((key >> PROGRAM_SHIFT) & Mask(PROGRAM_BITS));
+}
+
+void gbe::gfx::DrawList::Sort()
+{
+	std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+		return a.key < b.key;
+		});
+}
\ No newline at end of file
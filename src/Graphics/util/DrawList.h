@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// The draws of one view as 64 bit sort keys, from the highest bits: pass, program, material, mesh, depth bucket.
+		/// Sorting the keys puts draws sharing a program and material next to each other, nearest first.
+		/// </summary>
+		class DrawList {
+		public:
+			static constexpr uint32_t PASS_BITS = 4;
+			static constexpr uint32_t PROGRAM_BITS = 12;
+			static constexpr uint32_t MATERIAL_BITS = 14;
+			static constexpr uint32_t MESH_BITS = 14;
+			static constexpr uint32_t DEPTH_BITS = 20;
+
+			enum Pass : uint32_t {
+				PASS_OPAQUE = 0
+			};
+
+			struct Item {
+				uint64_t key;
+				//Index of the prepared slice to draw
+				uint32_t slice;
+			};
+		private:
+			std::vector<Item> items;
+		public:
+			/// <summary>
+			/// Fields wider than their bits wrap, which only costs ordering.
+			/// </summary>
+			static uint64_t MakeKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t mesh, uint32_t depth_bucket);
+			/// <summary>
+			/// Bucket of a view depth, spaced logarithmically so near draws are told apart more finely.
+			/// </summary>
+			static uint32_t DepthBucket(float depth, float near, float far);
+
+			static uint32_t GetPass(uint64_t key);
+			static uint32_t GetProgram(uint64_t key);
+
+			inline void Clear() {
+				items.clear();
+			}
+			inline void Push(uint64_t key, uint32_t slice) {
+				items.push_back({ key, slice });
+			}
+			void Sort();
+
+			inline const std::vector<Item>& GetItems() const {
+				return items;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// Bounding volume hierarchy over moving boxes, one leaf per payload.
+		/// Inserts pick the sibling that grows the tree's surface area least. Moves refit the ancestors in place,
+		/// and a leaf that leaves its parent's box is reinserted so the tree does not degrade.
+		/// Leaf ids stay valid until the leaf is removed.
+		/// </summary>
+		template<typename TPayload>
+		class DynamicBVH {
+		public:
+			static constexpr int32_t NULL_NODE = -1;
+		private:
+			struct Node {
+				AABB bounds;
+				int32_t parent = NULL_NODE;
+				int32_t left = NULL_NODE;
+				int32_t right = NULL_NODE;
+				TPayload payload{};
+
+				inline bool IsLeaf() const {
+					return left == NULL_NODE;
+				}
+			};
+
+			std::vector<Node> nodes;
+			std::vector<int32_t> free_nodes;
+			int32_t root = NULL_NODE;
+			size_t leaf_count = 0;
+
+			int32_t AllocateNode() {
+				if (!free_nodes.empty()) {
+					int32_t node = free_nodes.back();
+					free_nodes.pop_back();
+					nodes[node] = Node();
+					return node;
+				}
+
+				nodes.push_back(Node());
+				return (int32_t)nodes.size() - 1;
+			}
+
+			void RefitUpwards(int32_t node) {
+				while (node != NULL_NODE) {
+					auto& cur = nodes[node];
+					AABB refit = AABB::Merge(nodes[cur.left].bounds, nodes[cur.right].bounds);
+
+					//Ancestors above an unchanged box are unchanged too
+					if (refit.min == cur.bounds.min && refit.max == cur.bounds.max)
+						return;
+
+					cur.bounds = refit;
+					node = cur.parent;
+				}
+			}
+
+			void InsertLeaf(int32_t leaf) {
+				if (root == NULL_NODE) {
+					root = leaf;
+					nodes[leaf].parent = NULL_NODE;
+					return;
+				}
+
+				//Walk down towards the cheapest sibling
+				const AABB& leaf_bounds = nodes[leaf].bounds;
+				int32_t sibling = root;
+
+				while (!nodes[sibling].IsLeaf()) {
+					const auto& cur = nodes[sibling];
+					float area = cur.bounds.SurfaceArea();
+					float combined_area = AABB::Merge(cur.bounds, leaf_bounds).SurfaceArea();
+
+					//Cost of pairing with this node, and the cost pushed onto every child below it
+					float cost = 2.0f * combined_area;
+					float inheritance_cost = 2.0f * (combined_area - area);
+
+					const auto child_cost = [&](int32_t child) {
+						const auto& child_node = nodes[child];
+						float merged_area = AABB::Merge(child_node.bounds, leaf_bounds).SurfaceArea();
+
+						if (child_node.IsLeaf())
+							return merged_area + inheritance_cost;
+
+						return merged_area - child_node.bounds.SurfaceArea() + inheritance_cost;
+						};
+
+					float cost_left = child_cost(cur.left);
+					float cost_right = child_cost(cur.right);
+
+					if (cost < cost_left && cost < cost_right)
+						break;
+
+					sibling = (cost_left < cost_right) ? cur.left : cur.right;
+				}
+
+				int32_t old_parent = nodes[sibling].parent;
+				int32_t new_parent = AllocateNode();
+				nodes[new_parent].parent = old_parent;
+				nodes[new_parent].bounds = AABB::Merge(nodes[sibling].bounds, nodes[leaf].bounds);
+				nodes[new_parent].left = sibling;
+				nodes[new_parent].right = leaf;
+				nodes[sibling].parent = new_parent;
+				nodes[leaf].parent = new_parent;
+
+				if (old_parent == NULL_NODE) {
+					root = new_parent;
+				}
+				else {
+					if (nodes[old_parent].left == sibling)
+						nodes[old_parent].left = new_parent;
+					else
+						nodes[old_parent].right = new_parent;
+
+					RefitUpwards(old_parent);
+				}
+			}
+
+			void RemoveLeaf(int32_t leaf) {
+				if (leaf == root) {
+					root = NULL_NODE;
+					return;
+				}
+
+				int32_t parent = nodes[leaf].parent;
+				int32_t grandparent = nodes[parent].parent;
+				int32_t sibling = (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+
+				//The sibling takes the parent's place
+				if (grandparent == NULL_NODE) {
+					root = sibling;
+					nodes[sibling].parent = NULL_NODE;
+				}
+				else {
+					if (nodes[grandparent].left == parent)
+						nodes[grandparent].left = sibling;
+					else
+						nodes[grandparent].right = sibling;
+
+					nodes[sibling].parent = grandparent;
+					RefitUpwards(grandparent);
+				}
+
+				free_nodes.push_back(parent);
+			}
+		public:
+			int32_t Insert(const AABB& bounds, TPayload payload) {
+				int32_t leaf = AllocateNode();
+				nodes[leaf].bounds = bounds;
+				nodes[leaf].payload = payload;
+
+				InsertLeaf(leaf);
+				leaf_count++;
+
+				return leaf;
+			}
+
+			void Remove(int32_t leaf) {
+				if (leaf == NULL_NODE)
+					return;
+
+				RemoveLeaf(leaf);
+				free_nodes.push_back(leaf);
+				leaf_count--;
+			}
+
+			/// <summary>
+			/// Moves a leaf. Small moves only refit its ancestors, a leaf that leaves its parent's box is reinserted.
+			/// </summary>
+			void Update(int32_t leaf, const AABB& bounds) {
+				auto& node = nodes[leaf];
+				node.bounds = bounds;
+
+				if (node.parent == NULL_NODE)
+					return;
+
+				if (nodes[node.parent].bounds.Contains(bounds)) {
+					RefitUpwards(node.parent);
+					return;
+				}
+
+				RemoveLeaf(leaf);
+				InsertLeaf(leaf);
+			}
+
+			inline const AABB& GetBounds(int32_t leaf) const {
+				return nodes[leaf].bounds;
+			}
+			inline size_t GetLeafCount() const {
+				return leaf_count;
+			}
+
+			/// <summary>
+			/// Calls the visitor with the payload of every leaf whose box touches the frustum.
+			/// Subtrees fully inside are emitted without testing their leaves.
+			/// </summary>
+			/// <returns>The number of nodes tested against the frustum.</returns>
+			template<typename TVisitor>
+			size_t Query(const Frustum& frustum, TVisitor&& visit) const {
+				if (root == NULL_NODE)
+					return 0;
+
+				size_t tested = 0;
+				static thread_local std::vector<std::pair<int32_t, bool>> stack;
+				stack.clear();
+				stack.push_back({ root, false });
+
+				while (!stack.empty()) {
+					auto [index, inside] = stack.back();
+					stack.pop_back();
+
+					const auto& node = nodes[index];
+
+					if (!inside) {
+						tested++;
+						auto result = frustum.Classify(node.bounds);
+
+						if (result == Frustum::OUTSIDE)
+							continue;
+
+						inside = result == Frustum::INSIDE;
+					}
+
+					if (node.IsLeaf()) {
+						visit(node.payload);
+						continue;
+					}
+
+					stack.push_back({ node.left, inside });
+					stack.push_back({ node.right, inside });
+				}
+
+				return tested;
+			}
+
+			/// <summary>
+			/// Calls the visitor with the payload and entry distance of every leaf the ray reaches before max_t, nearer children first.
+			/// The visitor returns the new max_t, so a hit prunes every box behind it.
+			/// </summary>
+			/// <returns>The number of nodes tested against the ray.</returns>
+			template<typename TVisitor>
+			size_t QueryRay(const Vector3& origin, const Vector3& direction, float max_t, TVisitor&& visit) const {
+				if (root == NULL_NODE)
+					return 0;
+
+				const Vector3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+				size_t tested = 1;
+				float t_root;
+				if (!nodes[root].bounds.IntersectRay(origin, inv_direction, max_t, t_root))
+					return tested;
+
+				static thread_local std::vector<std::pair<int32_t, float>> stack;
+				stack.clear();
+				stack.push_back({ root, t_root });
+
+				while (!stack.empty()) {
+					auto [index, t_enter] = stack.back();
+					stack.pop_back();
+
+					//A closer hit may have been found since this node was pushed
+					if (t_enter > max_t)
+						continue;
+
+					const auto& node = nodes[index];
+
+					if (node.IsLeaf()) {
+						max_t = visit(node.payload, t_enter, max_t);
+						continue;
+					}
+
+					float t_left, t_right;
+					bool hit_left = nodes[node.left].bounds.IntersectRay(origin, inv_direction, max_t, t_left);
+					bool hit_right = nodes[node.right].bounds.IntersectRay(origin, inv_direction, max_t, t_right);
+					tested += 2;
+
+					//The nearer child goes on top
+					if (hit_left && hit_right) {
+						if (t_left < t_right) {
+							stack.push_back({ node.right, t_right });
+							stack.push_back({ node.left, t_left });
+						}
+						else {
+							stack.push_back({ node.left, t_left });
+							stack.push_back({ node.right, t_right });
+						}
+					}
+					else if (hit_left) {
+						stack.push_back({ node.left, t_left });
+					}
+					else if (hit_right) {
+						stack.push_back({ node.right, t_right });
+					}
+				}
+
+				return tested;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "HiZOcclusion.h"
+
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+void gbe::gfx::HiZOcclusion::Update(const float* depth, uint32_t width, uint32_t height, uint32_t _screen_width, uint32_t _screen_height, uint32_t _level_shift, const Matrix4& _viewproj, bool _origin_bottom_left, bool _homogeneous_depth)
+{
+	screen_width = _screen_width;
+	screen_height = _screen_height;
+	level_shift = _level_shift;
+	viewproj = _viewproj;
+	origin_bottom_left = _origin_bottom_left;
+	homogeneous_depth = _homogeneous_depth;
+	valid = width > 0 && height > 0 && screen_width > 0 && screen_height > 0;
+
+	if (!valid)
+		return;
+
+	//Level 0 is the readback itself, each next level keeps the farthest of 2x2 texels
+	size_t count = 1;
+	for (uint32_t w = width, h = height; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2)
+		count++;
+
+	levels.resize(count);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].depth.assign(depth, depth + (size_t)width * height);
+
+	for (size_t l = 1; l < count; l++)
+	{
+		const auto& source = levels[l - 1];
+		auto& level = levels[l];
+		level.width = (source.width + 1) / 2;
+		level.height = (source.height + 1) / 2;
+		level.depth.resize((size_t)level.width * level.height);
+
+		for (uint32_t y = 0; y < level.height; y++)
+		{
+			uint32_t y0 = y * 2;
+			uint32_t y1 = std::min(y0 + 1, source.height - 1);
+
+			for (uint32_t x = 0; x < level.width; x++)
+			{
+				uint32_t x0 = x * 2;
+				uint32_t x1 = std::min(x0 + 1, source.width - 1);
+
+				level.depth[(size_t)y * level.width + x] = std::max(
+					std::max(source.depth[(size_t)y0 * source.width + x0], source.depth[(size_t)y0 * source.width + x1]),
+					std::max(source.depth[(size_t)y1 * source.width + x0], source.depth[(size_t)y1 * source.width + x1])
+				);
+			}
+		}
+	}
+}
+
+bool gbe::gfx::HiZOcclusion::IsOccluded(const AABB& box) const
+{
+	if (!valid || box.IsEmpty())
+		return false;
+
+	float min_x = FLT_MAX, min_y = FLT_MAX, min_z = FLT_MAX;
+	float max_x = -FLT_MAX, max_y = -FLT_MAX;
+
+	for (int k = 0; k < 8; k++)
+	{
+		glm::vec4 corner(
+			(k & 1) ? box.max.x : box.min.x,
+			(k & 2) ? box.max.y : box.min.y,
+			(k & 4) ? box.max.z : box.min.z,
+			1.0f
+		);
+		glm::vec4 clip = (glm::mat4)viewproj * corner;
+
+		//Crossing the camera plane, the rectangle is unbounded
+		if (clip.w <= 1e-5f)
+			return false;
+
+		float inv_w = 1.0f / clip.w;
+		min_x = std::min(min_x, clip.x * inv_w);
+		max_x = std::max(max_x, clip.x * inv_w);
+		min_y = std::min(min_y, clip.y * inv_w);
+		max_y = std::max(max_y, clip.y * inv_w);
+		min_z = std::min(min_z, clip.z * inv_w);
+	}
+
+	//Off the readback entirely, nothing there to hide it
+	if (max_x < -1.0f || min_x > 1.0f || max_y < -1.0f || min_y > 1.0f)
+		return false;
+
+	float nearest = homogeneous_depth ? min_z * 0.5f + 0.5f : min_z;
+	if (nearest <= 0.0f)
+		return false;
+
+	//Through screen pixels, since rounding up at every halving leaves the readback covering a bit more than the screen
+	const auto& base = levels[0];
+	const auto to_texel_x = [&](float ndc) {
+		uint32_t pixel = (uint32_t)std::clamp((ndc * 0.5f + 0.5f) * screen_width, 0.0f, (float)screen_width - 1);
+		return std::min(pixel >> level_shift, base.width - 1);
+		};
+	const auto to_texel_y = [&](float ndc) {
+		float t = ndc * 0.5f + 0.5f;
+		uint32_t pixel = (uint32_t)std::clamp((origin_bottom_left ? t : 1.0f - t) * screen_height, 0.0f, (float)screen_height - 1);
+		return std::min(pixel >> level_shift, base.height - 1);
+		};
+
+	uint32_t x0 = to_texel_x(min_x);
+	uint32_t x1 = to_texel_x(max_x);
+	uint32_t y0 = to_texel_y(min_y);
+	uint32_t y1 = to_texel_y(max_y);
+	if (y0 > y1)
+		std::swap(y0, y1);
+
+	//Coarsest detail first would always pass, so climb only until the rectangle is small
+	size_t l = 0;
+	while (l + 1 < levels.size() && std::max(x1 - x0, y1 - y0) + 1 > MAX_FOOTPRINT) {
+		x0 >>= 1;
+		x1 >>= 1;
+		y0 >>= 1;
+		y1 >>= 1;
+		l++;
+	}
+
+	const auto& level = levels[l];
+	for (uint32_t y = y0; y <= y1; y++)
+	{
+		for (uint32_t x = x0; x <= x1; x++)
+		{
+			if (nearest <= level.depth[(size_t)y * level.width + x])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+size_t gbe::gfx::HiZOcclusion::Filter(const AABBArray& boxes, std::vector<uint32_t>& indices) const
+{
+	if (!valid || indices.empty())
+		return 0;
+
+	std::vector<uint8_t> occluded(indices.size(), 0);
+	const auto test_range = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t b = indices[i];
+			AABB box(
+				Vector3(boxes.min_x[b], boxes.min_y[b], boxes.min_z[b]),
+				Vector3(boxes.max_x[b], boxes.max_y[b], boxes.max_z[b])
+			);
+
+			occluded[i] = IsOccluded(box) ? 1 : 0;
+		}
+		};
+
+	auto jobsystem = JobSystem::Get();
+	if (jobsystem != nullptr) {
+		JobCounter counter;
+		jobsystem->ParallelFor(indices.size(), 256, test_range, &counter);
+		jobsystem->Wait(&counter);
+	}
+	else {
+		test_range(0, indices.size());
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (!occluded[i])
+			indices[kept++] = indices[i];
+	}
+
+	size_t removed = indices.size() - kept;
+	indices.resize(kept);
+
+	return removed;
+}
\ No newline at end of file
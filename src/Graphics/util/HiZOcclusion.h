@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+#include "BoxCuller.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// Occlusion tests of world boxes against a depth readback of an earlier frame, on the CPU.
+		/// The readback holds the farthest depth under each texel. A max pyramid of it is built here,
+		/// and a box is occluded when its nearest depth lies behind every texel its screen rectangle covers.
+		/// Boxes are projected with the readback frame's view projection, which reprojects them into that frame.
+		/// </summary>
+		class HiZOcclusion {
+		public:
+			//A box's rectangle is tested on the first level where it spans at most this many texels per side
+			static constexpr uint32_t MAX_FOOTPRINT = 4;
+		private:
+			struct Level {
+				uint32_t width;
+				uint32_t height;
+				std::vector<float> depth;
+			};
+			std::vector<Level> levels;
+			//Screen the readback was reduced from, and how many times it was halved to get there
+			uint32_t screen_width = 0;
+			uint32_t screen_height = 0;
+			uint32_t level_shift = 0;
+			Matrix4 viewproj;
+			bool origin_bottom_left = false;
+			bool homogeneous_depth = false;
+			bool valid = false;
+		public:
+			/// <summary>
+			/// Takes a new readback, rows from the top unless origin_bottom_left.
+			/// Each halving rounds up, so readback texel x covers screen pixels [x * 2^level_shift, (x + 1) * 2^level_shift).
+			/// </summary>
+			/// <param name="level_shift">Times the screen was halved to get the readback.</param>
+			/// <param name="homogeneous_depth">Clip depth runs -1 to 1 and is stored remapped to 0 to 1.</param>
+			void Update(const float* depth, uint32_t width, uint32_t height, uint32_t screen_width, uint32_t screen_height, uint32_t level_shift, const Matrix4& viewproj, bool origin_bottom_left, bool homogeneous_depth);
+			inline void Invalidate() {
+				valid = false;
+			}
+			inline bool IsValid() const {
+				return valid;
+			}
+
+			bool IsOccluded(const AABB& box) const;
+
+			/// <summary>
+			/// Removes the occluded boxes from indices, keeping the order of the rest. Runs on the job system.
+			/// </summary>
+			/// <returns>The number of indices removed.</returns>
+			size_t Filter(const AABBArray& boxes, std::vector<uint32_t>& indices) const;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "LightClusters.h"
+
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	float SqrDistance(const gbe::AABB& box, const glm::vec3& point) {
+		float distance = 0.0f;
+
+		for (int a = 0; a < 3; a++)
+		{
+			if (point[a] < box.min[a])
+				distance += (box.min[a] - point[a]) * (box.min[a] - point[a]);
+			else if (point[a] > box.max[a])
+				distance += (point[a] - box.max[a]) * (point[a] - box.max[a]);
+		}
+
+		return distance;
+	}
+}
+
+gbe::gfx::LightClusters::LightClusters()
+{
+	cluster_bounds.resize(CLUSTER_COUNT);
+	cluster_ranges.resize(CLUSTER_COUNT * 2, 0.0f);
+	scratch_lights.resize(GetIndexCapacity());
+	scratch_counts.resize(CLUSTER_COUNT);
+}
+
+void gbe::gfx::LightClusters::BuildBounds(const Matrix4& proj, float near, float far)
+{
+	bounds_proj = proj;
+	bounds_near = near;
+	bounds_far = far;
+
+	//Orthographic cameras keep the same extents at every depth
+	bool perspective = proj[2][3] != 0;
+	const auto to_view = [&](float ndc, float depth, int axis) {
+		if (perspective)
+			return depth * (ndc + proj[2][axis]) / proj[axis][axis];
+
+		return (ndc - proj[3][axis]) / proj[axis][axis];
+		};
+
+	float ratio = far / near;
+	for (uint32_t z = 0; z < GRID_Z; z++)
+	{
+		float depths[2] = {
+			near * std::pow(ratio, (float)z / GRID_Z),
+			near * std::pow(ratio, (float)(z + 1) / GRID_Z)
+		};
+
+		for (uint32_t y = 0; y < GRID_Y; y++)
+		{
+			float ndc_y[2] = { -1.0f + 2.0f * y / GRID_Y, -1.0f + 2.0f * (y + 1) / GRID_Y };
+
+			for (uint32_t x = 0; x < GRID_X; x++)
+			{
+				float ndc_x[2] = { -1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * (x + 1) / GRID_X };
+
+				AABB box;
+				for (int k = 0; k < 8; k++)
+				{
+					float depth = depths[(k >> 2) & 1];
+					box.Encapsulate(Vector3(
+						to_view(ndc_x[k & 1], depth, 0),
+						to_view(ndc_y[(k >> 1) & 1], depth, 1),
+						-depth
+					));
+				}
+
+				cluster_bounds[x + y * GRID_X + z * GRID_X * GRID_Y] = box;
+			}
+		}
+	}
+}
+
+gbe::Vector2 gbe::gfx::LightClusters::GetSliceScaleBias() const
+{
+	float log_ratio = std::log(bounds_far / bounds_near);
+
+	return Vector2(GRID_Z / log_ratio, -(float)GRID_Z * std::log(bounds_near) / log_ratio);
+}
+
+void gbe::gfx::LightClusters::Build(const Matrix4& view, const Matrix4& proj, float near, float far, const std::vector<uint32_t>& directional, const std::vector<LightSphere>& spheres)
+{
+	near = std::max(near, 0.01f);
+	far = std::max(far, near * 1.01f);
+
+	if (near != bounds_near || far != bounds_far || proj != bounds_proj)
+		BuildBounds(proj, near, far);
+
+	const Vector2 scale_bias = GetSliceScaleBias();
+	const auto slice_of = [&](float depth) {
+		float slice = std::floor(std::log(depth) * scale_bias.x + scale_bias.y);
+		return (uint32_t)std::clamp(slice, 0.0f, (float)GRID_Z - 1);
+		};
+
+	//View space spheres and the depth slices they touch
+	struct LocalLight {
+		glm::vec3 center;
+		float sqr_radius;
+		uint32_t light;
+		uint32_t first_slice;
+		uint32_t last_slice;
+	};
+	std::vector<LocalLight> locals;
+	locals.reserve(spheres.size());
+
+	for (const auto& sphere : spheres)
+	{
+		glm::vec3 center = glm::vec3((glm::mat4)view * glm::vec4((glm::vec3)sphere.center, 1.0f));
+		float depth = -center.z;
+
+		if (depth + sphere.radius < near || depth - sphere.radius > far)
+			continue;
+
+		locals.push_back({
+			center,
+			sphere.radius * sphere.radius,
+			sphere.light,
+			slice_of(std::max(depth - sphere.radius, near)),
+			slice_of(std::min(depth + sphere.radius, far))
+			});
+	}
+
+	//BINNING
+	//Each job owns whole depth slices, so no two jobs write the same cluster
+	std::vector<uint32_t> slice_dropped(GRID_Z, 0);
+	const auto bin_slices = [&](size_t begin, size_t end) {
+		for (size_t z = begin; z < end; z++)
+		{
+			const uint32_t first_cluster = (uint32_t)z * GRID_X * GRID_Y;
+			std::fill(scratch_counts.begin() + first_cluster, scratch_counts.begin() + first_cluster + GRID_X * GRID_Y, 0);
+
+			for (const auto& local : locals)
+			{
+				if (z < local.first_slice || z > local.last_slice)
+					continue;
+
+				for (uint32_t c = first_cluster; c < first_cluster + GRID_X * GRID_Y; c++)
+				{
+					if (SqrDistance(cluster_bounds[c], local.center) > local.sqr_radius)
+						continue;
+
+					auto& count = scratch_counts[c];
+					if (count == MAX_LIGHTS_PER_CLUSTER) {
+						slice_dropped[z]++;
+						continue;
+					}
+
+					scratch_lights[(size_t)c * MAX_LIGHTS_PER_CLUSTER + count] = local.light;
+					count++;
+				}
+			}
+		}
+		};
+
+	auto jobsystem = JobSystem::Get();
+	if (jobsystem != nullptr && !locals.empty()) {
+		JobCounter counter;
+		jobsystem->ParallelFor(GRID_Z, 1, bin_slices, &counter);
+		jobsystem->Wait(&counter);
+	}
+	else {
+		bin_slices(0, GRID_Z);
+	}
+
+	//COMPACTION
+	indices.clear();
+	for (const auto light : directional)
+		indices.push_back((float)light);
+
+	for (uint32_t c = 0; c < CLUSTER_COUNT; c++)
+	{
+		cluster_ranges[c * 2] = (float)indices.size();
+		cluster_ranges[c * 2 + 1] = (float)scratch_counts[c];
+
+		const uint32_t* lights = &scratch_lights[(size_t)c * MAX_LIGHTS_PER_CLUSTER];
+		for (uint32_t k = 0; k < scratch_counts[c]; k++)
+			indices.push_back((float)lights[k]);
+	}
+
+	dropped = 0;
+	for (const auto count : slice_dropped)
+		dropped += count;
+}
\ No newline at end of file
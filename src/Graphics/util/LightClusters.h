@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// Bins local lights into a grid of froxels, screen tiles split into depth slices that grow exponentially with distance.
+		/// The lit shader reads its fragment's cluster and only shades the lights listed there, plus every directional light.
+		/// Slices are binned in parallel on the job system, each job owning its own clusters.
+		/// </summary>
+		class LightClusters {
+		public:
+			static constexpr uint32_t GRID_X = 16;
+			static constexpr uint32_t GRID_Y = 9;
+			static constexpr uint32_t GRID_Z = 24;
+			static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+			//Lights past this in one cluster are left out of it
+			static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 64;
+			//Width of the index list once laid out as a texture
+			static constexpr uint32_t INDEX_TEXTURE_WIDTH = 1024;
+
+			/// <summary>
+			/// World space sphere holding everything a local light reaches.
+			/// </summary>
+			struct LightSphere {
+				Vector3 center;
+				float radius;
+				//Index the shader knows the light by
+				uint32_t light;
+			};
+		private:
+			//View space bounds of every cluster, rebuilt when the projection changes
+			std::vector<AABB> cluster_bounds;
+			Matrix4 bounds_proj;
+			float bounds_near = 0;
+			float bounds_far = 0;
+
+			std::vector<uint32_t> scratch_lights;
+			std::vector<uint32_t> scratch_counts;
+
+			//Offset into the index list and light count of each cluster, x fastest then y then z
+			std::vector<float> cluster_ranges;
+			//Directional lights first, then each cluster's lights
+			std::vector<float> indices;
+			size_t dropped = 0;
+
+			void BuildBounds(const Matrix4& proj, float near, float far);
+		public:
+			LightClusters();
+
+			/// <summary>
+			/// Rebuilds the cluster lists for one camera.
+			/// </summary>
+			/// <param name="directional">Lights that touch every cluster.</param>
+			void Build(const Matrix4& view, const Matrix4& proj, float near, float far, const std::vector<uint32_t>& directional, const std::vector<LightSphere>& spheres);
+
+			/// <summary>
+			/// Scale and bias turning log(view depth) into a slice index.
+			/// </summary>
+			Vector2 GetSliceScaleBias() const;
+
+			inline const std::vector<float>& GetClusterRanges() const {
+				return cluster_ranges;
+			}
+			inline const std::vector<float>& GetIndices() const {
+				return indices;
+			}
+			/// <summary>
+			/// Cluster entries left out on the last build because a cluster was full.
+			/// </summary>
+			inline size_t GetDroppedCount() const {
+				return dropped;
+			}
+			/// <summary>
+			/// Largest index list a build can produce, directional lights aside.
+			/// </summary>
+			static constexpr size_t GetIndexCapacity() {
+				return (size_t)CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "MeshBVH.h"
+
+#include "Graphics/AssetLoaders/MeshLoader.h"
+
+#include <algorithm>
+#include <cmath>
+
+void gbe::gfx::MeshBVH::Build(const MeshData& mesh)
+{
+	nodes.clear();
+	triangles.clear();
+	positions.clear();
+	uvs.clear();
+	face_count = mesh.faces.size();
+
+	positions.reserve(mesh.vertices.size());
+	uvs.reserve(mesh.vertices.size());
+	for (const auto& vertex : mesh.vertices)
+	{
+		positions.push_back(vertex.pos);
+		uvs.push_back(vertex.texCoord);
+	}
+
+	//Faces past three corners are split as fans
+	for (uint32_t f = 0; f < (uint32_t)mesh.faces.size(); f++)
+	{
+		const auto& face = mesh.faces[f];
+
+		for (size_t k = 2; k < face.size(); k++)
+			triangles.push_back({ face[0], face[k - 1], face[k], f });
+	}
+
+	if (triangles.empty())
+		return;
+
+	nodes.reserve(2 * (triangles.size() / MAX_LEAF_TRIANGLES + 1));
+	BuildNode(0, (uint32_t)triangles.size());
+}
+
+uint32_t gbe::gfx::MeshBVH::BuildNode(uint32_t first, uint32_t count)
+{
+	uint32_t index = (uint32_t)nodes.size();
+	nodes.push_back(Node());
+
+	AABB bounds;
+	AABB centroid_bounds;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const auto& tri = triangles[i];
+		bounds.Encapsulate(positions[tri.a]);
+		bounds.Encapsulate(positions[tri.b]);
+		bounds.Encapsulate(positions[tri.c]);
+		centroid_bounds.Encapsulate((positions[tri.a] + positions[tri.b] + positions[tri.c]) * (1.0f / 3.0f));
+	}
+	nodes[index].bounds = bounds;
+
+	if (count <= MAX_LEAF_TRIANGLES) {
+		nodes[index].first_or_right = first;
+		nodes[index].count = count;
+		return index;
+	}
+
+	Vector3 extent = centroid_bounds.max - centroid_bounds.min;
+	int axis = 0;
+	if (extent.y > extent[axis])
+		axis = 1;
+	if (extent.z > extent[axis])
+		axis = 2;
+
+	//Summing the corners orders the same as the centroid
+	const auto centroid = [&](const Triangle& tri) {
+		return positions[tri.a][axis] + positions[tri.b][axis] + positions[tri.c][axis];
+		};
+
+	uint32_t half = count / 2;
+	std::nth_element(triangles.begin() + first, triangles.begin() + first + half, triangles.begin() + first + count, [&](const Triangle& a, const Triangle& b) {
+		return centroid(a) < centroid(b);
+		});
+
+	BuildNode(first, half);
+	uint32_t right = BuildNode(first + half, count - half);
+	nodes[index].first_or_right = right;
+
+	return index;
+}
+
+bool gbe::gfx::MeshBVH::Raycast(const Vector3& origin, const Vector3& direction, float max_t, Hit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	const Vector3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	bool found = false;
+
+	float t_root;
+	if (!nodes[0].bounds.IntersectRay(origin, inv_direction, max_t, t_root))
+		return false;
+
+	static thread_local std::vector<std::pair<uint32_t, float>> stack;
+	stack.clear();
+	stack.push_back({ 0, t_root });
+
+	while (!stack.empty()) {
+		auto [index, t_enter] = stack.back();
+		stack.pop_back();
+
+		if (t_enter > max_t)
+			continue;
+
+		const auto& node = nodes[index];
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first_or_right; i < node.first_or_right + node.count; i++)
+			{
+				//Moller-Trumbore, without culling either side
+				const auto& tri = triangles[i];
+				const Vector3& p0 = positions[tri.a];
+				Vector3 edge1 = positions[tri.b] - p0;
+				Vector3 edge2 = positions[tri.c] - p0;
+
+				glm::vec3 pvec = glm::cross((glm::vec3)direction, (glm::vec3)edge2);
+				float det = glm::dot((glm::vec3)edge1, pvec);
+
+				if (std::abs(det) < 1e-12f)
+					continue;
+
+				float inv_det = 1.0f / det;
+				glm::vec3 tvec = (glm::vec3)(origin - p0);
+				float u = glm::dot(tvec, pvec) * inv_det;
+
+				if (u < 0.0f || u > 1.0f)
+					continue;
+
+				glm::vec3 qvec = glm::cross(tvec, (glm::vec3)edge1);
+				float v = glm::dot((glm::vec3)direction, qvec) * inv_det;
+
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+
+				float t = glm::dot((glm::vec3)edge2, qvec) * inv_det;
+
+				if (t < 0.0f || t > max_t)
+					continue;
+
+				max_t = t;
+				hit.t = t;
+				hit.face = tri.face;
+				hit.uv = uvs[tri.a] * (1.0f - u - v) + uvs[tri.b] * u + uvs[tri.c] * v;
+				found = true;
+			}
+
+			continue;
+		}
+
+		uint32_t left = index + 1;
+		uint32_t right = node.first_or_right;
+
+		float t_left, t_right;
+		bool hit_left = nodes[left].bounds.IntersectRay(origin, inv_direction, max_t, t_left);
+		bool hit_right = nodes[right].bounds.IntersectRay(origin, inv_direction, max_t, t_right);
+
+		//The nearer child goes on top
+		if (hit_left && hit_right) {
+			if (t_left < t_right) {
+				stack.push_back({ right, t_right });
+				stack.push_back({ left, t_left });
+			}
+			else {
+				stack.push_back({ left, t_left });
+				stack.push_back({ right, t_right });
+			}
+		}
+		else if (hit_left) {
+			stack.push_back({ left, t_left });
+		}
+		else if (hit_right) {
+			stack.push_back({ right, t_right });
+		}
+	}
+
+	return found;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		struct MeshData;
+
+		/// <summary>
+		/// Static bounding volume hierarchy over the triangles of one mesh, in object space.
+		/// Built once from MeshData::faces by splitting at the median centroid of the widest axis.
+		/// Keeps its own copy of positions and uvs, so it outlives a reload of the mesh.
+		/// </summary>
+		class MeshBVH {
+		public:
+			static constexpr uint32_t MAX_LEAF_TRIANGLES = 4;
+
+			struct Hit {
+				float t;
+				//Index into MeshData::faces
+				uint32_t face;
+				Vector2 uv;
+			};
+		private:
+			//A leaf holds count triangles from first, an inner node has its left child right after it
+			struct Node {
+				AABB bounds;
+				uint32_t first_or_right = 0;
+				uint32_t count = 0;
+			};
+			struct Triangle {
+				uint16_t a, b, c;
+				uint32_t face;
+			};
+
+			std::vector<Node> nodes;
+			std::vector<Triangle> triangles;
+			std::vector<Vector3> positions;
+			std::vector<Vector2> uvs;
+			size_t face_count = 0;
+
+			uint32_t BuildNode(uint32_t first, uint32_t count);
+		public:
+			void Build(const MeshData& mesh);
+
+			/// <summary>
+			/// Nearest triangle hit by origin + t * direction for t in [0, max_t], from either side.
+			/// </summary>
+			bool Raycast(const Vector3& origin, const Vector3& direction, float max_t, Hit& hit) const;
+
+			inline size_t GetFaceCount() const {
+				return face_count;
+			}
+			inline size_t GetNodeCount() const {
+				return nodes.size();
+			}
+		};
+	}
+}
\ No newline at end of file
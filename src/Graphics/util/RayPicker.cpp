@@ -0,0 +1,53 @@
+#include "RayPicker.h"
+
+#include "Graphics/Renderer.h"
+#include "Graphics/AssetLoaders/MeshLoader.h"
+
+const gbe::gfx::MeshBVH& gbe::gfx::RayPicker::GetMeshBVH(const MeshData* mesh)
+{
+	auto& bvh = mesh_bvhs[mesh];
+
+	//A mesh reloaded at the same address shows up as a different face count
+	if (bvh.GetNodeCount() == 0 || bvh.GetFaceCount() != mesh->faces.size())
+		bvh.Build(*mesh);
+
+	return bvh;
+}
+
+bool gbe::gfx::RayPicker::Raycast(const GraphicsRenderInfo& renderinfo, const Vector3& origin, const Vector3& direction, float max_distance, uint64_t group_mask, Hit& hit)
+{
+	bool found = false;
+
+	nodes_tested = renderinfo.bvh.QueryRay(origin, direction, max_distance, [&](GraphicsRenderInfo::InstanceInfo* info, float t_enter, float max_t) {
+		const auto& batch = *info->batch;
+
+		if (!info->enabled || (batch.group_masks[info->batch_index] & group_mask) == 0)
+			return max_t;
+
+		const MeshData* mesh = info->drawcall->get_meshdata();
+		if (mesh == nullptr)
+			return max_t;
+
+		const auto& mesh_bvh = GetMeshBVH(mesh);
+
+		//An affine transform keeps t, so the object space hit distance is the world one
+		glm::mat4 inverse = glm::inverse((glm::mat4)batch.matrices[info->batch_index]);
+		Vector3 local_origin = glm::vec3(inverse * glm::vec4((glm::vec3)origin, 1.0f));
+		Vector3 local_direction = glm::vec3(inverse * glm::vec4((glm::vec3)direction, 0.0f));
+
+		MeshBVH::Hit mesh_hit;
+		if (!mesh_bvh.Raycast(local_origin, local_direction, max_t, mesh_hit))
+			return max_t;
+
+		hit.instance_id = batch.instances[info->batch_index];
+		hit.distance = mesh_hit.t;
+		hit.position = origin + direction * mesh_hit.t;
+		hit.face = mesh_hit.face;
+		hit.uv = mesh_hit.uv;
+		found = true;
+
+		return mesh_hit.t;
+		});
+
+	return found;
+}
\ No newline at end of file
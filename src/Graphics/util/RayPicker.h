@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Math/gbe_math.h"
+#include "MeshBVH.h"
+
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		struct GraphicsRenderInfo;
+		struct MeshData;
+
+		/// <summary>
+		/// Casts rays against the registered instances on the CPU, so picks need no GPU readback.
+		/// The top level is the instance BVH the renderer already keeps, each candidate instance then
+		/// takes the ray into object space and walks its mesh's triangle BVH, built the first time that mesh is reached.
+		/// </summary>
+		class RayPicker {
+		public:
+			struct Hit {
+				uint32_t instance_id = 0;
+				float distance = 0;
+				Vector3 position;
+				//Index into the mesh's MeshData::faces
+				uint32_t face = 0;
+				Vector2 uv;
+			};
+		private:
+			std::unordered_map<const MeshData*, MeshBVH> mesh_bvhs;
+			size_t nodes_tested = 0;
+		public:
+			const MeshBVH& GetMeshBVH(const MeshData* mesh);
+
+			/// <summary>
+			/// Nearest enabled instance in any of the rendergroups of group_mask hit before max_distance.
+			/// </summary>
+			/// <param name="direction">Normalized, so distances are in world units.</param>
+			bool Raycast(const GraphicsRenderInfo& renderinfo, const Vector3& origin, const Vector3& direction, float max_distance, uint64_t group_mask, Hit& hit);
+
+			/// <summary>
+			/// Instance BVH nodes tested by the last raycast.
+			/// </summary>
+			inline size_t GetNodesTested() const {
+				return nodes_tested;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <stdexcept>
+
+namespace {
+	//Every other bit of a Morton index, so cells placed in index order fill the atlas quadrant by quadrant
+	uint32_t CompactBits(uint64_t x) {
+		x &= 0x5555555555555555ull;
+		x = (x | (x >> 1)) & 0x3333333333333333ull;
+		x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+		x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+		x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+		return (uint32_t)x;
+	}
+}
+
+gbe::gfx::ShadowAtlas::ShadowAtlas(uint32_t _atlas_size, uint32_t _min_tile, uint32_t _max_tile)
+{
+	if (_atlas_size == 0 || _min_tile == 0 || _min_tile > _atlas_size)
+		throw std::runtime_error("Shadow atlas needs a size of at least one tile.");
+
+	atlas_size = std::bit_floor(_atlas_size);
+	min_tile = std::bit_floor(_min_tile);
+	max_tile = std::clamp(std::bit_floor(std::max(_max_tile, 1u)), min_tile, atlas_size);
+}
+
+bool gbe::gfx::ShadowAtlas::Allocate(const std::vector<Request>& requests, std::vector<std::vector<Tile>>& out)
+{
+	const uint64_t capacity = (uint64_t)atlas_size * atlas_size;
+
+	std::vector<uint32_t> sizes(requests.size());
+	uint64_t total = 0;
+	for (size_t r = 0; r < requests.size(); r++)
+	{
+		sizes[r] = std::clamp(std::bit_ceil(std::max(requests[r].size, 1u)), min_tile, max_tile);
+		total += (uint64_t)sizes[r] * sizes[r] * requests[r].count;
+	}
+
+	//BUDGETING
+	while (total > capacity) {
+		size_t pick = SIZE_MAX;
+		float pick_score = FLT_MAX;
+
+		//Halve the tile that buys the least priority per texel
+		for (size_t r = 0; r < requests.size(); r++)
+		{
+			if (sizes[r] <= min_tile)
+				continue;
+
+			float score = requests[r].priority / ((float)sizes[r] * sizes[r]);
+			if (score < pick_score) {
+				pick = r;
+				pick_score = score;
+			}
+		}
+
+		if (pick != SIZE_MAX) {
+			total -= (uint64_t)sizes[pick] * sizes[pick] * requests[pick].count * 3 / 4;
+			sizes[pick] /= 2;
+			continue;
+		}
+
+		//Everything is at the smallest size, drop the least important light
+		for (size_t r = 0; r < requests.size(); r++)
+		{
+			if (sizes[r] == 0)
+				continue;
+
+			if (requests[r].priority < pick_score) {
+				pick = r;
+				pick_score = requests[r].priority;
+			}
+		}
+
+		total -= (uint64_t)sizes[pick] * sizes[pick] * requests[pick].count;
+		sizes[pick] = 0;
+	}
+
+	//PACKING
+	//Power of two sizes placed largest first along a Morton curve always land aligned and never overlap
+	std::vector<size_t> order;
+	order.reserve(requests.size());
+	for (size_t r = 0; r < requests.size(); r++)
+	{
+		if (sizes[r] != 0)
+			order.push_back(r);
+	}
+
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		if (sizes[a] != sizes[b])
+			return sizes[a] > sizes[b];
+
+		return requests[a].key < requests[b].key;
+		});
+
+	out.assign(requests.size(), {});
+	std::vector<std::pair<uint64_t, uint32_t>> new_order;
+	new_order.reserve(order.size());
+
+	uint64_t cursor = 0;
+	for (size_t r : order)
+	{
+		uint64_t cells_per_tile = ((uint64_t)sizes[r] / min_tile) * (sizes[r] / min_tile);
+		out[r].resize(requests[r].count);
+
+		for (auto& tile : out[r])
+		{
+			tile.x = CompactBits(cursor) * min_tile;
+			tile.y = CompactBits(cursor >> 1) * min_tile;
+			tile.size = sizes[r];
+			cursor += cells_per_tile;
+		}
+
+		new_order.push_back({ requests[r].key, sizes[r] });
+	}
+
+	for (size_t r = 0; r < requests.size(); r++)
+	{
+		if (sizes[r] == 0)
+			out[r].resize(requests[r].count);
+	}
+
+	used_texels = (size_t)cursor * min_tile * min_tile;
+
+	bool moved = new_order != last_order;
+	if (moved) {
+		last_order = std::move(new_order);
+		repacks++;
+	}
+
+	return moved;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// Shares one square shadow atlas between lights, as power of two tiles.
+		/// When the requests do not fit, the tiles giving the least priority per texel are halved, then the lowest priority lights dropped.
+		/// Packing only depends on the final sizes, so tiles stay where they are until a light's size changes.
+		/// </summary>
+		class ShadowAtlas {
+		public:
+			struct Request {
+				//Stable id of the light, orders equal sized tiles
+				uint64_t key;
+				//Higher keeps its resolution longer when the atlas is short
+				float priority;
+				//Wanted tile size, rounded up to a power of two and clamped to the tile limits
+				uint32_t size;
+				//Tiles of that size the light needs, one per cascade
+				uint32_t count = 1;
+			};
+			struct Tile {
+				uint32_t x = 0;
+				uint32_t y = 0;
+				uint32_t size = 0;
+
+				inline bool IsValid() const {
+					return size != 0;
+				}
+				inline bool operator==(const Tile& other) const {
+					return x == other.x && y == other.y && size == other.size;
+				}
+			};
+		private:
+			uint32_t atlas_size;
+			uint32_t min_tile;
+			uint32_t max_tile;
+
+			//Pack order of the last allocation, to tell when tiles moved
+			std::vector<std::pair<uint64_t, uint32_t>> last_order;
+			size_t repacks = 0;
+			size_t used_texels = 0;
+		public:
+			ShadowAtlas(uint32_t atlas_size, uint32_t min_tile, uint32_t max_tile);
+
+			/// <summary>
+			/// Places every request. out[r] gets request r's tiles, all invalid if it was dropped.
+			/// </summary>
+			/// <returns>Whether any tile moved or changed size since the last call.</returns>
+			bool Allocate(const std::vector<Request>& requests, std::vector<std::vector<Tile>>& out);
+
+			inline uint32_t GetAtlasSize() const {
+				return atlas_size;
+			}
+			inline uint32_t GetMaxTile() const {
+				return max_tile;
+			}
+			inline size_t GetRepackCount() const {
+				return repacks;
+			}
+			inline size_t GetUsedTexels() const {
+				return used_texels;
+			}
+		};
+	}
+}
\ No newline at end of file
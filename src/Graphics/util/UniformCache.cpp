@@ -0,0 +1,130 @@
+#include "UniformCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+std::vector<gbe::gfx::UniformCache::Entry> gbe::gfx::UniformCache::entries;
+std::unordered_map<std::string, gbe::gfx::UniformCache::Id> gbe::gfx::UniformCache::ids;
+
+uint32_t gbe::gfx::UniformCache::frame = 1;
+bgfx::ViewId gbe::gfx::UniformCache::current_view = UINT16_MAX;
+bool gbe::gfx::UniformCache::deduplicate = false;
+
+size_t gbe::gfx::UniformCache::requested = 0;
+size_t gbe::gfx::UniformCache::sent = 0;
+size_t gbe::gfx::UniformCache::last_requested = 0;
+size_t gbe::gfx::UniformCache::last_sent = 0;
+
+std::array<uint16_t, 16> gbe::gfx::UniformCache::stage_textures = {};
+size_t gbe::gfx::UniformCache::texture_rebinds = 0;
+size_t gbe::gfx::UniformCache::last_texture_rebinds = 0;
+
+gbe::gfx::UniformCache::Id gbe::gfx::UniformCache::Resolve(const std::string& name, bgfx::UniformType::Enum type, uint16_t count)
+{
+	auto it = ids.find(name);
+	if (it != ids.end()) {
+		auto& entry = entries[it->second];
+
+		if (entry.type != type)
+			throw std::runtime_error("Uniform " + name + " was already resolved with another type.");
+
+		//bgfx grows a uniform of the same name to the largest count asked for, the handle stays the same
+		if (count > entry.count) {
+			entry.handle = bgfx::createUniform(name.c_str(), type, count);
+			entry.count = count;
+		}
+
+		return it->second;
+	}
+
+	Entry entry;
+	entry.name = name;
+	entry.handle = bgfx::createUniform(name.c_str(), type, count);
+	entry.type = type;
+	entry.count = count;
+
+	Id id = (Id)entries.size();
+	entries.push_back(std::move(entry));
+	ids.insert_or_assign(name, id);
+
+	return id;
+}
+
+void gbe::gfx::UniformCache::RegisterShader(bgfx::ShaderHandle shader)
+{
+	uint16_t count = bgfx::getShaderUniforms(shader);
+	std::vector<bgfx::UniformHandle> handles(count);
+	bgfx::getShaderUniforms(shader, handles.data(), count);
+
+	for (const auto handle : handles)
+	{
+		bgfx::UniformInfo info;
+		bgfx::getUniformInfo(handle, info);
+
+		Resolve(info.name, info.type, std::max<uint16_t>(info.num, 1));
+	}
+}
+
+void gbe::gfx::UniformCache::Set(Id id, const void* data, uint16_t count)
+{
+	auto& entry = entries[id];
+	const size_t size = (size_t)count * ((entry.type == bgfx::UniformType::Mat4) ? 64 : (entry.type == bgfx::UniformType::Mat3) ? 36 : 16);
+	requested++;
+
+	if (deduplicate) {
+		if (entry.last_frame == frame && entry.last_view == current_view && entry.last.size() == size
+			&& std::memcmp(entry.last.data(), data, size) == 0)
+			return;
+
+		entry.last.assign((const uint8_t*)data, (const uint8_t*)data + size);
+		entry.last_view = current_view;
+		entry.last_frame = frame;
+	}
+	else {
+		//The view this set lands in is unknown, so the value cached for any view can no longer be trusted
+		entry.last_frame = 0;
+	}
+
+	bgfx::setUniform(entry.handle, data, count);
+	sent++;
+}
+
+void gbe::gfx::UniformCache::SetTexture(uint8_t stage, Id id, bgfx::TextureHandle texture)
+{
+	bgfx::setTexture(stage, entries[id].handle, texture);
+
+	if (!deduplicate || stage >= stage_textures.size())
+		return;
+
+	if (stage_textures[stage] != texture.idx)
+		texture_rebinds++;
+
+	stage_textures[stage] = texture.idx;
+}
+
+void gbe::gfx::UniformCache::BeginFrame()
+{
+	frame++;
+	last_requested = requested;
+	last_sent = sent;
+	last_texture_rebinds = texture_rebinds;
+	requested = 0;
+	sent = 0;
+	texture_rebinds = 0;
+
+	EndView();
+}
+
+void gbe::gfx::UniformCache::BeginView(bgfx::ViewId view, bool _deduplicate)
+{
+	current_view = view;
+	deduplicate = _deduplicate;
+	stage_textures.fill(bgfx::kInvalidHandle);
+}
+
+void gbe::gfx::UniformCache::EndView()
+{
+	current_view = UINT16_MAX;
+	deduplicate = false;
+}
\ No newline at end of file
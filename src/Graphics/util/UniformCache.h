@@ -0,0 +1,106 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+
+#include <vector>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace gbe {
+	namespace gfx {
+		/// <summary>
+		/// Every uniform the renderer sets, resolved once from its name to a dense id.
+		/// Inside a deduplicating view, a value equal to the last one set in that view this frame is not sent again.
+		/// bgfx keeps uniform values from draw to draw, so that is only safe in views drawn in submission order.
+		/// </summary>
+		class UniformCache {
+		public:
+			typedef uint32_t Id;
+			static constexpr Id INVALID_ID = UINT32_MAX;
+		private:
+			struct Entry {
+				std::string name;
+				bgfx::UniformHandle handle = BGFX_INVALID_HANDLE;
+				bgfx::UniformType::Enum type = bgfx::UniformType::Vec4;
+				uint16_t count = 1;
+
+				//Last value sent in last_view, valid for last_frame only
+				std::vector<uint8_t> last;
+				bgfx::ViewId last_view = UINT16_MAX;
+				uint32_t last_frame = 0;
+			};
+
+			static std::vector<Entry> entries;
+			static std::unordered_map<std::string, Id> ids;
+
+			static uint32_t frame;
+			static bgfx::ViewId current_view;
+			static bool deduplicate;
+
+			static size_t requested;
+			static size_t sent;
+			static size_t last_requested;
+			static size_t last_sent;
+
+			//Texture bound on each stage by the last draw of the current view
+			static std::array<uint16_t, 16> stage_textures;
+			static size_t texture_rebinds;
+			static size_t last_texture_rebinds;
+		public:
+			/// <summary>
+			/// Id of the uniform with that name, created if no shader or caller made it yet.
+			/// </summary>
+			static Id Resolve(const std::string& name, bgfx::UniformType::Enum type, uint16_t count = 1);
+			/// <summary>
+			/// Resolves every uniform a loaded shader uses, so none of them is created at draw time.
+			/// </summary>
+			static void RegisterShader(bgfx::ShaderHandle shader);
+
+			inline static bgfx::UniformHandle GetHandle(Id id) {
+				return entries[id].handle;
+			}
+
+			/// <summary>
+			/// Sends count elements of the uniform, 16 bytes each or 64 for matrices.
+			/// </summary>
+			static void Set(Id id, const void* data, uint16_t count = 1);
+			/// <summary>
+			/// Binds a texture for the next draw. bgfx needs it on every draw, but inside a view
+			/// only a texture differing from the one the last draw had on that stage counts as a rebind.
+			/// </summary>
+			static void SetTexture(uint8_t stage, Id id, bgfx::TextureHandle texture);
+
+			/// <summary>
+			/// Forgets every value sent so far and moves the stats to the last frame's.
+			/// </summary>
+			static void BeginFrame();
+			/// <summary>
+			/// Sets that follow belong to this view. Only views drawn in submission order should deduplicate.
+			/// </summary>
+			static void BeginView(bgfx::ViewId view, bool deduplicate);
+			/// <summary>
+			/// Sets that follow always go through, until the next BeginView.
+			/// </summary>
+			static void EndView();
+
+			/// <summary>
+			/// Uniform sets asked for on the last frame, and those that reached bgfx.
+			/// </summary>
+			inline static size_t GetRequestedCount() {
+				return last_requested;
+			}
+			inline static size_t GetSentCount() {
+				return last_sent;
+			}
+			/// <summary>
+			/// Texture changes between consecutive draws of the deduplicating views on the last frame.
+			/// </summary>
+			inline static size_t GetTextureRebindCount() {
+				return last_texture_rebinds;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+gbe::JobSystem* gbe::JobSystem::active_instance = nullptr;
+
+namespace {
+	//Index of the worker owning the calling thread, SIZE_MAX for threads outside the job system
+	thread_local size_t current_worker = SIZE_MAX;
+}
+
+gbe::JobSystem::JobSystem(size_t worker_threads)
+{
+	if (worker_threads == 0) {
+		size_t hardware_threads = std::thread::hardware_concurrency();
+		worker_threads = std::max<size_t>(hardware_threads, 2) - 1;
+	}
+
+	//Worker 0 is the constructing (main) thread
+	current_worker = 0;
+	for (size_t i = 0; i < worker_threads + 1; i++)
+		workers.push_back(new Worker());
+
+	for (size_t i = 1; i < workers.size(); i++)
+		threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+
+	active_instance = this;
+}
+
+gbe::JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	sleep_condition.notify_all();
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (auto worker : workers)
+		delete worker;
+
+	if (active_instance == this)
+		active_instance = nullptr;
+}
+
+size_t gbe::JobSystem::GetCurrentWorker()
+{
+	if (current_worker < workers.size())
+		return current_worker;
+
+	//Outside threads spread their jobs over every deque
+	return round_robin.fetch_add(1, std::memory_order_relaxed) % workers.size();
+}
+
+void gbe::JobSystem::Push(Job job)
+{
+	auto worker = workers[GetCurrentWorker()];
+
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->jobs.push_back(std::move(job));
+	}
+	queued_count.fetch_add(1, std::memory_order_release);
+
+	//Taking the sleep lock orders this push against a worker about to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+	}
+	sleep_condition.notify_one();
+}
+
+bool gbe::JobSystem::TryPop(size_t worker_index, Job& out)
+{
+	auto worker = workers[worker_index];
+	std::lock_guard<std::mutex> lock(worker->mutex);
+
+	if (worker->jobs.empty())
+		return false;
+
+	//Newest first, its data is most likely still in cache
+	out = std::move(worker->jobs.back());
+	worker->jobs.pop_back();
+	queued_count.fetch_sub(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+bool gbe::JobSystem::TrySteal(size_t thief_index, Job& out)
+{
+	for (size_t offset = 1; offset < workers.size(); offset++)
+	{
+		auto victim = workers[(thief_index + offset) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim->mutex);
+
+		if (victim->jobs.empty())
+			continue;
+
+		//Oldest first, the owner works from the other end
+		out = std::move(victim->jobs.front());
+		victim->jobs.pop_front();
+		queued_count.fetch_sub(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool gbe::JobSystem::TryPopBackground(Job& out)
+{
+	std::lock_guard<std::mutex> lock(background.mutex);
+
+	if (background.jobs.empty())
+		return false;
+
+	out = std::move(background.jobs.front());
+	background.jobs.pop_front();
+	queued_count.fetch_sub(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+void gbe::JobSystem::Execute(Job& job)
+{
+	job.function();
+
+	auto counter = job.counter;
+
+	if (counter == nullptr)
+		return;
+
+	//Raised before the decrement, so a waiter seeing zero pending still waits for this job to let go of the counter
+	counter->finishing.fetch_add(1, std::memory_order_relaxed);
+
+	if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		counter->finishing.fetch_sub(1, std::memory_order_release);
+		return;
+	}
+
+	std::vector<std::function<void()>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->continuation_mutex);
+		continuations.swap(counter->continuations);
+	}
+
+	//Last access to the counter, the caller may destroy it from here on
+	counter->finishing.fetch_sub(1, std::memory_order_release);
+
+	for (auto& continuation : continuations)
+		continuation();
+}
+
+void gbe::JobSystem::WorkerLoop(size_t worker_index)
+{
+	current_worker = worker_index;
+
+	while (!stopping)
+	{
+		Job job;
+
+		if (TryPop(worker_index, job) || TrySteal(worker_index, job) || TryPopBackground(job)) {
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep_condition.wait(lock, [this]() {
+			return stopping || queued_count.load(std::memory_order_acquire) > 0;
+			});
+	}
+}
+
+void gbe::JobSystem::Run(std::function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	Push({ std::move(job), counter });
+}
+
+void gbe::JobSystem::RunBackground(std::function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(background.mutex);
+		background.jobs.push_back({ std::move(job), counter });
+	}
+	queued_count.fetch_add(1, std::memory_order_release);
+
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+	}
+	sleep_condition.notify_one();
+}
+
+void gbe::JobSystem::RunAfter(JobCounter* dependency, std::function<void()> job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (dependency != nullptr) {
+		std::lock_guard<std::mutex> lock(dependency->continuation_mutex);
+
+		//Execute() swaps the list out under the same lock after the count hits zero
+		if (dependency->pending.load(std::memory_order_acquire) != 0) {
+			dependency->continuations.push_back([this, job = std::move(job), counter]() {
+				Push({ job, counter });
+				});
+			return;
+		}
+	}
+
+	Push({ std::move(job), counter });
+}
+
+void gbe::JobSystem::ParallelFor(size_t count, size_t min_chunk, std::function<void(size_t begin, size_t end)> job, JobCounter* counter)
+{
+	if (count == 0)
+		return;
+
+	//A few chunks per worker so stealing can even out uneven chunks
+	size_t chunk = std::max<size_t>(min_chunk, 1);
+	chunk = std::max(chunk, (count + workers.size() * 4 - 1) / (workers.size() * 4));
+
+	if (chunk >= count) {
+		job(0, count);
+		return;
+	}
+
+	for (size_t begin = 0; begin < count; begin += chunk)
+	{
+		size_t end = std::min(begin + chunk, count);
+
+		this->Run([job, begin, end]() {
+			job(begin, end);
+			}, counter);
+	}
+}
+
+void gbe::JobSystem::Wait(JobCounter* counter)
+{
+	while (!counter->IsDone())
+	{
+		if (!TryRunOne())
+			std::this_thread::yield();
+	}
+}
+
+bool gbe::JobSystem::TryRunOne()
+{
+	size_t worker_index = current_worker < workers.size() ? current_worker : 0;
+	Job job;
+
+	if (TryPop(worker_index, job) || TrySteal(worker_index, job)) {
+		Execute(job);
+		return true;
+	}
+
+	return false;
+}
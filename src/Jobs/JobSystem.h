@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gbe {
+	/// <summary>
+	/// Counts the jobs still in flight for one batch of work. Wait on it, or schedule more jobs to run after it.
+	/// Owned by the caller and must outlive every job that references it.
+	/// </summary>
+	class JobCounter {
+	private:
+		std::atomic<uint32_t> pending = 0;
+		//Jobs that still touch the counter after their decrement, it may only be destroyed once they are out
+		std::atomic<uint32_t> finishing = 0;
+
+		std::mutex continuation_mutex;
+		std::vector<std::function<void()>> continuations;
+
+		friend class JobSystem;
+	public:
+		inline bool IsDone() const {
+			return pending.load(std::memory_order_acquire) == 0 && finishing.load(std::memory_order_acquire) == 0;
+		}
+	};
+
+	/// <summary>
+	/// Engine-wide job scheduler. Every worker owns a deque: it pops its own newest job and
+	/// steals the oldest from others when empty. The main thread is worker 0 and only runs jobs while it waits.
+	/// Long running work (file loading) goes to a background queue the main thread never helps with.
+	/// bgfx calls are not allowed inside jobs, keep them on the main thread.
+	/// </summary>
+	class JobSystem {
+	private:
+		static JobSystem* active_instance;
+
+		struct Job {
+			std::function<void()> function;
+			JobCounter* counter;
+		};
+
+		struct Worker {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		std::vector<Worker*> workers;
+		Worker background;
+		std::vector<std::thread> threads;
+
+		std::atomic<uint32_t> queued_count = 0;
+		std::atomic<uint32_t> round_robin = 0;
+		std::atomic<bool> stopping = false;
+		std::mutex sleep_mutex;
+		std::condition_variable sleep_condition;
+
+		void Push(Job job);
+		bool TryPop(size_t worker_index, Job& out);
+		bool TrySteal(size_t thief_index, Job& out);
+		bool TryPopBackground(Job& out);
+		void Execute(Job& job);
+		void WorkerLoop(size_t worker_index);
+		size_t GetCurrentWorker();
+	public:
+		/// <param name="worker_threads">Background threads to spawn. 0 uses one less than the hardware thread count.</param>
+		JobSystem(size_t worker_threads = 0);
+		~JobSystem();
+
+		inline static JobSystem* Get() {
+			return active_instance;
+		}
+		/// <summary>
+		/// Worker threads plus the main thread.
+		/// </summary>
+		inline size_t GetWorkerCount() const {
+			return workers.size();
+		}
+
+		/// <summary>
+		/// Queues a job. If a counter is given it is incremented now and decremented when the job finishes.
+		/// </summary>
+		void Run(std::function<void()> job, JobCounter* counter = nullptr);
+		/// <summary>
+		/// Queues a long running job that only worker threads pick up, so it never stalls a waiting frame.
+		/// </summary>
+		void RunBackground(std::function<void()> job, JobCounter* counter = nullptr);
+		/// <summary>
+		/// Queues a job that only starts once the dependency counter reaches zero.
+		/// </summary>
+		void RunAfter(JobCounter* dependency, std::function<void()> job, JobCounter* counter = nullptr);
+		/// <summary>
+		/// Splits [0, count) into chunks of at least min_chunk and runs them as jobs on the counter.
+		/// </summary>
+		void ParallelFor(size_t count, size_t min_chunk, std::function<void(size_t begin, size_t end)> job, JobCounter* counter);
+
+		/// <summary>
+		/// Blocks until the counter reaches zero, running queued jobs on this thread in the meantime.
+		/// </summary>
+		void Wait(JobCounter* counter);
+		/// <summary>
+		/// Runs one queued job on the calling thread if there is any.
+		/// </summary>
+		/// <returns>True if a job was run.</returns>
+		bool TryRunOne();
+	};
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "JobSystem.h"
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cfloat>
+#include <algorithm>
+
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix4.h"
+
+namespace gbe {
+	/// <summary>
+	/// Axis aligned bounding box. A default constructed box is empty and grows with Encapsulate.
+	/// </summary>
+	struct AABB {
+		Vector3 min = Vector3(FLT_MAX);
+		Vector3 max = Vector3(-FLT_MAX);
+
+		inline AABB() {}
+		inline AABB(Vector3 _min, Vector3 _max) : min(_min), max(_max) {}
+
+		inline bool IsEmpty() const {
+			return min.x > max.x || min.y > max.y || min.z > max.z;
+		}
+		inline Vector3 Center() const {
+			return (min + max) * 0.5f;
+		}
+		inline Vector3 Extents() const {
+			return (max - min) * 0.5f;
+		}
+		inline float SurfaceArea() const {
+			if (IsEmpty())
+				return 0.0f;
+
+			Vector3 d = max - min;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+		inline bool Contains(const AABB& other) const {
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+		}
+
+		/// <summary>
+		/// Slab test of the ray origin + t * direction for t in [0, max_t], taking 1 / direction.
+		/// </summary>
+		/// <param name="t_enter">Where the ray enters the box, 0 if it starts inside.</param>
+		inline bool IntersectRay(const Vector3& origin, const Vector3& inv_direction, float max_t, float& t_enter) const {
+			float t0 = 0.0f;
+			float t1 = max_t;
+
+			for (int a = 0; a < 3; a++)
+			{
+				float near_t = (min[a] - origin[a]) * inv_direction[a];
+				float far_t = (max[a] - origin[a]) * inv_direction[a];
+
+				if (near_t > far_t)
+					std::swap(near_t, far_t);
+
+				t0 = std::max(t0, near_t);
+				t1 = std::min(t1, far_t);
+
+				if (t0 > t1)
+					return false;
+			}
+
+			t_enter = t0;
+			return true;
+		}
+
+		inline void Encapsulate(const Vector3& point) {
+			min = Vector3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+			max = Vector3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+		}
+		inline void Encapsulate(const AABB& other) {
+			if (other.IsEmpty())
+				return;
+
+			Encapsulate(other.min);
+			Encapsulate(other.max);
+		}
+		inline static AABB Merge(const AABB& a, const AABB& b) {
+			AABB merged = a;
+			merged.Encapsulate(b);
+			return merged;
+		}
+
+		/// <summary>
+		/// Bounds of this box after the transform, per axis instead of through its 8 corners.
+		/// </summary>
+		inline AABB Transformed(const Matrix4& matrix) const {
+			if (IsEmpty())
+				return AABB();
+
+			Vector3 translation = glm::vec3(matrix[3]);
+			AABB result(translation, translation);
+
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					float a = matrix[j][i] * min[j];
+					float b = matrix[j][i] * max[j];
+					result.min[i] += std::min(a, b);
+					result.max[i] += std::max(a, b);
+				}
+			}
+
+			return result;
+		}
+	};
+
+	/// <summary>
+	/// Six inward facing planes taken from a view-projection matrix.
+	/// The near plane assumes a -1 to 1 clip depth, which stays conservative for 0 to 1 projections.
+	/// </summary>
+	struct Frustum {
+		enum TestResult {
+			OUTSIDE,
+			INTERSECTS,
+			INSIDE
+		};
+
+		//Plane normal in xyz, distance in w. A point p is inside when dot(n, p) + w >= 0
+		Vector4 planes[6];
+
+		inline static Frustum FromMatrix(const Matrix4& viewproj) {
+			Frustum frustum;
+
+			const auto row = [&](int r) {
+				return Vector4(viewproj[0][r], viewproj[1][r], viewproj[2][r], viewproj[3][r]);
+				};
+
+			Vector4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+			frustum.planes[0] = r3 + r0;
+			frustum.planes[1] = r3 - r0;
+			frustum.planes[2] = r3 + r1;
+			frustum.planes[3] = r3 - r1;
+			frustum.planes[4] = r3 + r2;
+			frustum.planes[5] = r3 - r2;
+
+			for (auto& plane : frustum.planes)
+			{
+				float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+				if (length > 0.0f)
+					plane = plane * (1.0f / length);
+			}
+
+			return frustum;
+		}
+
+		inline TestResult Classify(const AABB& box) const {
+			TestResult result = INSIDE;
+
+			for (const auto& plane : planes)
+			{
+				//Farthest corner along the normal decides outside, the nearest decides inside
+				Vector3 positive(
+					plane.x >= 0 ? box.max.x : box.min.x,
+					plane.y >= 0 ? box.max.y : box.min.y,
+					plane.z >= 0 ? box.max.z : box.min.z
+				);
+				Vector3 negative(
+					plane.x >= 0 ? box.min.x : box.max.x,
+					plane.y >= 0 ? box.min.y : box.max.y,
+					plane.z >= 0 ? box.min.z : box.max.z
+				);
+
+				if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0)
+					return OUTSIDE;
+
+				if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0)
+					result = INTERSECTS;
+			}
+
+			return result;
+		}
+		inline bool Intersects(const AABB& box) const {
+			return Classify(box) != OUTSIDE;
+		}
+	};
+}
\ No newline at end of file
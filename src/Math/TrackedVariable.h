@@ -23,6 +23,9 @@ namespace gbe {
 		T& Get() {
 			return variable;
 		}
+		const T& Get() const {
+			return variable;
+		}
 		void Set(T value) {
 			T oldvalue = this->variable;
 			this->variable = value;
@@ -7,4 +7,5 @@
 #include "Matrix4.h"
 #include "TrackedVariable.h"
 #include "Quaternion.h"
-#include "Constants.h"
\ No newline at end of file
+#include "Constants.h"
+#include "Bounds.h"
\ No newline at end of file